@@ -0,0 +1,111 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "Bezier.h"
+
+// @dev B-spline curves over a knot vector of count + degree + 1 knots. The curve is defined between
+// knots degree and count, where every span depends on degree + 1 control points only, so a point
+// costs O(degree^2) however many control points there are.
+class BSpline
+{
+public:
+	// @dev uniform knots 0, 1, 2, ..., the curve starts and ends near the first and last control point
+	static std::vector<float> uniformKnots(int count, int degree) {
+		std::vector<float> knots(count + degree + 1);
+		for (int i = 0; i < (int)knots.size(); i++) {
+			knots[i] = (float)i;
+		}
+		return knots;
+	}
+
+	// @dev clamped knots spaced like the control polygon, the curve runs from the first to the last
+	// control point and spans over long legs of the polygon get more of the parameter
+	// @param points Control points, x and y interleaved
+	static std::vector<float> chordKnots(const float* points, int count, int degree) {
+		std::vector<float> distance(count, 0.0f);
+		for (int i = 1; i < count; i++) {
+			float dx = points[i * 2] - points[i * 2 - 2], dy = points[i * 2 + 1] - points[i * 2 - 1];
+			distance[i] = distance[i - 1] + sqrtf(dx * dx + dy * dy);
+		}
+		std::vector<float> knots(count + degree + 1, 0.0f);
+		for (int i = count; i < (int)knots.size(); i++) {
+			knots[i] = 1.0f;
+		}
+		// every inner knot averages the chord length of the degree points it sits between
+		float length = std::max(distance[count - 1], 1e-6f);
+		for (int i = 1; i < count - degree; i++) {
+			float sum = 0.0f;
+			for (int j = i; j < i + degree; j++) {
+				sum += distance[j];
+			}
+			knots[i + degree] = sum / degree / length;
+		}
+		return knots;
+	}
+
+	// @dev point of the curve with de Boor's algorithm
+	// @param u Parameter between knots degree and count
+	static void evaluate(const float* points, int count, int degree, const std::vector<float>& knots, float u, float* point) {
+		int span = findSpan(count, degree, knots, u);
+		blossom(points, degree, knots, span, std::vector<float>(degree, u), point);
+	}
+
+	// @dev the curve as Bezier segments, one per non empty span, with parameters from 0 to 1 over the
+	// whole curve. Control point j of a span's segment is the blossom at j copies of the span's end
+	// and degree - j copies of its start.
+	static void toBezier(const float* points, int count, int degree, const std::vector<float>& knots, std::vector<BezierPiece>& pieces) {
+		float first = knots[degree], last = knots[count];
+		float length = std::max(last - first, 1e-6f);
+		std::vector<float> arguments(degree);
+		for (int span = degree; span < count; span++) {
+			float start = knots[span], end = knots[span + 1];
+			if (end <= start) {
+				continue;
+			}
+			BezierPiece piece;
+			piece.x.resize(degree + 1);
+			piece.y.resize(degree + 1);
+			for (int j = 0; j <= degree; j++) {
+				for (int k = 0; k < degree; k++) {
+					arguments[k] = k < j ? end : start;
+				}
+				float point[2];
+				blossom(points, degree, knots, span, arguments, point);
+				piece.x[j] = point[0];
+				piece.y[j] = point[1];
+			}
+			piece.from = (start - first) / length;
+			piece.to = (end - first) / length;
+			pieces.push_back(piece);
+		}
+	}
+
+private:
+	// @dev span of the knot vector holding a parameter, clamped to the defined range
+	static int findSpan(int count, int degree, const std::vector<float>& knots, float u) {
+		int span = (int)(std::upper_bound(knots.begin() + degree, knots.begin() + count, u) - knots.begin()) - 1;
+		return std::max(degree, std::min(span, count - 1));
+	}
+
+	// @dev de Boor's algorithm with its own parameter on every level, the polar form of a span
+	// @param span Knot span, the control points span - degree to span take part
+	// @param arguments One parameter per level
+	static void blossom(const float* points, int degree, const std::vector<float>& knots, int span, const std::vector<float>& arguments, float* point) {
+		std::vector<float> x(degree + 1), y(degree + 1);
+		for (int j = 0; j <= degree; j++) {
+			x[j] = points[(span - degree + j) * 2];
+			y[j] = points[(span - degree + j) * 2 + 1];
+		}
+		for (int r = 1; r <= degree; r++) {
+			for (int j = degree; j >= r; j--) {
+				int i = span - degree + j;
+				float alpha = (arguments[r - 1] - knots[i]) / (knots[i + degree + 1 - r] - knots[i]);
+				x[j] = (1 - alpha) * x[j - 1] + alpha * x[j];
+				y[j] = (1 - alpha) * y[j - 1] + alpha * y[j];
+			}
+		}
+		point[0] = x[degree];
+		point[1] = y[degree];
+	}
+};
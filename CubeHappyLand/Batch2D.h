@@ -0,0 +1,259 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+// @dev vertex of the 2D tools, position and color as read by vertexShaderSource
+typedef struct Vertex2D {
+	float x, y, z;
+	float r, g, b;
+}Vertex2D;
+
+// @dev draw call of a recorded frame
+typedef struct Batch2DCall {
+	GLenum mode;
+	unsigned int program;
+	int first;
+	int count;
+}Batch2DCall;
+
+// @dev batches of a frame recorded on one thread and drawn on the thread owning the context
+typedef struct Batch2DFrame {
+	std::vector<Vertex2D> vertices;
+	std::vector<Batch2DCall> calls;
+}Batch2DFrame;
+
+// @dev Immediate mode renderer for the 2D tools. Primitives are appended to a batch on the CPU, the
+// batch is drawn with one call when the primitive type or the program changes, or at the end of the
+// frame. Batches are written into a persistent vertex buffer used as a ring: every batch goes behind
+// the previous one with an unsynchronized mapping, and once the ring is full its storage is orphaned
+// so the GPU keeps reading the old one while we start over at the front.
+// While recording, batches are closed into a frame instead of being drawn, takeFrame hands it to
+// another thread which draws it with drawFrame; collecting then needs no context at all.
+class Batch2D
+{
+private:
+	Batch2D() {
+		pending.reserve(CAPACITY);
+	}
+	~Batch2D() {
+		destroy();
+		delete instance;
+	}
+	// vertex array and ring buffer
+	unsigned int VAO = 0;
+	unsigned int VBO = 0;
+	// next free vertex of the ring
+	int head = 0;
+	// batch being collected
+	std::vector<Vertex2D> pending;
+	GLenum mode = GL_TRIANGLES;
+	unsigned int program = 0;
+	// statistics of the frame being drawn
+	int frameDrawCalls = 0;
+	int frameVertices = 0;
+	// batches closed while recording
+	Batch2DFrame recorded;
+public:
+	// vertices in the ring, a multiple of two and three so no batch splits a line or a triangle
+	static const int CAPACITY = 65532;
+	// statistics of the last frame
+	int drawCalls = 0;
+	int vertices = 0;
+	int orphans = 0;
+	// close batches into the recorded frame instead of drawing them
+	bool recording = false;
+
+	// @dev append a line segment
+	void line(const float* v1, const float* v2, const float* color, unsigned int shaderProgram) {
+		begin(GL_LINES, shaderProgram, 2);
+		vertex(v1[0], v1[1], color);
+		vertex(v2[0], v2[1], color);
+	}
+
+	// @dev append a triangle
+	void triangle(const float* v1, const float* v2, const float* v3, const float* color, unsigned int shaderProgram) {
+		begin(GL_TRIANGLES, shaderProgram, 3);
+		vertex(v1[0], v1[1], color);
+		vertex(v2[0], v2[1], color);
+		vertex(v3[0], v3[1], color);
+	}
+
+	// @dev append an axis aligned rectangle as two triangles
+	void rectangle(float left, float bottom, float right, float top, const float* color, unsigned int shaderProgram) {
+		begin(GL_TRIANGLES, shaderProgram, 6);
+		vertex(left, bottom, color);
+		vertex(left, top, color);
+		vertex(right, top, color);
+		vertex(left, bottom, color);
+		vertex(right, top, color);
+		vertex(right, bottom, color);
+	}
+
+	// @dev append a closed polyline as line segments so it joins the batch of other lines
+	// @param points Coordinates of the corners, x and y interleaved
+	// @param count Number of corners
+	void lineLoop(const float* points, int count, const float* color, unsigned int shaderProgram) {
+		for (int i = 0; i < count; i++) {
+			int next = (i + 1) % count;
+			line(points + i * 2, points + next * 2, color, shaderProgram);
+		}
+	}
+
+	// @dev append an open polyline as one line strip, strips cannot share a draw call so the batch in
+	// front of it is drawn first
+	// @param points Coordinates of the points, x and y interleaved
+	// @param count Number of points
+	void lineStrip(const float* points, int count, const float* color, unsigned int shaderProgram) {
+		int start = 0;
+		while (count - start >= 2) {
+			// strips longer than the ring are cut, the cut point starts the next part again
+			int length = count - start < CAPACITY ? count - start : CAPACITY;
+			flush();
+			mode = GL_LINE_STRIP;
+			program = shaderProgram;
+			for (int i = start; i < start + length; i++) {
+				vertex(points[i * 2], points[i * 2 + 1], color);
+			}
+			start += length - 1;
+		}
+	}
+
+	// @dev draw the batch collected so far, or close it into the recorded frame
+	void flush() {
+		int count = (int)pending.size();
+		if (count == 0) {
+			return;
+		}
+		if (recording) {
+			Batch2DCall call = { mode, program, (int)recorded.vertices.size(), count };
+			recorded.calls.push_back(call);
+			recorded.vertices.insert(recorded.vertices.end(), pending.begin(), pending.end());
+			pending.clear();
+			return;
+		}
+		draw(mode, program, pending.data(), count);
+		pending.clear();
+	}
+
+	// @dev draw what is left and publish the frame's statistics, called once per frame
+	void endFrame() {
+		flush();
+		publish();
+	}
+
+	// @dev close the batch collected so far and swap the recorded frame out, the frame given in
+	// is cleared and collects the next one
+	void takeFrame(Batch2DFrame& frame) {
+		flush();
+		std::swap(recorded, frame);
+		recorded.vertices.clear();
+		recorded.calls.clear();
+	}
+
+	// @dev draw a recorded frame and publish its statistics, needs the context
+	void drawFrame(const Batch2DFrame& frame) {
+		for (const Batch2DCall& call : frame.calls) {
+			draw(call.mode, call.program, &frame.vertices[call.first], call.count);
+		}
+		publish();
+	}
+
+	// @dev release the buffers
+	void destroy() {
+		if (VAO != 0) {
+			glDeleteVertexArrays(1, &VAO);
+			glDeleteBuffers(1, &VBO);
+		}
+		VAO = 0;
+		VBO = 0;
+		head = 0;
+		pending.clear();
+		recorded.vertices.clear();
+		recorded.calls.clear();
+	}
+
+	// makes Batch2D an instance
+	static Batch2D* getInstance() {
+		if (instance == NULL) {
+			instance = new Batch2D();
+		}
+		return instance;
+	}
+private:
+	static Batch2D* instance;
+
+	// @dev write vertices behind head of the ring and draw them
+	void draw(GLenum mode, unsigned int program, const Vertex2D* vertices, int count) {
+		if (VAO == 0) {
+			create();
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		if (head + count > CAPACITY) {
+			// full, let the driver hand out fresh storage instead of waiting for the GPU
+			glBufferData(GL_ARRAY_BUFFER, CAPACITY * sizeof(Vertex2D), NULL, GL_STREAM_DRAW);
+			head = 0;
+			orphans++;
+		}
+		// the range behind head has not been drawn from since the last orphan, no need to synchronize
+		void* target = glMapBufferRange(GL_ARRAY_BUFFER, head * sizeof(Vertex2D), count * sizeof(Vertex2D),
+			GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		if (target != nullptr) {
+			memcpy(target, vertices, count * sizeof(Vertex2D));
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		}
+		else {
+			glBufferSubData(GL_ARRAY_BUFFER, head * sizeof(Vertex2D), count * sizeof(Vertex2D), vertices);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glUseProgram(program);
+		glBindVertexArray(VAO);
+		glDrawArrays(mode, head, count);
+		glBindVertexArray(0);
+		head += count;
+		frameDrawCalls++;
+		frameVertices += count;
+	}
+
+	// @dev make the statistics of the drawn frame visible and start counting the next
+	void publish() {
+		drawCalls = frameDrawCalls;
+		vertices = frameVertices;
+		frameDrawCalls = 0;
+		frameVertices = 0;
+	}
+
+	// @dev start a primitive, the batch is drawn first if it cannot take it
+	// @param count Number of vertices of the primitive
+	void begin(GLenum primitive, unsigned int shaderProgram, int count) {
+		if (primitive != mode || shaderProgram != program || (int)pending.size() + count > CAPACITY) {
+			flush();
+			mode = primitive;
+			program = shaderProgram;
+		}
+	}
+
+	void vertex(float x, float y, const float* color) {
+		Vertex2D v = { x, y, 0.0f, color[0], color[1], color[2] };
+		pending.push_back(v);
+	}
+
+	// @dev allocate the ring and describe its layout
+	void create() {
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, CAPACITY * sizeof(Vertex2D), NULL, GL_STREAM_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex2D), (void*)0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex2D), (void*)(3 * sizeof(float)));
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+};
+
+Batch2D* Batch2D::instance = NULL;
@@ -0,0 +1,187 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BEZIER_SSE2
+#include <emmintrin.h>
+#endif
+
+// @dev one Bezier segment of a curve, its degree is one less than the number of control points
+typedef struct BezierPiece {
+	std::vector<float> x;
+	std::vector<float> y;
+	// parameters of the segment's ends on the whole curve
+	float from;
+	float to;
+}BezierPiece;
+
+// @dev Operations on single Bezier segments of any degree. Distances are measured in pixels, a
+// scale turns normalized device coordinates into them.
+class Bezier
+{
+public:
+	// @dev point of a segment with de Casteljau's algorithm, O(n^2) but exact for any degree
+	// @param u Parameter on the segment
+	// @param point X and y of the point
+	static void evaluate(const BezierPiece& piece, float u, float* point) {
+		std::vector<float> x = piece.x, y = piece.y;
+		for (int n = (int)x.size() - 1; n > 0; n--) {
+			for (int i = 0; i < n; i++) {
+				x[i] = (1 - u) * x[i] + u * x[i + 1];
+				y[i] = (1 - u) * y[i] + u * y[i + 1];
+			}
+		}
+		point[0] = x.empty() ? 0.0f : x[0];
+		point[1] = y.empty() ? 0.0f : y[0];
+	}
+
+	// @dev split a segment in half with de Casteljau's algorithm
+	static void split(const BezierPiece& piece, BezierPiece& left, BezierPiece& right) {
+		int degree = (int)piece.x.size() - 1;
+		std::vector<float> x = piece.x, y = piece.y;
+		left.x.resize(degree + 1);
+		left.y.resize(degree + 1);
+		right.x.resize(degree + 1);
+		right.y.resize(degree + 1);
+		for (int n = degree; n >= 0; n--) {
+			// the first and last point of every level are control points of the halves
+			left.x[degree - n] = x[0];
+			left.y[degree - n] = y[0];
+			right.x[n] = x[n];
+			right.y[n] = y[n];
+			for (int i = 0; i < n; i++) {
+				x[i] = (x[i] + x[i + 1]) * 0.5f;
+				y[i] = (y[i] + y[i + 1]) * 0.5f;
+			}
+		}
+		float middle = (piece.from + piece.to) * 0.5f;
+		left.from = piece.from;
+		left.to = middle;
+		right.from = middle;
+		right.to = piece.to;
+	}
+
+	// @dev segments a piece needs to stay within a tolerance, from Wang's formula
+	// n(n-1)/8 * max|P(i+2) - 2P(i+1) + P(i)| / tolerance
+	static int segmentsFor(const BezierPiece& piece, float scaleX, float scaleY, float tolerance) {
+		int degree = (int)piece.x.size() - 1;
+		if (degree < 2) {
+			return 1;
+		}
+		float bend = 0.0f;
+		for (int i = 0; i + 2 <= degree; i++) {
+			float dx = (piece.x[i + 2] - 2 * piece.x[i + 1] + piece.x[i]) * scaleX;
+			float dy = (piece.y[i + 2] - 2 * piece.y[i + 1] + piece.y[i]) * scaleY;
+			bend = std::max(bend, sqrtf(dx * dx + dy * dy));
+		}
+		float segments = ceilf(sqrtf(degree * (degree - 1) * bend / (8.0f * tolerance)));
+		return std::max(1, (int)std::min(segments, 1e6f));
+	}
+
+	// @dev lower the degree of a segment to a cubic keeping its ends and the tangents there, the
+	// cubic's inner control points sit a third of the way along the end tangents
+	// @param error Largest distance between the curves, from the control points of the cubic raised
+	// back to the original degree
+	// @return The cubic segment
+	static BezierPiece reduce(const BezierPiece& piece, float scaleX, float scaleY, float& error) {
+		int n = (int)piece.x.size() - 1;
+		double third = n / 3.0;
+		std::vector<double> x = {
+			piece.x[0], piece.x[0] + third * (piece.x[1] - piece.x[0]), piece.x[n] - third * (piece.x[n] - piece.x[n - 1]), piece.x[n]
+		};
+		std::vector<double> y = {
+			piece.y[0], piece.y[0] + third * (piece.y[1] - piece.y[0]), piece.y[n] - third * (piece.y[n] - piece.y[n - 1]), piece.y[n]
+		};
+		std::vector<double> raisedX = x, raisedY = y;
+		while (raisedX.size() < piece.x.size()) {
+			elevate(raisedX);
+			elevate(raisedY);
+		}
+		// the difference of the curves lies in the hull of the differences of their control points
+		error = 0.0f;
+		for (int i = 0; i <= n; i++) {
+			double dx = (raisedX[i] - piece.x[i]) * scaleX;
+			double dy = (raisedY[i] - piece.y[i]) * scaleY;
+			error = std::max(error, (float)sqrt(dx * dx + dy * dy));
+		}
+		BezierPiece reduced = { std::vector<float>(x.begin(), x.end()), std::vector<float>(y.begin(), y.end()), piece.from, piece.to };
+		return reduced;
+	}
+
+	// @dev binomial coefficients C(n, i) of a degree
+	static std::vector<float> binomials(int degree) {
+		std::vector<float> binomial(degree + 1);
+		binomial[0] = 1.0f;
+		for (int i = 1; i <= degree; i++) {
+			binomial[i] = binomial[i - 1] * (float)(degree - i + 1) / (float)i;
+		}
+		return binomial;
+	}
+
+	// @dev evaluate a segment at four parameters, sum of C(n,i) u^i (1-u)^(n-i) P(i), meant for the
+	// low degrees of flattened pieces
+	// @param binomial Binomial coefficients of the segment's degree
+	// @param u Parameters on the segment
+	// @param px X of the points
+	// @param py Y of the points
+	static void bernstein(const BezierPiece& piece, const std::vector<float>& binomial, const float* u, float* px, float* py) {
+		int degree = (int)piece.x.size() - 1;
+		// four powers of u per degree
+		float powers[4 * (MAX_BERNSTEIN_DEGREE + 1)];
+#ifdef BEZIER_SSE2
+		__m128 s = _mm_loadu_ps(u);
+		__m128 r = _mm_sub_ps(_mm_set1_ps(1.0f), s);
+		__m128 power = _mm_set1_ps(1.0f);
+		for (int i = 0; i <= degree; i++) {
+			_mm_storeu_ps(powers + i * 4, power);
+			power = _mm_mul_ps(power, s);
+		}
+		// (1-u)^(n-i) grows while i walks down
+		__m128 complement = _mm_set1_ps(1.0f);
+		__m128 sumX = _mm_setzero_ps(), sumY = _mm_setzero_ps();
+		for (int i = degree; i >= 0; i--) {
+			__m128 weight = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(binomial[i]), _mm_loadu_ps(powers + i * 4)), complement);
+			sumX = _mm_add_ps(sumX, _mm_mul_ps(weight, _mm_set1_ps(piece.x[i])));
+			sumY = _mm_add_ps(sumY, _mm_mul_ps(weight, _mm_set1_ps(piece.y[i])));
+			complement = _mm_mul_ps(complement, r);
+		}
+		_mm_storeu_ps(px, sumX);
+		_mm_storeu_ps(py, sumY);
+#else
+		for (int lane = 0; lane < 4; lane++) {
+			powers[0] = 1.0f;
+			for (int i = 1; i <= degree; i++) {
+				powers[i] = powers[i - 1] * u[lane];
+			}
+			float complement = 1.0f, sumX = 0.0f, sumY = 0.0f;
+			for (int i = degree; i >= 0; i--) {
+				float weight = binomial[i] * powers[i] * complement;
+				sumX += weight * piece.x[i];
+				sumY += weight * piece.y[i];
+				complement *= 1.0f - u[lane];
+			}
+			px[lane] = sumX;
+			py[lane] = sumY;
+		}
+#endif
+	}
+
+	// pieces above this degree are reduced before they are evaluated in the Bernstein basis
+	static const int MAX_BERNSTEIN_DEGREE = 8;
+
+private:
+	// @dev raise the degree by one without changing the curve
+	static void elevate(std::vector<double>& p) {
+		int n = (int)p.size() - 1;
+		std::vector<double> raised(n + 2);
+		raised[0] = p[0];
+		raised[n + 1] = p[n];
+		for (int i = 1; i <= n; i++) {
+			double a = (double)i / (n + 1);
+			raised[i] = a * p[i - 1] + (1 - a) * p[i];
+		}
+		p = raised;
+	}
+};
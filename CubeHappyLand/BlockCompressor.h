@@ -0,0 +1,238 @@
+#pragma once
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCK_COMPRESSOR_SSE2
+#include <emmintrin.h>
+#endif
+
+// @dev Real time encoder for 4x4 texel blocks.
+//   - BC1 (DXT1): two 565 endpoints and 2 bit indices, 8 bytes per block
+//   - BC4 (RGTC1): two 8 bit endpoints and 3 bit indices for a single channel, 8 bytes per block
+//   - BC3 (DXT5): a BC4 style alpha block followed by a BC1 color block, 16 bytes per block
+// Endpoints are fitted to the inset bounding box of the block with the diagonal picked by the sign
+// of the channel covariances, indices come from projecting every texel onto the endpoint axis. The
+// bounding box and the projection run on SSE2 when available.
+class BlockCompressor
+{
+public:
+	// @dev encode a block of 16 RGBA texels into BC1, alpha is ignored
+	// @param block Texels in row major order
+	// @param out 8 bytes
+	static void encodeBC1(const unsigned char* block, unsigned char* out) {
+		unsigned char low[4], high[4];
+		boundingBox(block, low, high);
+		pickDiagonal(block, low, high);
+		// pull the endpoints in a little, extremes are rarely hit by more than one texel
+		for (int c = 0; c < 3; c++) {
+			int inset = (high[c] - low[c]) / 16;
+			high[c] = (unsigned char)(high[c] - inset);
+			low[c] = (unsigned char)(low[c] + inset);
+		}
+		unsigned short color0 = to565(high);
+		unsigned short color1 = to565(low);
+		// four color mode needs color0 > color1
+		if (color0 < color1) {
+			unsigned short swap = color0;
+			color0 = color1;
+			color1 = swap;
+		}
+		unsigned int indices = 0;
+		if (color0 != color1) {
+			unsigned char end0[4], end1[4];
+			from565(color0, end0);
+			from565(color1, end1);
+			indices = selectIndices(block, end0, end1);
+		}
+		out[0] = (unsigned char)(color0 & 0xFF);
+		out[1] = (unsigned char)(color0 >> 8);
+		out[2] = (unsigned char)(color1 & 0xFF);
+		out[3] = (unsigned char)(color1 >> 8);
+		out[4] = (unsigned char)(indices & 0xFF);
+		out[5] = (unsigned char)((indices >> 8) & 0xFF);
+		out[6] = (unsigned char)((indices >> 16) & 0xFF);
+		out[7] = (unsigned char)(indices >> 24);
+	}
+
+	// @dev encode one channel of 16 texels into BC4
+	// @param values First value of the block
+	// @param stride Bytes between two values
+	// @param out 8 bytes
+	static void encodeBC4(const unsigned char* values, int stride, unsigned char* out) {
+		unsigned char v[16];
+		for (int i = 0; i < 16; i++) {
+			v[i] = values[i * stride];
+		}
+		unsigned char low, high;
+		range(v, low, high);
+		// eight value mode needs the first endpoint to be the larger one
+		out[0] = high;
+		out[1] = low;
+		unsigned long long indices = 0;
+		if (high != low) {
+			float scale = 7.0f / (float)(high - low);
+			for (int i = 0; i < 16; i++) {
+				int step = (int)((v[i] - low) * scale + 0.5f);
+				// step 7 is the first endpoint, step 0 the second, interpolated values run backwards
+				unsigned long long index = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+				indices |= index << (3 * i);
+			}
+		}
+		for (int i = 0; i < 6; i++) {
+			out[2 + i] = (unsigned char)((indices >> (8 * i)) & 0xFF);
+		}
+	}
+
+	// @dev encode a block of 16 RGBA texels into BC3
+	// @param out 16 bytes
+	static void encodeBC3(const unsigned char* block, unsigned char* out) {
+		encodeBC4(block + 3, 4, out);
+		encodeBC1(block, out + 8);
+	}
+
+private:
+	// @dev pack a color into 5:6:5 bits with rounding
+	static unsigned short to565(const unsigned char* color) {
+		return (unsigned short)(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | ((color[2] * 31 + 127) / 255));
+	}
+
+	// @dev expand a 5:6:5 color the way the decoder does
+	static void from565(unsigned short color, unsigned char* out) {
+		int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+		out[0] = (unsigned char)((r << 3) | (r >> 2));
+		out[1] = (unsigned char)((g << 2) | (g >> 4));
+		out[2] = (unsigned char)((b << 3) | (b >> 2));
+		out[3] = 255;
+	}
+
+	// @dev per channel minimum and maximum of a block
+	static void boundingBox(const unsigned char* block, unsigned char* low, unsigned char* high) {
+#ifdef BLOCK_COMPRESSOR_SSE2
+		__m128i p0 = _mm_loadu_si128((const __m128i*)block);
+		__m128i p1 = _mm_loadu_si128((const __m128i*)(block + 16));
+		__m128i p2 = _mm_loadu_si128((const __m128i*)(block + 32));
+		__m128i p3 = _mm_loadu_si128((const __m128i*)(block + 48));
+		__m128i minimum = _mm_min_epu8(_mm_min_epu8(p0, p1), _mm_min_epu8(p2, p3));
+		__m128i maximum = _mm_max_epu8(_mm_max_epu8(p0, p1), _mm_max_epu8(p2, p3));
+		// fold the four texels of a register onto the first one
+		minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 8));
+		minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 4));
+		maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 8));
+		maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 4));
+		int packedLow = _mm_cvtsi128_si32(minimum);
+		int packedHigh = _mm_cvtsi128_si32(maximum);
+		memcpy(low, &packedLow, 4);
+		memcpy(high, &packedHigh, 4);
+#else
+		for (int c = 0; c < 4; c++) {
+			low[c] = 255;
+			high[c] = 0;
+		}
+		for (int i = 0; i < 16; i++) {
+			for (int c = 0; c < 4; c++) {
+				unsigned char v = block[i * 4 + c];
+				low[c] = v < low[c] ? v : low[c];
+				high[c] = v > high[c] ? v : high[c];
+			}
+		}
+#endif
+	}
+
+	// @dev minimum and maximum of 16 values
+	static void range(const unsigned char* v, unsigned char& low, unsigned char& high) {
+#ifdef BLOCK_COMPRESSOR_SSE2
+		__m128i values = _mm_loadu_si128((const __m128i*)v);
+		// fold the 16 values onto the first byte
+		__m128i minimum = _mm_min_epu8(values, _mm_srli_si128(values, 8));
+		__m128i maximum = _mm_max_epu8(values, _mm_srli_si128(values, 8));
+		minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 4));
+		maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 4));
+		minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 2));
+		maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 2));
+		minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 1));
+		maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 1));
+		low = (unsigned char)(_mm_cvtsi128_si32(minimum) & 0xFF);
+		high = (unsigned char)(_mm_cvtsi128_si32(maximum) & 0xFF);
+#else
+		low = 255;
+		high = 0;
+		for (int i = 0; i < 16; i++) {
+			low = v[i] < low ? v[i] : low;
+			high = v[i] > high ? v[i] : high;
+		}
+#endif
+	}
+
+	// @dev the box diagonal from low to high only fits blocks whose channels rise together, swap the
+	// red and blue bounds when they fall as green rises
+	static void pickDiagonal(const unsigned char* block, unsigned char* low, unsigned char* high) {
+		int center[3];
+		for (int c = 0; c < 3; c++) {
+			center[c] = (low[c] + high[c]) / 2;
+		}
+		int redGreen = 0, blueGreen = 0;
+		for (int i = 0; i < 16; i++) {
+			int g = block[i * 4 + 1] - center[1];
+			redGreen += (block[i * 4] - center[0]) * g;
+			blueGreen += (block[i * 4 + 2] - center[2]) * g;
+		}
+		if (redGreen < 0) {
+			unsigned char swap = low[0];
+			low[0] = high[0];
+			high[0] = swap;
+		}
+		if (blueGreen < 0) {
+			unsigned char swap = low[2];
+			low[2] = high[2];
+			high[2] = swap;
+		}
+	}
+
+	// @dev pick for every texel the closest of the four colors on the line between the endpoints
+	// @return 2 bit indices, texel i at bit 2i
+	static unsigned int selectIndices(const unsigned char* block, const unsigned char* end0, const unsigned char* end1) {
+		// position along the axis in thirds, 0 at end1 and 3 at end0, to BC1 index
+		static const unsigned int order[4] = { 1, 3, 2, 0 };
+		int axis[3] = { end0[0] - end1[0], end0[1] - end1[1], end0[2] - end1[2] };
+		int length = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		float scale = length == 0 ? 0.0f : 3.0f / (float)length;
+		unsigned int indices = 0;
+#ifdef BLOCK_COMPRESSOR_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i origin = _mm_setr_epi16(end1[0], end1[1], end1[2], 0, end1[0], end1[1], end1[2], 0);
+		const __m128i direction = _mm_setr_epi16(axis[0], axis[1], axis[2], 0, axis[0], axis[1], axis[2], 0);
+		const __m128 factor = _mm_set1_ps(scale);
+		const __m128 half = _mm_set1_ps(0.5f);
+		for (int i = 0; i < 4; i++) {
+			// four texels per iteration, widened to 16 bits and moved to the origin
+			__m128i texels = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+			__m128i first = _mm_sub_epi16(_mm_unpacklo_epi8(texels, zero), origin);
+			__m128i second = _mm_sub_epi16(_mm_unpackhi_epi8(texels, zero), origin);
+			// partial dot products, red * x + green * y and blue * z per texel
+			__m128 partFirst = _mm_castsi128_ps(_mm_madd_epi16(first, direction));
+			__m128 partSecond = _mm_castsi128_ps(_mm_madd_epi16(second, direction));
+			__m128i even = _mm_castps_si128(_mm_shuffle_ps(partFirst, partSecond, _MM_SHUFFLE(2, 0, 2, 0)));
+			__m128i odd = _mm_castps_si128(_mm_shuffle_ps(partFirst, partSecond, _MM_SHUFFLE(3, 1, 3, 1)));
+			__m128i dots = _mm_add_epi32(even, odd);
+			__m128 steps = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(dots), factor), half);
+			// truncate, saturate to 16 bits and clamp to 0..3
+			__m128i clamped = _mm_packs_epi32(_mm_cvttps_epi32(_mm_max_ps(steps, _mm_setzero_ps())), zero);
+			clamped = _mm_min_epi16(clamped, _mm_set1_epi16(3));
+			unsigned short step[8];
+			_mm_storeu_si128((__m128i*)step, clamped);
+			for (int j = 0; j < 4; j++) {
+				indices |= order[step[j]] << (2 * (i * 4 + j));
+			}
+		}
+#else
+		for (int i = 0; i < 16; i++) {
+			const unsigned char* texel = block + i * 4;
+			int dot = (texel[0] - end1[0]) * axis[0] + (texel[1] - end1[1]) * axis[1] + (texel[2] - end1[2]) * axis[2];
+			int step = (int)(dot * scale + 0.5f);
+			step = step < 0 ? 0 : step > 3 ? 3 : step;
+			indices |= order[step] << (2 * i);
+		}
+#endif
+		return indices;
+	}
+};
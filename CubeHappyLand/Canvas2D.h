@@ -0,0 +1,169 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include "Bezier.h"
+#include "QuadTree.h"
+#include "Rasterizer.h"
+
+enum CanvasShapeType { CANVAS_NONE, CANVAS_LINE, CANVAS_CIRCLE, CANVAS_TRIANGLE, CANVAS_POLYLINE };
+
+// @dev shape of a Canvas2D, its points are in the canvas' point array
+typedef struct CanvasShape {
+	CanvasShapeType type;
+	// packed with Rasterizer::rgba
+	uint32_t color;
+	QuadBounds bounds;
+	// first point and number of points, a circle has its center only
+	int first;
+	int count;
+	float radius;
+}CanvasShape;
+
+// @dev Drawing of the 2D canvas in world units, y up. Shapes are indexed by their bounds in a
+// quadtree so a view only visits the shapes of the area it draws. Every change records the bounds it
+// touched in changes, CanvasView takes them to find the tiles that have to be drawn again.
+// Removed shapes keep their slot so ids stay valid.
+class Canvas2D
+{
+public:
+	std::vector<CanvasShape> shapes;
+	// x and y interleaved
+	std::vector<float> points;
+	QuadTree index;
+	// areas changed since the view last looked
+	std::vector<QuadBounds> changes;
+
+	// @param extent Half the edge of the square the quadtree divides, shapes may lie outside
+	Canvas2D(float extent = 1024.0f) : extent(extent) {
+		clear();
+	}
+	~Canvas2D() {}
+
+	// @dev remove every shape
+	void clear() {
+		shapes.clear();
+		points.clear();
+		index.reset({ -extent, -extent, extent, extent });
+		changes.clear();
+		// everything may have been drawn
+		changes.push_back({ -INFINITY, -INFINITY, INFINITY, INFINITY });
+		live = 0;
+	}
+
+	// @return Id of the shape
+	int line(float x0, float y0, float x1, float y1, uint32_t color) {
+		float xy[4] = { x0, y0, x1, y1 };
+		return add(CANVAS_LINE, xy, 2, 0.0f, color);
+	}
+
+	int circle(float x, float y, float radius, uint32_t color) {
+		float xy[2] = { x, y };
+		return add(CANVAS_CIRCLE, xy, 1, fabsf(radius), color);
+	}
+
+	int triangle(float x0, float y0, float x1, float y1, float x2, float y2, uint32_t color) {
+		float xy[6] = { x0, y0, x1, y1, x2, y2 };
+		return add(CANVAS_TRIANGLE, xy, 3, 0.0f, color);
+	}
+
+	// @dev open polyline, curves are added flattened
+	// @param xy X and y interleaved
+	int polyline(const float* xy, int count, uint32_t color) {
+		return add(CANVAS_POLYLINE, xy, count, 0.0f, color);
+	}
+
+	void remove(int id) {
+		if (id < 0 || id >= (int)shapes.size() || shapes[id].type == CANVAS_NONE) {
+			return;
+		}
+		index.remove(id, shapes[id].bounds);
+		changes.push_back(shapes[id].bounds);
+		shapes[id].type = CANVAS_NONE;
+		live--;
+	}
+
+	// @return Number of shapes not removed
+	int size() const {
+		return live;
+	}
+
+	// @dev append the ids of the shapes whose bounds overlap an area
+	void query(const QuadBounds& area, std::vector<int>& result) const {
+		index.query(area, result);
+	}
+
+	// @dev fill an area with random lines, circles, triangles and cubic curves, for trying the view
+	// on large drawings
+	// @param count Number of shapes
+	// @param half Half the edge of the square they are spread over
+	void scatter(int count, float half, unsigned int seed) {
+		srand(seed);
+		BezierPiece cubic;
+		cubic.x.resize(4);
+		cubic.y.resize(4);
+		cubic.from = 0.0f;
+		cubic.to = 1.0f;
+		float curve[2 * 17];
+		for (int i = 0; i < count; i++) {
+			float x = random(-half, half), y = random(-half, half), size = random(0.2f, 4.0f);
+			uint32_t color = Rasterizer::rgba(random(0.3f, 1.0f), random(0.3f, 1.0f), random(0.3f, 1.0f));
+			switch (i % 4) {
+			case 0:
+				line(x, y, x + random(-size, size), y + random(-size, size), color);
+				break;
+			case 1:
+				circle(x, y, size * 0.5f, color);
+				break;
+			case 2:
+				triangle(x, y, x + random(-size, size), y + random(-size, size), x + random(-size, size), y + random(-size, size), color);
+				break;
+			default:
+				for (int k = 0; k < 4; k++) {
+					cubic.x[k] = x + random(-size, size);
+					cubic.y[k] = y + random(-size, size);
+				}
+				for (int k = 0; k <= 16; k++) {
+					Bezier::evaluate(cubic, k / 16.0f, &curve[k * 2]);
+				}
+				polyline(curve, 17, color);
+				break;
+			}
+		}
+	}
+
+private:
+	float extent;
+	int live = 0;
+
+	int add(CanvasShapeType type, const float* xy, int count, float radius, uint32_t color) {
+		if (count <= 0) {
+			return -1;
+		}
+		CanvasShape shape;
+		shape.type = type;
+		shape.color = color;
+		shape.first = (int)points.size() / 2;
+		shape.count = count;
+		shape.radius = radius;
+		shape.bounds = { xy[0] - radius, xy[1] - radius, xy[0] + radius, xy[1] + radius };
+		for (int i = 0; i < count; i++) {
+			shape.bounds.minX = std::min(shape.bounds.minX, xy[i * 2] - radius);
+			shape.bounds.minY = std::min(shape.bounds.minY, xy[i * 2 + 1] - radius);
+			shape.bounds.maxX = std::max(shape.bounds.maxX, xy[i * 2] + radius);
+			shape.bounds.maxY = std::max(shape.bounds.maxY, xy[i * 2 + 1] + radius);
+		}
+		points.insert(points.end(), xy, xy + count * 2);
+		int id = (int)shapes.size();
+		shapes.push_back(shape);
+		index.insert(id, shape.bounds);
+		changes.push_back(shape.bounds);
+		live++;
+		return id;
+	}
+
+	static float random(float low, float high) {
+		return low + (high - low) * (float)rand() / (float)RAND_MAX;
+	}
+};
@@ -0,0 +1,410 @@
+#pragma once
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Canvas2D.h"
+#include "Rasterizer.h"
+#include "Shader.h"
+#include "ShaderCode.h"
+
+// @dev tiles and quads of a frame, prepared by CanvasView::update and drawn by CanvasView::submit
+typedef struct CanvasFrame {
+	// atlas slot of every tile rasterized and its pixels
+	std::vector<int> slots;
+	std::vector<std::vector<uint32_t>> tiles;
+	// position and texture coordinate of the quads
+	std::vector<float> quads;
+}CanvasFrame;
+
+// @dev Pan and zoom view of a Canvas2D drawn from cached tiles. The world is cut into squares of TILE
+// pixels at the power of two scale closest to the zoom, so one level of tiles covers zooms from 0.7
+// to 1.4 times its scale. A tile is rasterized once with the shapes the quadtree finds in it, kept in
+// a slot of a texture atlas and drawn as a quad until a change of the canvas overlaps it. The least
+// recently drawn slot is taken for a new tile. At most tileBudget tiles are rasterized per frame,
+// tiles still missing show their parent or children from the neighbouring levels, so panning only
+// pays for the tiles coming into view and zooming fills in over a few frames.
+// Rasterizing and placing the quads need no context, update does them and submit uploads the tiles
+// and draws, so the two can run on different threads.
+class CanvasView
+{
+public:
+	static const int TILE = 256;
+	static const int ATLAS_COLUMNS = 16;
+	static const int ATLAS_ROWS = 8;
+	static const int MIN_LEVEL = -8;
+	static const int MAX_LEVEL = 12;
+
+	// world point at the center of the viewport
+	float centerX = 0.0f;
+	float centerY = 0.0f;
+	// pixels per world unit
+	float zoom = 4.0f;
+	// tiles rasterized per frame at most
+	int tileBudget = 8;
+
+	// statistics of the last frame
+	int visibleTiles = 0;
+	int rasterizedTiles = 0;
+	int missingTiles = 0;
+	long long shapesDrawn = 0;
+
+	CanvasView() {}
+	~CanvasView() {}
+
+	// @dev move the view by a distance on screen
+	void pan(float dx, float dy) {
+		centerX -= dx / zoom;
+		centerY -= dy / zoom;
+	}
+
+	// @dev zoom keeping the world point under a pixel in place
+	// @param x, y Pixel from the bottom left of the viewport
+	void zoomAt(float factor, float x, float y, int width, int height) {
+		float before[2], after[2];
+		toWorld(x, y, width, height, before);
+		zoom = std::max(ldexpf(1.0f, MIN_LEVEL), std::min(zoom * factor, ldexpf(1.0f, MAX_LEVEL)));
+		toWorld(x, y, width, height, after);
+		centerX += before[0] - after[0];
+		centerY += before[1] - after[1];
+	}
+
+	// @dev world point under a pixel
+	// @param x, y Pixel from the bottom left of the viewport
+	void toWorld(float x, float y, int width, int height, float* world) const {
+		world[0] = centerX + (x - width * 0.5f) / zoom;
+		world[1] = centerY + (y - height * 0.5f) / zoom;
+	}
+
+	// @dev bring the tiles in view up to date and draw them over the viewport
+	void draw(Canvas2D& canvas, int width, int height) {
+		update(canvas, width, height, current);
+		submit(current);
+	}
+
+	// @dev rasterize the stale tiles in view and place the quads of the frame
+	// @param out Cleared and filled with the tiles to upload and the quads to draw
+	void update(Canvas2D& canvas, int width, int height, CanvasFrame& out) {
+		out.slots.clear();
+		out.quads.clear();
+		if (width <= 0 || height <= 0) {
+			return;
+		}
+		if (slots.empty()) {
+			TileSlot empty = { 0, 0, 0, 0, false };
+			slots.assign(ATLAS_COLUMNS * ATLAS_ROWS, empty);
+			raster.resize(TILE, TILE);
+		}
+		frame++;
+		invalidate(canvas);
+		rasterizedTiles = 0;
+		missingTiles = 0;
+		visibleTiles = 0;
+		filling = &out;
+
+		int level = levelFor(zoom);
+		float scale = ldexpf(1.0f, level), size = TILE / scale;
+		float halfWidth = width * 0.5f / zoom, halfHeight = height * 0.5f / zoom;
+		int firstX = (int)floor((centerX - halfWidth) / size), lastX = (int)floor((centerX + halfWidth) / size);
+		int firstY = (int)floor((centerY - halfHeight) / size), lastY = (int)floor((centerY + halfHeight) / size);
+		for (int ty = firstY; ty <= lastY; ty++) {
+			for (int tx = firstX; tx <= lastX; tx++) {
+				visibleTiles++;
+				int slot = find(level, tx, ty);
+				bool stale = slot < 0 || slots[slot].dirty;
+				if (stale && rasterizedTiles < tileBudget) {
+					if (slot < 0) {
+						slot = evict();
+					}
+					if (slot >= 0) {
+						render(canvas, slot, level, tx, ty, out);
+						rasterizedTiles++;
+						stale = false;
+					}
+				}
+				if (slot >= 0) {
+					// a dirty tile out of budget still shows its old content
+					use(slot, level, tx, ty, 0.0f, 0.0f, 1.0f, 1.0f, width, height);
+				}
+				if (stale) {
+					missingTiles++;
+					if (slot < 0) {
+						fallback(level, tx, ty, width, height);
+					}
+				}
+			}
+		}
+		filling = nullptr;
+	}
+
+	// @dev upload the tiles of a frame into the atlas and draw its quads, needs the context
+	void submit(const CanvasFrame& frame) {
+		if (program == nullptr) {
+			create();
+		}
+		if (!frame.slots.empty()) {
+			glBindTexture(GL_TEXTURE_2D, atlas);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			for (size_t i = 0; i < frame.slots.size(); i++) {
+				int slot = frame.slots[i];
+				glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % ATLAS_COLUMNS) * TILE, (slot / ATLAS_COLUMNS) * TILE, TILE, TILE, GL_RGBA, GL_UNSIGNED_BYTE, frame.tiles[i].data());
+			}
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+		present(frame.quads);
+	}
+
+	// @dev release the atlas and the program, cached tiles are forgotten
+	void destroy() {
+		if (program != nullptr) {
+			glDeleteTextures(1, &atlas);
+			glDeleteBuffers(1, &VBO);
+			glDeleteVertexArrays(1, &VAO);
+			glDeleteProgram(program->ID);
+			delete program;
+		}
+		program = nullptr;
+		slots.clear();
+		lookup.clear();
+	}
+
+	// @return Number of tiles in the atlas
+	int cachedTiles() const {
+		return (int)lookup.size();
+	}
+
+private:
+	typedef struct TileSlot {
+		int level, x, y;
+		// frame the tile was last drawn in, 0 for an empty slot
+		long long lastUsed;
+		bool dirty;
+	}TileSlot;
+
+	Shader* program = nullptr;
+	unsigned int atlas = 0;
+	unsigned int VAO = 0, VBO = 0;
+	std::vector<TileSlot> slots;
+	std::unordered_map<uint64_t, int> lookup;
+	long long frame = 0;
+	// frame being filled by update
+	CanvasFrame* filling = nullptr;
+	// frame of draw
+	CanvasFrame current;
+	Rasterizer raster;
+	std::vector<int> found;
+
+	static int levelFor(float zoom) {
+		int level = (int)floor(log2f(zoom) + 0.5f);
+		return std::max(MIN_LEVEL, std::min(level, MAX_LEVEL));
+	}
+
+	static uint64_t key(int level, int x, int y) {
+		return (uint64_t)(uint32_t)(level - MIN_LEVEL) << 56 | (uint64_t)((uint32_t)x & 0x0fffffff) << 28 | ((uint32_t)y & 0x0fffffff);
+	}
+
+	// @dev world square of a tile
+	static QuadBounds tileBounds(int level, int x, int y) {
+		float size = TILE / ldexpf(1.0f, level);
+		return { x * size, y * size, (x + 1) * size, (y + 1) * size };
+	}
+
+	int find(int level, int x, int y) const {
+		std::unordered_map<uint64_t, int>::const_iterator found = lookup.find(key(level, x, y));
+		return found == lookup.end() ? -1 : found->second;
+	}
+
+	void create() {
+		program = new Shader(canvas_vertex, canvas_fragment);
+		glGenTextures(1, &atlas);
+		glBindTexture(GL_TEXTURE_2D, atlas);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, ATLAS_COLUMNS * TILE, ATLAS_ROWS * TILE, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// @dev mark the cached tiles overlapping the changes of the canvas, a tile also holds the
+	// pixels of shapes reaching a pixel into it
+	void invalidate(Canvas2D& canvas) {
+		if (canvas.changes.empty()) {
+			return;
+		}
+		// many changes, as after adding a batch of shapes, are merged into their union
+		if (canvas.changes.size() > 64) {
+			QuadBounds all = canvas.changes[0];
+			for (const QuadBounds& change : canvas.changes) {
+				all = { std::min(all.minX, change.minX), std::min(all.minY, change.minY), std::max(all.maxX, change.maxX), std::max(all.maxY, change.maxY) };
+			}
+			canvas.changes.assign(1, all);
+		}
+		for (TileSlot& slot : slots) {
+			if (slot.lastUsed == 0 || slot.dirty) {
+				continue;
+			}
+			QuadBounds bounds = tileBounds(slot.level, slot.x, slot.y);
+			float pixel = 1.0f / ldexpf(1.0f, slot.level);
+			bounds = { bounds.minX - pixel, bounds.minY - pixel, bounds.maxX + pixel, bounds.maxY + pixel };
+			for (const QuadBounds& change : canvas.changes) {
+				if (overlaps(bounds, change)) {
+					slot.dirty = true;
+					break;
+				}
+			}
+		}
+		canvas.changes.clear();
+	}
+
+	// @dev least recently used slot not drawn this frame, -1 if every slot is in view
+	int evict() {
+		int oldest = -1;
+		for (int i = 0; i < (int)slots.size(); i++) {
+			if (slots[i].lastUsed < frame && (oldest < 0 || slots[i].lastUsed < slots[oldest].lastUsed)) {
+				oldest = i;
+			}
+		}
+		if (oldest >= 0 && slots[oldest].lastUsed != 0) {
+			lookup.erase(key(slots[oldest].level, slots[oldest].x, slots[oldest].y));
+		}
+		return oldest;
+	}
+
+	// @dev rasterize a tile for a slot of the atlas, its pixels are added to the frame
+	void render(const Canvas2D& canvas, int slot, int level, int tx, int ty, CanvasFrame& out) {
+		TileSlot& tile = slots[slot];
+		if (tile.lastUsed == 0 || tile.level != level || tile.x != tx || tile.y != ty) {
+			lookup[key(level, tx, ty)] = slot;
+		}
+		tile.level = level;
+		tile.x = tx;
+		tile.y = ty;
+		tile.dirty = false;
+		tile.lastUsed = frame;
+
+		double scale = ldexp(1.0, level);
+		// pixels of the whole level, the tile starts at a whole pixel so shapes crossing tiles meet
+		double originX = (double)tx * TILE, originY = (double)ty * TILE;
+		QuadBounds bounds = tileBounds(level, tx, ty);
+		float pixel = (float)(1.0 / scale);
+		found.clear();
+		canvas.query({ bounds.minX - pixel, bounds.minY - pixel, bounds.maxX + pixel, bounds.maxY + pixel }, found);
+		raster.clear(0);
+		for (int id : found) {
+			const CanvasShape& shape = canvas.shapes[id];
+			const float* p = &canvas.points[shape.first * 2];
+			switch (shape.type) {
+			case CANVAS_LINE:
+			case CANVAS_POLYLINE:
+				for (int i = 0; i + 1 < shape.count; i++) {
+					raster.line(column(p[i * 2], scale, originX), column(p[i * 2 + 1], scale, originY),
+						column(p[i * 2 + 2], scale, originX), column(p[i * 2 + 3], scale, originY), shape.color);
+				}
+				break;
+			case CANVAS_CIRCLE:
+				raster.circle(column(p[0], scale, originX), column(p[1], scale, originY), (int)floor(shape.radius * scale + 0.5), shape.color);
+				break;
+			case CANVAS_TRIANGLE:
+				raster.triangle((float)(p[0] * scale - originX), (float)(p[1] * scale - originY), (float)(p[2] * scale - originX),
+					(float)(p[3] * scale - originY), (float)(p[4] * scale - originX), (float)(p[5] * scale - originY), shape.color);
+				break;
+			default:
+				break;
+			}
+		}
+		shapesDrawn += (long long)found.size();
+		// the frame keeps the buffers of earlier tiles
+		size_t index = out.slots.size();
+		out.slots.push_back(slot);
+		if (out.tiles.size() <= index) {
+			out.tiles.resize(index + 1);
+		}
+		out.tiles[index] = raster.pixels;
+	}
+
+	// @dev pixel of the tile a world coordinate falls in, clamped so far away ends stay in range
+	static int column(float world, double scale, double origin) {
+		double pixel = floor(world * scale) - origin;
+		return (int)std::max(-1e9, std::min(pixel, 1e9));
+	}
+
+	// @dev queue the quad of a cached tile, or of a part of it
+	// @param u0, v0, u1, v1 Part of the tile from 0 to 1
+	// @param level, x, y World square the part covers
+	void use(int slot, int level, int x, int y, float u0, float v0, float u1, float v1, int width, int height) {
+		slots[slot].lastUsed = frame;
+		QuadBounds bounds = tileBounds(level, x, y);
+		float left = (bounds.minX - centerX) * zoom * 2.0f / width, right = (bounds.maxX - centerX) * zoom * 2.0f / width;
+		float bottom = (bounds.minY - centerY) * zoom * 2.0f / height, top = (bounds.maxY - centerY) * zoom * 2.0f / height;
+		// half a texel in from the slot's edges so filtering never reads the neighbouring slot
+		float texel = 0.5f / TILE;
+		float s0 = (slot % ATLAS_COLUMNS + std::max(u0, texel)) / ATLAS_COLUMNS, s1 = (slot % ATLAS_COLUMNS + std::min(u1, 1.0f - texel)) / ATLAS_COLUMNS;
+		float t0 = (slot / ATLAS_COLUMNS + std::max(v0, texel)) / ATLAS_ROWS, t1 = (slot / ATLAS_COLUMNS + std::min(v1, 1.0f - texel)) / ATLAS_ROWS;
+		float corners[6][4] = {
+			{ left, bottom, s0, t0 }, { right, bottom, s1, t0 }, { left, top, s0, t1 },
+			{ left, top, s0, t1 }, { right, bottom, s1, t0 }, { right, top, s1, t1 }
+		};
+		filling->quads.insert(filling->quads.end(), &corners[0][0], &corners[0][0] + 24);
+	}
+
+	// @dev cover a missing tile with the coarser tile around it or the finer tiles inside it
+	void fallback(int level, int tx, int ty, int width, int height) {
+		int parent = level > MIN_LEVEL ? find(level - 1, tx >> 1, ty >> 1) : -1;
+		if (parent >= 0 && !slots[parent].dirty) {
+			float u = (tx & 1) * 0.5f, v = (ty & 1) * 0.5f;
+			use(parent, level, tx, ty, u, v, u + 0.5f, v + 0.5f, width, height);
+			return;
+		}
+		if (level >= MAX_LEVEL) {
+			return;
+		}
+		for (int k = 0; k < 4; k++) {
+			int x = tx * 2 + (k & 1), y = ty * 2 + (k >> 1);
+			int child = find(level + 1, x, y);
+			if (child >= 0 && !slots[child].dirty) {
+				use(child, level + 1, x, y, 0.0f, 0.0f, 1.0f, 1.0f, width, height);
+			}
+		}
+	}
+
+	// @dev draw the quads of a frame in one call
+	void present(const std::vector<float>& quads) {
+		if (quads.empty()) {
+			return;
+		}
+		GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+		GLboolean blend = glIsEnabled(GL_BLEND);
+		glDisable(GL_DEPTH_TEST);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, quads.size() * sizeof(float), quads.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, atlas);
+		program->use();
+		program->setInt("atlas", 0);
+		glBindVertexArray(VAO);
+		glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(quads.size() / 4));
+		glBindVertexArray(0);
+		if (!blend) {
+			glDisable(GL_BLEND);
+		}
+		if (depthTest) {
+			glEnable(GL_DEPTH_TEST);
+		}
+	}
+};
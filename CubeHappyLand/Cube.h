@@ -9,15 +9,19 @@
 #include "Object.h"
 #include "Camera.h"
 #include "Light.h"
+#include "DepthStream.h"
+#include "MeshBuffer.h"
+#include "Profiler.h"
 
+// triangles wind counter clockwise seen from outside
 float cubeVertices[] = {
 	// positions          // normals           // texture coords
 	-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
-	 0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  0.0f,
 	 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
+	 0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  0.0f,
 	 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
-	-0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  1.0f,
 	-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
+	-0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  1.0f,
 
 	-0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
 	 0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  0.0f,
@@ -34,11 +38,11 @@ float cubeVertices[] = {
 	-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
 
 	 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-	 0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
 	 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
+	 0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
 	 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-	 0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
 	 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
+	 0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
 
 	-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
 	 0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  1.0f,
@@ -48,11 +52,11 @@ float cubeVertices[] = {
 	-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
 
 	-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f,
-	 0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  1.0f,
 	 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
+	 0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  1.0f,
 	 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
-	-0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  0.0f,
-	-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f
+	-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f,
+	-0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  0.0f
 };
 
 class Cube: public Object
@@ -63,6 +67,10 @@ private:
 	// length of cube
 	float edgeLength = 1.0f;
 public:
+	// position only stream for depth passes
+	static DepthStream depthStream;
+	// mesh of the lit passes
+	static MeshBuffer mesh;
 
 	Cube(glm::vec3 position, glm::vec3 rotation, glm::vec3 scale) {
 		
@@ -84,99 +92,56 @@ public:
 	}
 	~Cube() {}
 
+	// @dev radius of the sphere bounding the cube in world space, used for culling
+	float boundingRadius() {
+		return 0.5f * edgeLength * glm::length(this->transform.scale);
+	}
+
+	// @dev distance from a point to the cube's bounding sphere, used for texture streaming
+	float distanceTo(glm::vec3 eye) {
+		float distance = glm::length(eye - this->transform.position) - boundingRadius();
+		return distance > 0.0f ? distance : 0.0f;
+	}
+
+	// @dev texture repeats per world unit, every face shows the texture once
+	float uvDensity() {
+		glm::vec3 scale = this->transform.scale;
+		float smallest = glm::min(scale.x, glm::min(scale.y, scale.z));
+		return 1.0f / glm::max(edgeLength * smallest, 0.001f);
+	}
+
+	// @dev recompute the cube's matrices if needed, the edge length scales the unit cube mesh
+	void updateConstants(const glm::mat4& viewProjection) {
+		Object::updateConstants(viewProjection, edgeLength);
+	}
+
 	// render depth map
 	void render(Shader shader) {
-		glm::vec3 position = this->transform.position;
-		glm::vec3 rotation = this->transform.rotation;
-		glm::vec3 scale = this->transform.scale;
+		PROFILE_ZONE("Cube::render");
+		// positions only, shared by every instance
+		if (depthStream.VAO == 0) {
+			depthStream.create(cubeVertices, 36, 8);
+		}
 
-		unsigned int VAO;
-		glGenVertexArrays(1, &VAO);
-		unsigned int VBO;
-		glGenBuffers(1, &VBO);
-
-		glBindVertexArray(VAO);
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
-
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (GLvoid*)0);
-		glEnableVertexAttribArray(0);
-
-		// transformation
-		// identity matrix
-		glm::mat4 model = glm::mat4(1.0f);
-		// translate to position
-		model = glm::translate(model, glm::vec3(position[0], position[1], position[2]));
-		// rotate around x-axis
-		model = glm::rotate(model, glm::radians(rotation[0]), glm::vec3(1.0f, 0.0f, 0.0f));
-		// rotate around y-axis
-		model = glm::rotate(model, glm::radians(rotation[1]), glm::vec3(0.0f, 1.0f, 0.0f));
-		// rotate around z-axis
-		model = glm::rotate(model, glm::radians(rotation[2]), glm::vec3(0.0f, 0.0f, 1.0f));
-		// scaling
-		model = glm::scale(model, glm::vec3(scale[0], scale[1], scale[2]) * edgeLength);
-		shader.setMat4("model", model);
 		// enable the shader program
 		shader.use();
-		glBindVertexArray(VAO);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+		bindConstants();
+		depthStream.draw();
 	}
-
 	// render with texture
-	void render(Camera camera, Light light, Shader shader) {
-
-		glm::vec3 position = this->transform.position;
-		glm::vec3 rotation = this->transform.rotation;
-		glm::vec3 scale = this->transform.scale;
+	void render(Camera camera, Light& light, Shader shader) {
+		PROFILE_ZONE("Cube::render");
 
-		unsigned int VAO;
-		glGenVertexArrays(1, &VAO);
-		unsigned int VBO;
-		glGenBuffers(1, &VBO);
-
-		glBindVertexArray(VAO);
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
-
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-		glEnableVertexAttribArray(0);
-		glEnableVertexAttribArray(1);
-		glEnableVertexAttribArray(2);
+		// full vertices, shared by every instance
+		if (mesh.VAO == 0) {
+			mesh.create(cubeVertices, 36);
+		}
 
 		// DRAW
-		// create Transform
-		// identity matrix
-		glm::mat4 model = glm::mat4(1.0f);
-		glm::mat4 view = glm::mat4(1.0f);
-		glm::mat4 projection = glm::mat4(1.0f);
-		// transformation
-		// translate to position
-		model = glm::translate(model, glm::vec3(position[0], position[1], position[2]));
-		// rotate around x-axis
-		model = glm::rotate(model, glm::radians(rotation[0]), glm::vec3(1.0f, 0.0f, 0.0f));
-		// rotate around y-axis
-		model = glm::rotate(model, glm::radians(rotation[1]), glm::vec3(0.0f, 1.0f, 0.0f));
-		// rotate around z-axis
-		model = glm::rotate(model, glm::radians(rotation[2]), glm::vec3(0.0f, 0.0f, 1.0f));
-		// scaling
-		model = glm::scale(model, glm::vec3(scale[0], scale[1], scale[2]) * edgeLength);
-		// view
-		view = glm::lookAt(camera.transform.position, -camera.transform.forward + camera.transform.position, camera.transform.up);
-		// projection
-		// projection = glm::perspective(glm::radians(100.0f), (float)WINDOW_WIDTH * 2.0f / (float)WINDOW_HEIGHT,  0.1f, 10.0f);
-		projection = glm::perspective(glm::radians(camera.fovy), camera.aspect, camera.zNear, camera.zFar);
-
 		// enable the shader program
 		shader.use();
-		// pass to shader
-		// view
-		shader.setMat4("model", model);
-		shader.setMat4("view", view);
-		shader.setMat4("projection", projection);
+		// matrices computed by the transform stage
+		bindConstants();
 		// light properties
 		shader.setVec3("light.ambient", 0.2f, 0.2f, 0.2f);
 		shader.setVec3("light.diffuse", 0.5f, 0.5f, 0.5f);
@@ -188,14 +153,13 @@ public:
 		shader.setFloat("diffuseFactor", light.diffuseFactor);
 		shader.setFloat("specularFactor", light.specularFactor);
 		shader.setFloat("material.shininess", light.shininess);
-		glBindVertexArray(VAO);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+		mesh.draw();
 	}
 };
 
 
 int Cube::count = 0;
+DepthStream Cube::depthStream;
+MeshBuffer Cube::mesh;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,246 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "Batch2D.h"
+#include "Bezier.h"
+#include "BSpline.h"
+
+// @dev Curve of the Bezier tool with its flattened polyline cached. The control points are read as
+//   - BEZIER: one segment of degree n - 1
+//   - PIECEWISE_CUBIC: cubic segments sharing their ends, leftover points end in a lower degree
+//   - UNIFORM_BSPLINE / NON_UNIFORM_BSPLINE: a B-spline on uniform or chord length knots
+// Every type is turned into Bezier segments, segments above Bezier::MAX_BERNSTEIN_DEGREE are reduced
+// to cubics, split until the reduction is within half the tolerance. The segments are then
+// flattened adaptively: Wang's formula bounds the distance between a segment and its polyline, and
+// segments that would need many lines are split in half first, so flat parts stay coarse while
+// tight bends get refined. Points are evaluated four at a time in the Bernstein basis.
+// The polyline is only rebuilt when the control points, the type or the viewport change, drawing it
+// is one line strip.
+class Curve
+{
+public:
+	enum Type { BEZIER, PIECEWISE_CUBIC, UNIFORM_BSPLINE, NON_UNIFORM_BSPLINE };
+	// largest distance in pixels between the curve and its polyline
+	float tolerance = 0.25f;
+	// degree of the B-splines, lowered for fewer control points
+	int splineDegree = 3;
+	// low degree segments the polyline was flattened from
+	std::vector<BezierPiece> pieces;
+	// flattened polyline, x and y interleaved, and the curve parameter of every point
+	std::vector<float> points;
+	std::vector<float> params;
+	// times the polyline was rebuilt
+	int flattened = 0;
+
+	Curve() {}
+	~Curve() {}
+
+	// @dev size of the viewport the curve is drawn in, the tolerance is measured in its pixels
+	void setViewport(int width, int height) {
+		if (width != viewportWidth || height != viewportHeight) {
+			viewportWidth = width;
+			viewportHeight = height;
+			dirty = true;
+		}
+	}
+
+	// @dev take the control points of this frame, the polyline is rebuilt if they changed
+	// @param controlPoints Coordinates in normalized device space, x and y interleaved
+	// @param count Number of control points
+	// @return True if the polyline was rebuilt
+	bool update(const float* controlPoints, int count, Type curveType) {
+		count = std::max(count, 0);
+		if (!dirty && curveType == type && splineDegree == builtDegree && count * 2 == (int)control.size()
+			&& std::equal(control.begin(), control.end(), controlPoints)) {
+			return false;
+		}
+		control.assign(controlPoints, controlPoints + count * 2);
+		type = curveType;
+		builtDegree = splineDegree;
+		dirty = false;
+		build();
+		flatten();
+		flattened++;
+		return true;
+	}
+
+	// @dev point of the curve
+	// @param s Parameter, 0 at the start and 1 at the end
+	// @param point X and y of the point
+	void evaluate(float s, float* point) const {
+		if (pieces.empty()) {
+			point[0] = control.empty() ? 0.0f : control[0];
+			point[1] = control.empty() ? 0.0f : control[1];
+			return;
+		}
+		// first piece ending at or after s
+		size_t index = std::lower_bound(pieces.begin(), pieces.end(), s, [](const BezierPiece& piece, float value) {
+			return piece.to < value;
+		}) - pieces.begin();
+		const BezierPiece& piece = pieces[std::min(index, pieces.size() - 1)];
+		float u = piece.to > piece.from ? (s - piece.from) / (piece.to - piece.from) : 0.0f;
+		Bezier::evaluate(piece, std::max(0.0f, std::min(u, 1.0f)), point);
+	}
+
+	// @dev append the part of the curve between two parameters to the 2D batch as a line strip
+	void draw(float from, float to, const float* color, unsigned int shaderProgram) {
+		if (params.size() < 2 || from >= to) {
+			return;
+		}
+		strip.clear();
+		float point[2];
+		evaluate(from, point);
+		strip.push_back(point[0]);
+		strip.push_back(point[1]);
+		size_t first = std::upper_bound(params.begin(), params.end(), from) - params.begin();
+		for (size_t i = first; i < params.size() && params[i] < to; i++) {
+			strip.push_back(points[i * 2]);
+			strip.push_back(points[i * 2 + 1]);
+		}
+		evaluate(to, point);
+		strip.push_back(point[0]);
+		strip.push_back(point[1]);
+		Batch2D::getInstance()->lineStrip(strip.data(), (int)strip.size() / 2, color, shaderProgram);
+	}
+
+	// @dev number of segments of the polyline
+	int segments() const {
+		return std::max((int)params.size() - 1, 0);
+	}
+
+private:
+	// flattening splits pieces at most this often
+	static const int MAX_DEPTH = 8;
+	// reducing splits pieces at most this often
+	static const int MAX_REDUCE_DEPTH = 12;
+	// pieces needing more segments than this are split
+	static const int SPLIT_SEGMENTS = 16;
+	// segments of a piece that cannot be split any further
+	static const int MAX_SEGMENTS = 1024;
+	Type type = BEZIER;
+	int builtDegree = 0;
+	std::vector<float> control;
+	std::vector<float> strip;
+	int viewportWidth = 1;
+	int viewportHeight = 1;
+	bool dirty = true;
+	// binomial coefficients per degree
+	std::vector<std::vector<float>> binomial;
+
+	float scaleX() const {
+		return viewportWidth * 0.5f;
+	}
+
+	float scaleY() const {
+		return viewportHeight * 0.5f;
+	}
+
+	// @dev turn the control points into Bezier pieces of low degree
+	void build() {
+		pieces.clear();
+		int count = (int)control.size() / 2;
+		if (count < 2) {
+			return;
+		}
+		std::vector<BezierPiece> built;
+		if (type == BEZIER) {
+			built.push_back(span(0, count - 1, 0.0f, 1.0f));
+		}
+		else if (type == PIECEWISE_CUBIC) {
+			int total = (count - 1 + 2) / 3;
+			for (int k = 0; k < total; k++) {
+				int last = std::min(k * 3 + 3, count - 1);
+				built.push_back(span(k * 3, last, (float)k / total, (float)(k + 1) / total));
+			}
+		}
+		else {
+			int degree = std::min(splineDegree, count - 1);
+			std::vector<float> knots = type == UNIFORM_BSPLINE ? BSpline::uniformKnots(count, degree) : BSpline::chordKnots(control.data(), count, degree);
+			BSpline::toBezier(control.data(), count, degree, knots, built);
+		}
+		for (const BezierPiece& source : built) {
+			if ((int)source.x.size() - 1 > Bezier::MAX_BERNSTEIN_DEGREE) {
+				reduce(source, 0);
+			}
+			else {
+				pieces.push_back(source);
+			}
+		}
+	}
+
+	// @dev piece through a range of control points
+	BezierPiece span(int first, int last, float from, float to) {
+		BezierPiece result;
+		for (int i = first; i <= last; i++) {
+			result.x.push_back(control[i * 2]);
+			result.y.push_back(control[i * 2 + 1]);
+		}
+		result.from = from;
+		result.to = to;
+		return result;
+	}
+
+	// @dev append cubics within half the tolerance of a high degree piece
+	void reduce(const BezierPiece& high, int depth) {
+		float error;
+		BezierPiece cubic = Bezier::reduce(high, scaleX(), scaleY(), error);
+		if (error <= tolerance * 0.5f || depth >= MAX_REDUCE_DEPTH) {
+			pieces.push_back(cubic);
+			return;
+		}
+		BezierPiece left, right;
+		Bezier::split(high, left, right);
+		reduce(left, depth + 1);
+		reduce(right, depth + 1);
+	}
+
+	// @dev rebuild the polyline from the pieces
+	void flatten() {
+		points.clear();
+		params.clear();
+		if (pieces.empty()) {
+			return;
+		}
+		points.push_back(pieces[0].x[0]);
+		points.push_back(pieces[0].y[0]);
+		params.push_back(pieces[0].from);
+		for (const BezierPiece& piece : pieces) {
+			flattenPiece(piece, 0);
+		}
+	}
+
+	// @dev append the points of a piece after its first one
+	void flattenPiece(const BezierPiece& piece, int depth) {
+		// a reduced piece already used up half of the tolerance
+		int segments = Bezier::segmentsFor(piece, scaleX(), scaleY(), tolerance * 0.5f);
+		if (segments > SPLIT_SEGMENTS && depth < MAX_DEPTH) {
+			BezierPiece left, right;
+			Bezier::split(piece, left, right);
+			flattenPiece(left, depth + 1);
+			flattenPiece(right, depth + 1);
+			return;
+		}
+		segments = std::min(segments, MAX_SEGMENTS);
+		int degree = (int)piece.x.size() - 1;
+		if ((int)binomial.size() <= degree) {
+			binomial.resize(degree + 1);
+		}
+		if (binomial[degree].empty()) {
+			binomial[degree] = Bezier::binomials(degree);
+		}
+		float u[4], px[4], py[4];
+		for (int first = 1; first <= segments; first += 4) {
+			int lanes = std::min(4, segments - first + 1);
+			for (int lane = 0; lane < 4; lane++) {
+				u[lane] = (float)std::min(first + lane, segments) / (float)segments;
+			}
+			Bezier::bernstein(piece, binomial[degree], u, px, py);
+			for (int lane = 0; lane < lanes; lane++) {
+				points.push_back(px[lane]);
+				points.push_back(py[lane]);
+				params.push_back(piece.from + (piece.to - piece.from) * u[lane]);
+			}
+		}
+	}
+};
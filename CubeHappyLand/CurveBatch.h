@@ -0,0 +1,308 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "ThreadPool.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define CURVE_BATCH_AVX2
+#define CURVE_BATCH_TARGET
+#include <immintrin.h>
+#include <intrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CURVE_BATCH_AVX2
+#define CURVE_BATCH_TARGET __attribute__((target("avx2,fma")))
+#include <immintrin.h>
+#endif
+
+// @dev what CurveBatch::evaluate writes
+enum CurveOutput {
+	CURVE_POSITION = 1,
+	CURVE_TANGENT = 2,
+	CURVE_LENGTH = 4
+};
+
+// @dev Results of CurveBatch::evaluate, structure of arrays indexed by param * curves + curve
+typedef struct CurveSamples {
+	int curves = 0;
+	int params = 0;
+	std::vector<float> x, y, z;
+	// derivative of the position by the parameter
+	std::vector<float> tangentX, tangentY, tangentZ;
+	// arc length from the start of the curve to the parameter
+	std::vector<float> length;
+}CurveSamples;
+
+// @dev Many cubic Bezier curves in 3D evaluated together, for camera paths, light animation and
+// strokes. Control points are kept as structure of arrays, so eight curves fill one AVX2 register
+// and are evaluated at once. AVX2 is picked at run time, the scalar loop over the same arrays is the
+// fallback. Large batches are split by curves over a worker pool.
+// Arc length is integrated with composite five point Gauss-Legendre quadrature of the speed.
+class CurveBatch
+{
+public:
+	// coordinates of control point k of every curve
+	std::vector<float> x[4], y[4], z[4];
+	// batches with at least this many evaluations run on the pool
+	int parallelThreshold = 1 << 16;
+	// use AVX2 when the CPU has it
+	bool simd = true;
+
+	CurveBatch() {}
+	~CurveBatch() {}
+
+	// @dev append a curve
+	// @return Index of the curve
+	int add(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3) {
+		const glm::vec3 points[4] = { p0, p1, p2, p3 };
+		for (int k = 0; k < 4; k++) {
+			x[k].push_back(points[k].x);
+			y[k].push_back(points[k].y);
+			z[k].push_back(points[k].z);
+		}
+		return size() - 1;
+	}
+
+	// @dev number of curves
+	int size() const {
+		return (int)x[0].size();
+	}
+
+	void clear() {
+		for (int k = 0; k < 4; k++) {
+			x[k].clear();
+			y[k].clear();
+			z[k].clear();
+		}
+	}
+
+	// @dev evaluate every curve at every parameter
+	// @param params Parameters between 0 and 1, shared by all curves or, with perCurve, one row of
+	// size() parameters per evaluation
+	// @param count Number of parameters or rows
+	// @param outputs CurveOutput bits of the values to write
+	void evaluate(const float* params, int count, CurveSamples& samples, int outputs, bool perCurve = false) {
+		int curves = size();
+		samples.curves = curves;
+		samples.params = count;
+		size_t total = (size_t)curves * count;
+		resize(samples, total, outputs);
+		if (curves == 0 || count == 0) {
+			return;
+		}
+		if ((long long)total < parallelThreshold) {
+			evaluateRange(0, curves, params, count, samples, outputs, perCurve);
+			return;
+		}
+		pool.start();
+		// chunks of whole registers, a few per worker so uneven workers even out
+		int chunks = pool.size() * 4;
+		int chunk = ((curves + chunks - 1) / chunks + 7) / 8 * 8;
+		for (int first = 0; first < curves; first += chunk) {
+			int last = std::min(first + chunk, curves);
+			pool.submit([this, first, last, params, count, &samples, outputs, perCurve]() {
+				evaluateRange(first, last, params, count, samples, outputs, perCurve);
+			});
+		}
+		pool.wait();
+	}
+
+	// @dev whether evaluate takes the AVX2 path
+	bool usesAVX2() const {
+		return simd && hasAVX2();
+	}
+
+	// @dev whether the CPU and the OS support AVX2 and FMA
+	static bool hasAVX2() {
+#if defined(CURVE_BATCH_AVX2) && defined(_MSC_VER)
+		static const bool supported = []() {
+			int info[4];
+			__cpuid(info, 1);
+			bool fma = (info[2] & (1 << 12)) != 0;
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			if (!fma || !osxsave || (_xgetbv(0) & 6) != 6) {
+				return false;
+			}
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+		}();
+		return supported;
+#elif defined(CURVE_BATCH_AVX2)
+		static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+		return supported;
+#else
+		return false;
+#endif
+	}
+
+private:
+	// curves evaluated together for every parameter
+	static const int TILE = 256;
+	// the arc length integral is split into this many Gauss-Legendre rules, a single rule is off by
+	// percents on curves with sharp turns
+	static const int LENGTH_INTERVALS = 4;
+	ThreadPool pool;
+
+	// Gauss-Legendre nodes on [0, 1] and their weights
+	static const float* nodes() {
+		static const float values[5] = { 0.0469100770f, 0.2307653449f, 0.5f, 0.7692346551f, 0.9530899230f };
+		return values;
+	}
+
+	static const float* weights() {
+		static const float values[5] = { 0.1184634425f, 0.2393143352f, 0.2844444444f, 0.2393143352f, 0.1184634425f };
+		return values;
+	}
+
+	static void resize(CurveSamples& samples, size_t total, int outputs) {
+		size_t positions = (outputs & CURVE_POSITION) ? total : 0;
+		size_t tangents = (outputs & CURVE_TANGENT) ? total : 0;
+		samples.x.resize(positions);
+		samples.y.resize(positions);
+		samples.z.resize(positions);
+		samples.tangentX.resize(tangents);
+		samples.tangentY.resize(tangents);
+		samples.tangentZ.resize(tangents);
+		samples.length.resize((outputs & CURVE_LENGTH) ? total : 0);
+	}
+
+	// @dev evaluate a range of curves in tiles small enough for their control points to stay in the
+	// cache, every parameter writes one contiguous run of a tile's outputs
+	void evaluateRange(int first, int last, const float* params, int count, CurveSamples& samples, int outputs, bool perCurve) {
+		bool wide = usesAVX2();
+		for (int tile = first; tile < last; tile += TILE) {
+			int tileEnd = std::min(tile + TILE, last);
+			for (int j = 0; j < count; j++) {
+				size_t row = (size_t)j * samples.curves;
+				int curve = tile;
+#ifdef CURVE_BATCH_AVX2
+				if (wide) {
+					for (; curve + 8 <= tileEnd; curve += 8) {
+						evaluateAVX2(curve, perCurve ? params + row + curve : params + j, perCurve, samples, row + curve, outputs);
+					}
+				}
+#endif
+				for (; curve < tileEnd; curve++) {
+					evaluateScalar(curve, perCurve ? params[row + curve] : params[j], samples, row + curve, outputs);
+				}
+			}
+		}
+	}
+
+	// @dev derivative of a curve at a parameter
+	void derivative(int curve, float t, float* d) const {
+		float s = 1 - t;
+		float a = 3 * s * s, b = 6 * s * t, c = 3 * t * t;
+		d[0] = a * (x[1][curve] - x[0][curve]) + b * (x[2][curve] - x[1][curve]) + c * (x[3][curve] - x[2][curve]);
+		d[1] = a * (y[1][curve] - y[0][curve]) + b * (y[2][curve] - y[1][curve]) + c * (y[3][curve] - y[2][curve]);
+		d[2] = a * (z[1][curve] - z[0][curve]) + b * (z[2][curve] - z[1][curve]) + c * (z[3][curve] - z[2][curve]);
+	}
+
+	void evaluateScalar(int curve, float t, CurveSamples& samples, size_t index, int outputs) const {
+		if (outputs & CURVE_POSITION) {
+			float s = 1 - t;
+			float b0 = s * s * s, b1 = 3 * s * s * t, b2 = 3 * s * t * t, b3 = t * t * t;
+			samples.x[index] = b0 * x[0][curve] + b1 * x[1][curve] + b2 * x[2][curve] + b3 * x[3][curve];
+			samples.y[index] = b0 * y[0][curve] + b1 * y[1][curve] + b2 * y[2][curve] + b3 * y[3][curve];
+			samples.z[index] = b0 * z[0][curve] + b1 * z[1][curve] + b2 * z[2][curve] + b3 * z[3][curve];
+		}
+		if (outputs & CURVE_TANGENT) {
+			float d[3];
+			derivative(curve, t, d);
+			samples.tangentX[index] = d[0];
+			samples.tangentY[index] = d[1];
+			samples.tangentZ[index] = d[2];
+		}
+		if (outputs & CURVE_LENGTH) {
+			float length = 0.0f, step = t / LENGTH_INTERVALS;
+			for (int interval = 0; interval < LENGTH_INTERVALS; interval++) {
+				for (int i = 0; i < 5; i++) {
+					float d[3];
+					derivative(curve, step * (interval + nodes()[i]), d);
+					length += weights()[i] * sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+				}
+			}
+			samples.length[index] = length * step;
+		}
+	}
+
+#ifdef CURVE_BATCH_AVX2
+	// @dev evaluate eight curves starting at curve
+	// @param params Eight parameters, or one for all of them if they do not differ per curve
+	// @param index Output of the first curve
+	CURVE_BATCH_TARGET void evaluateAVX2(int curve, const float* params, bool perCurve, CurveSamples& samples, size_t index, int outputs) const {
+		const __m256 one = _mm256_set1_ps(1.0f), three = _mm256_set1_ps(3.0f), six = _mm256_set1_ps(6.0f);
+		__m256 t = perCurve ? _mm256_loadu_ps(params) : _mm256_set1_ps(params[0]);
+		if (outputs & CURVE_POSITION) {
+			__m256 s = _mm256_sub_ps(one, t);
+			__m256 s2 = _mm256_mul_ps(s, s), t2 = _mm256_mul_ps(t, t);
+			__m256 b[4] = {
+				_mm256_mul_ps(s2, s),
+				_mm256_mul_ps(three, _mm256_mul_ps(s2, t)),
+				_mm256_mul_ps(three, _mm256_mul_ps(s, t2)),
+				_mm256_mul_ps(t2, t)
+			};
+			_mm256_storeu_ps(&samples.x[index], combine(b, x, curve));
+			_mm256_storeu_ps(&samples.y[index], combine(b, y, curve));
+			_mm256_storeu_ps(&samples.z[index], combine(b, z, curve));
+		}
+		if ((outputs & (CURVE_TANGENT | CURVE_LENGTH)) == 0) {
+			return;
+		}
+		// differences of the control points, the derivative is a quadratic over them
+		__m256 dx[3], dy[3], dz[3];
+		differences(x, curve, dx);
+		differences(y, curve, dy);
+		differences(z, curve, dz);
+		if (outputs & CURVE_TANGENT) {
+			__m256 d[3];
+			derivativeAVX2(t, dx, dy, dz, three, six, d);
+			_mm256_storeu_ps(&samples.tangentX[index], d[0]);
+			_mm256_storeu_ps(&samples.tangentY[index], d[1]);
+			_mm256_storeu_ps(&samples.tangentZ[index], d[2]);
+		}
+		if (outputs & CURVE_LENGTH) {
+			__m256 length = _mm256_setzero_ps();
+			__m256 step = _mm256_mul_ps(t, _mm256_set1_ps(1.0f / LENGTH_INTERVALS));
+			for (int interval = 0; interval < LENGTH_INTERVALS; interval++) {
+				for (int i = 0; i < 5; i++) {
+					__m256 d[3];
+					__m256 node = _mm256_mul_ps(step, _mm256_set1_ps(interval + nodes()[i]));
+					derivativeAVX2(node, dx, dy, dz, three, six, d);
+					__m256 speed = _mm256_sqrt_ps(_mm256_fmadd_ps(d[0], d[0], _mm256_fmadd_ps(d[1], d[1], _mm256_mul_ps(d[2], d[2]))));
+					length = _mm256_fmadd_ps(_mm256_set1_ps(weights()[i]), speed, length);
+				}
+			}
+			_mm256_storeu_ps(&samples.length[index], _mm256_mul_ps(length, step));
+		}
+	}
+
+	// @dev differences of neighbouring control points of eight curves along one axis
+	static CURVE_BATCH_TARGET void differences(const std::vector<float>* axis, int curve, __m256* d) {
+		for (int k = 0; k < 3; k++) {
+			d[k] = _mm256_sub_ps(_mm256_loadu_ps(&axis[k + 1][curve]), _mm256_loadu_ps(&axis[k][curve]));
+		}
+	}
+
+	// @dev b0 p0 + b1 p1 + b2 p2 + b3 p3 of eight curves along one axis, registers are passed by
+	// pointer since 32 bit MSVC cannot align them on the stack
+	static CURVE_BATCH_TARGET __m256 combine(const __m256* b, const std::vector<float>* axis, int curve) {
+		__m256 sum = _mm256_mul_ps(b[3], _mm256_loadu_ps(&axis[3][curve]));
+		sum = _mm256_fmadd_ps(b[2], _mm256_loadu_ps(&axis[2][curve]), sum);
+		sum = _mm256_fmadd_ps(b[1], _mm256_loadu_ps(&axis[1][curve]), sum);
+		return _mm256_fmadd_ps(b[0], _mm256_loadu_ps(&axis[0][curve]), sum);
+	}
+
+	// @dev 3 (1-t)^2 D0 + 6 (1-t) t D1 + 3 t^2 D2 for eight curves
+	static CURVE_BATCH_TARGET void derivativeAVX2(const __m256& t, const __m256* dx, const __m256* dy, const __m256* dz, const __m256& three, const __m256& six, __m256* d) {
+		__m256 s = _mm256_sub_ps(_mm256_set1_ps(1.0f), t);
+		__m256 a = _mm256_mul_ps(three, _mm256_mul_ps(s, s));
+		__m256 b = _mm256_mul_ps(six, _mm256_mul_ps(s, t));
+		__m256 c = _mm256_mul_ps(three, _mm256_mul_ps(t, t));
+		d[0] = _mm256_fmadd_ps(a, dx[0], _mm256_fmadd_ps(b, dx[1], _mm256_mul_ps(c, dx[2])));
+		d[1] = _mm256_fmadd_ps(a, dy[0], _mm256_fmadd_ps(b, dy[1], _mm256_mul_ps(c, dy[2])));
+		d[2] = _mm256_fmadd_ps(a, dz[0], _mm256_fmadd_ps(b, dz[1], _mm256_mul_ps(c, dz[2])));
+	}
+#endif
+};
@@ -0,0 +1,134 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "CurveBatch.h"
+
+// @dev Throughput of CurveBatch against evaluating curve by curve with de Casteljau's algorithm, run
+// with
+//   CubeHappyLand --bench-curves [curves] [params]
+// Every variant evaluates positions and tangents of every curve at every parameter, arc length is
+// timed on its own since it costs five derivatives per evaluation.
+class CurveBenchmark
+{
+public:
+	int curves = 4096;
+	int params = 256;
+
+	CurveBenchmark() {}
+	~CurveBenchmark() {}
+
+	// @dev time every variant and print evaluations per second
+	// @return 1 if a variant disagrees with the baseline
+	int run() {
+		srand(7);
+		std::vector<glm::vec3> points((size_t)curves * 4);
+		for (glm::vec3& point : points) {
+			point = glm::vec3(random(), random(), random());
+		}
+		CurveBatch batch;
+		for (int i = 0; i < curves; i++) {
+			batch.add(points[i * 4], points[i * 4 + 1], points[i * 4 + 2], points[i * 4 + 3]);
+		}
+		std::vector<float> t(params);
+		for (int j = 0; j < params; j++) {
+			t[j] = (float)j / (float)(params - 1);
+		}
+		std::cout << curves << " curves x " << params << " parameters, AVX2 " << (CurveBatch::hasAVX2() ? "available" : "unavailable") << std::endl;
+
+		// baseline, array of structures and de Casteljau per evaluation
+		std::vector<glm::vec3> expected((size_t)curves * params), tangents((size_t)curves * params);
+		double baseline = time([&]() {
+			for (int j = 0; j < params; j++) {
+				for (int i = 0; i < curves; i++) {
+					deCasteljau(&points[i * 4], t[j], expected[(size_t)j * curves + i], tangents[(size_t)j * curves + i]);
+				}
+			}
+		});
+		report("de Casteljau, scalar", baseline, baseline);
+
+		CurveSamples samples;
+		int failed = 0;
+		const char* names[3] = { "SoA, scalar", "SoA, AVX2", "SoA, AVX2, threads" };
+		for (int variant = 0; variant < 3; variant++) {
+			if (variant > 0 && !CurveBatch::hasAVX2()) {
+				break;
+			}
+			batch.simd = variant > 0;
+			batch.parallelThreshold = variant == 2 ? 0 : 0x7fffffff;
+			double seconds = time([&]() {
+				batch.evaluate(t.data(), params, samples, CURVE_POSITION | CURVE_TANGENT);
+			});
+			report(names[variant], seconds, baseline);
+			float error = 0.0f;
+			for (size_t k = 0; k < expected.size(); k++) {
+				error = std::max(error, glm::length(glm::vec3(samples.x[k], samples.y[k], samples.z[k]) - expected[k]));
+				error = std::max(error, glm::length(glm::vec3(samples.tangentX[k], samples.tangentY[k], samples.tangentZ[k]) - tangents[k]) / 3.0f);
+			}
+			if (error > 1e-4f) {
+				std::cout << "  differs from the baseline by " << error << std::endl;
+				failed = 1;
+			}
+		}
+
+		// arc length, checked against a fine polyline
+		batch.simd = true;
+		batch.parallelThreshold = 0;
+		double seconds = time([&]() {
+			batch.evaluate(t.data(), params, samples, CURVE_LENGTH);
+		});
+		report("arc length, fastest", seconds, seconds);
+		float worst = 0.0f;
+		for (int i = 0; i < curves; i += curves / 16 + 1) {
+			float length = 0.0f;
+			glm::vec3 previous = points[i * 4], tangent;
+			for (int k = 1; k <= 4096; k++) {
+				glm::vec3 point;
+				deCasteljau(&points[i * 4], k / 4096.0f, point, tangent);
+				length += glm::length(point - previous);
+				previous = point;
+			}
+			float measured = samples.length[(size_t)(params - 1) * curves + i];
+			worst = std::max(worst, fabsf(measured - length) / length);
+		}
+		std::cout << "  largest relative arc length error " << worst << std::endl;
+		return failed;
+	}
+
+private:
+	static float random() {
+		return (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+	}
+
+	// @dev best of five runs in seconds
+	template<typename F>
+	static double time(F work) {
+		double best = 1e30;
+		for (int run = 0; run < 5; run++) {
+			auto start = std::chrono::steady_clock::now();
+			work();
+			best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	void report(const char* name, double seconds, double baseline) {
+		double rate = (double)curves * params / seconds;
+		std::cout << "  " << name << ": " << rate / 1e6 << " M evaluations/s, " << seconds * 1000.0 << " ms, x" << baseline / seconds << std::endl;
+	}
+
+	// @dev point and derivative of one cubic, the derivative is three times the last level's difference
+	static void deCasteljau(const glm::vec3* control, float t, glm::vec3& point, glm::vec3& tangent) {
+		glm::vec3 p[4] = { control[0], control[1], control[2], control[3] };
+		for (int n = 3; n > 1; n--) {
+			for (int i = 0; i < n; i++) {
+				p[i] = p[i] * (1 - t) + p[i + 1] * t;
+			}
+		}
+		tangent = (p[1] - p[0]) * 3.0f;
+		point = p[0] * (1 - t) + p[1] * t;
+	}
+};
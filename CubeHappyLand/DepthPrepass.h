@@ -0,0 +1,161 @@
+#pragma once
+#include <glad/glad.h>
+
+// @dev Depth prepass with overdraw measurement. When the prepass is active opaque geometry is first
+// drawn depth only and the lit pass then runs with GL_EQUAL and depth writes off, so every pixel is
+// shaded exactly once. Whether that pays off depends on overdraw, which is measured with occlusion
+// queries read back a few frames later:
+//   - the prepass (GL_LESS, same order as the lit pass) counts the fragments a lit pass without
+//     prepass would shade
+//   - the lit pass after a prepass counts the pixels covered
+//   - a lit pass without prepass counts the fragments shaded
+// In automatic mode the prepass is switched on when fragments shaded per pixel exceed threshold.
+// While it is off a probe frame with prepass is issued every probeInterval frames to refresh the
+// number of covered pixels.
+class DepthPrepass
+{
+public:
+	enum PREPASS_MODE { PREPASS_OFF, PREPASS_ON, PREPASS_AUTO };
+	// user's choice
+	int mode = PREPASS_AUTO;
+	// overdraw above which the automatic mode turns the prepass on
+	float threshold = 1.5f;
+	// frames between two probe frames while the prepass is off
+	int probeInterval = 30;
+	// fragments shaded per covered pixel, 0 while unknown
+	float overdraw = 0.0f;
+	// whether the current frame draws a prepass
+	bool active = false;
+	// whether the automatic mode has decided for the prepass
+	bool enabled = false;
+
+	DepthPrepass() {}
+	~DepthPrepass() {}
+
+	// @dev create the occlusion queries
+	void initialize() {
+		for (int i = 0; i < FRAMES; i++) {
+			glGenQueries(1, &records[i].prepassQuery);
+			glGenQueries(1, &records[i].litQuery);
+		}
+	}
+
+	// @dev deallocate the occlusion queries
+	void destroy() {
+		for (int i = 0; i < FRAMES; i++) {
+			glDeleteQueries(1, &records[i].prepassQuery);
+			glDeleteQueries(1, &records[i].litQuery);
+		}
+	}
+
+	// @dev collect finished measurements and decide whether this frame draws a prepass
+	// @return True if the prepass has to be drawn
+	bool beginFrame() {
+		collect();
+		frame++;
+
+		switch (mode) {
+		case PREPASS_ON:
+			active = true;
+			break;
+		case PREPASS_OFF:
+			active = false;
+			break;
+		default:
+			// hysteresis keeps the mode from flickering around the threshold
+			if (overdraw > 0.0f) {
+				enabled = enabled ? overdraw > threshold * 0.9f : overdraw > threshold;
+			}
+			active = enabled || coveredPixels == 0 || frame % probeInterval == 0;
+			break;
+		}
+
+		// measure only if a query slot is free, we never wait for the GPU
+		current = &records[frame % FRAMES];
+		if (current->pending) {
+			current = nullptr;
+		}
+		else {
+			current->prepass = active;
+		}
+		return active;
+	}
+
+	// @dev start counting fragments passing the depth test of the prepass
+	void beginPrepass() {
+		if (current != nullptr) {
+			glBeginQuery(GL_SAMPLES_PASSED, current->prepassQuery);
+		}
+	}
+
+	// @dev stop counting the prepass and set up depth state for the lit pass
+	void endPrepass() {
+		if (current != nullptr) {
+			glEndQuery(GL_SAMPLES_PASSED);
+		}
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+	}
+
+	// @dev start counting fragments shaded by the lit pass
+	void beginLitPass() {
+		if (current != nullptr) {
+			glBeginQuery(GL_SAMPLES_PASSED, current->litQuery);
+		}
+	}
+
+	// @dev stop counting the lit pass and restore the default depth state
+	void endLitPass() {
+		if (current != nullptr) {
+			glEndQuery(GL_SAMPLES_PASSED);
+			current->pending = true;
+		}
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+	}
+
+private:
+	// frames a measurement may stay in flight
+	static const int FRAMES = 3;
+	typedef struct Record {
+		GLuint prepassQuery = 0;
+		GLuint litQuery = 0;
+		bool prepass = false;
+		bool pending = false;
+	}Record;
+	Record records[FRAMES];
+	Record* current = nullptr;
+	unsigned long frame = 0;
+	// latest measurements
+	GLuint64 shadedFragments = 0;
+	GLuint64 coveredPixels = 0;
+
+	// @dev read back every measurement whose results are available
+	void collect() {
+		for (int i = 1; i <= FRAMES; i++) {
+			// oldest first
+			Record& record = records[(frame + i) % FRAMES];
+			if (!record.pending) {
+				continue;
+			}
+			GLint available = 0;
+			glGetQueryObjectiv(record.litQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				break;
+			}
+			GLuint64 litSamples = 0;
+			glGetQueryObjectui64v(record.litQuery, GL_QUERY_RESULT, &litSamples);
+			if (record.prepass) {
+				glGetQueryObjectui64v(record.prepassQuery, GL_QUERY_RESULT, &shadedFragments);
+				coveredPixels = litSamples;
+			}
+			else {
+				shadedFragments = litSamples;
+			}
+			record.pending = false;
+		}
+		if (coveredPixels > 0) {
+			overdraw = (float)((double)shadedFragments / (double)coveredPixels);
+		}
+	}
+};
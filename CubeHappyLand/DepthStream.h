@@ -0,0 +1,77 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// @dev Position only copy of an interleaved mesh for depth passes. Shadow maps only need positions,
+// so fetching 12 bytes per vertex instead of the whole 32 byte vertex saves bandwidth. Triangles are
+// rewound to face along their normals, which makes face culling usable on meshes whose original
+// vertex order is not consistent.
+class DepthStream
+{
+public:
+	// vertex array object id
+	unsigned int VAO = 0;
+	// vertex buffer object id
+	unsigned int VBO = 0;
+	// number of vertices
+	int count = 0;
+
+	DepthStream() {}
+	~DepthStream() {}
+
+	// @dev create the stream from interleaved vertices laid out as position, normal, ...
+	// @param vertices Interleaved vertex data
+	// @param count Number of vertices, a multiple of three
+	// @param stride Number of floats per vertex
+	void create(const float* vertices, int count, int stride) {
+		this->count = count;
+		std::vector<float> positions(count * 3);
+		for (int i = 0; i < count; i += 3) {
+			const float* v0 = vertices + i * stride;
+			const float* v1 = vertices + (i + 1) * stride;
+			const float* v2 = vertices + (i + 2) * stride;
+			glm::vec3 p0(v0[0], v0[1], v0[2]);
+			glm::vec3 p1(v1[0], v1[1], v1[2]);
+			glm::vec3 p2(v2[0], v2[1], v2[2]);
+			glm::vec3 normal(v0[3], v0[4], v0[5]);
+			// counter clockwise when seen from the side the normal points to
+			if (glm::dot(glm::cross(p1 - p0, p2 - p0), normal) < 0.0f) {
+				glm::vec3 swap = p1;
+				p1 = p2;
+				p2 = swap;
+			}
+			const glm::vec3 triangle[3] = { p0, p1, p2 };
+			for (int j = 0; j < 3; j++) {
+				positions[(i + j) * 3] = triangle[j][0];
+				positions[(i + j) * 3 + 1] = triangle[j][1];
+				positions[(i + j) * 3 + 2] = triangle[j][2];
+			}
+		}
+
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), positions.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindVertexArray(0);
+	}
+
+	// @dev deallocate the buffers
+	void destroy() {
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+		VAO = 0;
+		VBO = 0;
+	}
+
+	// @dev draw the whole stream with the current program
+	void draw() {
+		glBindVertexArray(VAO);
+		glDrawArrays(GL_TRIANGLES, 0, count);
+		glBindVertexArray(0);
+	}
+};
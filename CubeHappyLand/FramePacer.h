@@ -0,0 +1,199 @@
+#pragma once
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "imgui.h"
+
+// @dev Frame pacing of the main loop. The swap interval follows the sync mode, adaptive sync lets
+// late frames tear instead of waiting for the next refresh where the driver supports it. The
+// interval has to be set on the thread owning the context, whoever swaps picks it up from
+// swapInterval once syncChanged is set. With a
+// target rate every frame is given a deadline one period after the last one; beginFrame sleeps
+// until shortly before it and spins the rest. The margin is the 90th percentile of how far recent
+// sleeps overshot, so coarse system timers do not make frames late while a rare slow wakeup does
+// not turn the following frames into spinning. Waiting before input is read keeps the latency of
+// the frame low. Frame times of the last HISTORY frames are kept with a histogram of 0.1 ms buckets
+// for their percentiles.
+class FramePacer
+{
+public:
+	enum SyncMode { SYNC_OFF, SYNC_VSYNC, SYNC_ADAPTIVE };
+	static const int HISTORY = 600;
+	static const int BUCKETS = 1000;
+	static constexpr double BUCKET_WIDTH = 0.0001;
+
+	SyncMode sync = SYNC_VSYNC;
+	// frames per second, 0 for no limit
+	int targetFps = 0;
+	// seconds since the frame before, the wait included
+	double deltaTime = 0.0;
+	// seconds of the last frame spent sleeping and spinning
+	double sleptTime = 0.0;
+	double spunTime = 0.0;
+	// set when the sync mode changed, cleared by whoever applies the swap interval
+	bool syncChanged = false;
+
+	// @dev needs a current context to look for adaptive sync
+	FramePacer() : times(HISTORY, 0.0), histogram(BUCKETS + 1, 0) {
+		adaptive = adaptiveSupported();
+	}
+	~FramePacer() {}
+
+	// @dev choose the sync mode, falls back to vsync if adaptive sync is not supported
+	void setSync(SyncMode mode) {
+		sync = mode;
+		if (mode == SYNC_ADAPTIVE && !adaptive) {
+			sync = SYNC_VSYNC;
+		}
+		syncChanged = true;
+	}
+
+	// @return Swap interval of the sync mode
+	int swapInterval() const {
+		return sync == SYNC_OFF ? 0 : (sync == SYNC_VSYNC ? 1 : -1);
+	}
+
+	// @dev whether the driver accepts a negative swap interval
+	static bool adaptiveSupported() {
+		return glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+	}
+
+	// @dev wait for the frame's deadline and time the frame before, called first in every frame
+	// @return Seconds since the last call
+	double beginFrame() {
+		Clock::time_point now = Clock::now();
+		sleptTime = 0.0;
+		spunTime = 0.0;
+		if (targetFps > 0 && started) {
+			Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps));
+			deadline += period;
+			// a frame later than a whole period starts a new schedule instead of rushing to catch up
+			if (deadline + period < now) {
+				deadline = now;
+			}
+			wait(now);
+			now = Clock::now();
+		}
+		else {
+			deadline = now;
+		}
+		if (started) {
+			deltaTime = std::chrono::duration<double>(now - last).count();
+			record(deltaTime);
+		}
+		started = true;
+		last = now;
+		return deltaTime;
+	}
+
+	// @dev frame time below which a share of the kept frames lie
+	// @param share Between 0 and 1, 0.99 for the 99th percentile
+	// @return Upper edge of the bucket in seconds
+	double percentile(double share) const {
+		if (count == 0) {
+			return 0.0;
+		}
+		int rank = std::max(1, (int)(share * count + 0.5));
+		int seen = 0;
+		for (int i = 0; i <= BUCKETS; i++) {
+			seen += histogram[i];
+			if (seen >= rank) {
+				return i == BUCKETS ? worst() : (i + 1) * BUCKET_WIDTH;
+			}
+		}
+		return worst();
+	}
+
+	// @dev longest kept frame time in seconds
+	double worst() const {
+		return count == 0 ? 0.0 : *std::max_element(times.begin(), times.end());
+	}
+
+	// @dev window with the pacing settings, percentiles and the recent frame times
+	void overlay() {
+		ImGui::Begin("Frame pacing");
+		int mode = sync;
+		if (ImGui::Combo("Sync", &mode, "Off\0Vsync\0Adaptive\0")) {
+			setSync((SyncMode)mode);
+		}
+		if (mode == SYNC_ADAPTIVE && sync != SYNC_ADAPTIVE) {
+			ImGui::Text("adaptive sync is not supported, using vsync");
+		}
+		ImGui::SliderInt("Target FPS", &targetFps, 0, 360, targetFps == 0 ? "unlimited" : "%d");
+		double average = count == 0 ? 0.0 : total / count;
+		ImGui::Text("%.1f FPS, %.2f ms average, %.2f ms worst", average > 0.0 ? 1.0 / average : 0.0, average * 1000.0, worst() * 1000.0);
+		ImGui::Text("p50 %.1f ms  p95 %.1f ms  p99 %.1f ms", percentile(0.5) * 1000.0, percentile(0.95) * 1000.0, percentile(0.99) * 1000.0);
+		ImGui::Text("waited %.2f ms sleeping, %.2f ms spinning", sleptTime * 1000.0, spunTime * 1000.0);
+		// oldest frame first
+		plotted.resize(HISTORY);
+		for (int i = 0; i < HISTORY; i++) {
+			plotted[i] = (float)(times[(next + i) % HISTORY] * 1000.0);
+		}
+		ImGui::PlotLines("ms", plotted.data(), HISTORY, 0, NULL, 0.0f, (float)(percentile(0.99) * 1500.0), ImVec2(0, 80));
+		ImGui::End();
+	}
+
+private:
+	typedef std::chrono::steady_clock Clock;
+	bool adaptive = false;
+	Clock::time_point last;
+	Clock::time_point deadline;
+	bool started = false;
+	// seconds the spin starts before the deadline, from the overshoots of the last SLEEPS sleeps
+	static const int SLEEPS = 32;
+	double overshoot = 0.002;
+	std::vector<double> overshoots = std::vector<double>(SLEEPS, 0.002);
+	std::vector<double> sorted;
+	int nextSleep = 0;
+	// ring of frame times and their histogram
+	std::vector<double> times;
+	std::vector<int> histogram;
+	std::vector<float> plotted;
+	int next = 0;
+	int count = 0;
+	double total = 0.0;
+
+	// @dev sleep while the deadline is further than the overshoot, then spin
+	void wait(Clock::time_point now) {
+		while (std::chrono::duration<double>(deadline - now).count() > overshoot) {
+			double remaining = std::chrono::duration<double>(deadline - now).count();
+			double request = remaining - overshoot;
+			std::this_thread::sleep_for(std::chrono::duration<double>(request));
+			Clock::time_point woke = Clock::now();
+			double slept = std::chrono::duration<double>(woke - now).count();
+			sleptTime += slept;
+			overshoots[nextSleep] = slept - request;
+			nextSleep = (nextSleep + 1) % SLEEPS;
+			sorted = overshoots;
+			std::nth_element(sorted.begin(), sorted.begin() + SLEEPS * 9 / 10, sorted.end());
+			overshoot = std::min(std::max(sorted[SLEEPS * 9 / 10] + 0.0001, 0.0002), 0.01);
+			now = woke;
+		}
+		Clock::time_point spinStart = now;
+		while (now < deadline) {
+			std::this_thread::yield();
+			now = Clock::now();
+		}
+		spunTime = std::chrono::duration<double>(now - spinStart).count();
+	}
+
+	void record(double seconds) {
+		if (count == HISTORY) {
+			histogram[bucket(times[next])]--;
+			total -= times[next];
+		}
+		else {
+			count++;
+		}
+		times[next] = seconds;
+		histogram[bucket(seconds)]++;
+		total += seconds;
+		next = (next + 1) % HISTORY;
+	}
+
+	static int bucket(double seconds) {
+		return std::min((int)(seconds / BUCKET_WIDTH), BUCKETS);
+	}
+};
@@ -0,0 +1,957 @@
+#pragma once
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "imgui.h"
+#include "GLCounters.h"
+
+// @dev How captured GL calls are written, shared by GLCapture and GLReplay. A call is its
+// GLEntryPoint followed by every argument, then the memory some arguments point to and what the
+// call handed back where the replay needs it. Every number is a zigzag LEB128 varint: arguments are
+// widened to 64 bits, floats as their bits and pointers as their address, so enums and small
+// integers take a byte or two. Memory is written as its length plus one and the bytes, 0 standing
+// for a NULL pointer or an offset into a bound buffer.
+class GLStream
+{
+public:
+	static const int VERSION = 1;
+
+	// @return The eight bytes a capture starts with
+	static const char* magic() {
+		return "GLCAPTUR";
+	}
+
+	static void put(std::string& out, int64_t value) {
+		uint64_t bits = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+		while (bits >= 0x80) {
+			out += (char)(bits | 0x80);
+			bits >>= 7;
+		}
+		out += (char)bits;
+	}
+
+	// @return false at the end of the data or on a malformed value
+	static bool get(const unsigned char*& in, const unsigned char* end, int64_t& value) {
+		uint64_t bits = 0;
+		for (int shift = 0; in < end && shift < 64; shift += 7) {
+			unsigned char byte = *in++;
+			bits |= (uint64_t)(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0) {
+				value = (int64_t)(bits >> 1) ^ -(int64_t)(bits & 1);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static void putBytes(std::string& out, const void* data, size_t bytes) {
+		if (data == NULL) {
+			put(out, 0);
+			return;
+		}
+		put(out, (int64_t)bytes + 1);
+		out.append((const char*)data, bytes);
+	}
+
+	template <typename T>
+	static typename std::enable_if<std::is_integral<T>::value, int64_t>::type toSlot(T value) {
+		return (int64_t)value;
+	}
+	template <typename T>
+	static typename std::enable_if<std::is_floating_point<T>::value, int64_t>::type toSlot(T value) {
+		float single = (float)value;
+		uint32_t bits = 0;
+		memcpy(&bits, &single, sizeof(bits));
+		return bits;
+	}
+	template <typename T>
+	static typename std::enable_if<std::is_pointer<T>::value, int64_t>::type toSlot(T value) {
+		return (int64_t)(intptr_t)value;
+	}
+
+	template <typename T>
+	static typename std::enable_if<std::is_integral<T>::value, T>::type fromSlot(int64_t slot) {
+		return (T)slot;
+	}
+	template <typename T>
+	static typename std::enable_if<std::is_floating_point<T>::value, T>::type fromSlot(int64_t slot) {
+		uint32_t bits = (uint32_t)slot;
+		float single = 0.0f;
+		memcpy(&single, &bits, sizeof(single));
+		return (T)single;
+	}
+	template <typename T>
+	static typename std::enable_if<std::is_pointer<T>::value, T>::type fromSlot(int64_t slot) {
+		return (T)(intptr_t)slot;
+	}
+
+	// @return One character per argument of an entry point: the object type a name is of, b buffer,
+	// t texture, v vertex array, f framebuffer, r renderbuffer, q query, s shader, p program; l a
+	// uniform location of the current program; d memory written after the arguments; n a string
+	// written after the arguments; o memory GL writes to. Arguments without a role are '.', entry
+	// points without any have an empty string.
+	static const char* roles(int entry) {
+		switch (entry) {
+		case ENTRY_AttachShader: case ENTRY_DetachShader: return "ps";
+		case ENTRY_BeginQuery: return ".q";
+		case ENTRY_BindBuffer: return ".b";
+		case ENTRY_BindBufferRange: return "..b..";
+		case ENTRY_BindFramebuffer: return ".f";
+		case ENTRY_BindRenderbuffer: return ".r";
+		case ENTRY_BindTexture: return ".t";
+		case ENTRY_BindVertexArray: return "v";
+		case ENTRY_CompileShader: case ENTRY_DeleteShader: case ENTRY_ShaderSource: return "s";
+		case ENTRY_LinkProgram: case ENTRY_UseProgram: case ENTRY_DeleteProgram: case ENTRY_UniformBlockBinding: return "p";
+		case ENTRY_FramebufferRenderbuffer: return "...r";
+		case ENTRY_FramebufferTexture: case ENTRY_FramebufferTextureLayer: return "..t";
+		case ENTRY_FramebufferTexture2D: return "...t";
+		case ENTRY_GetInteger64v: case ENTRY_GetIntegerv: return ".o";
+		case ENTRY_GetProgramInfoLog: return "p.oo";
+		case ENTRY_GetProgramiv: return "p.o";
+		case ENTRY_GetShaderInfoLog: return "s.oo";
+		case ENTRY_GetShaderiv: return "s.o";
+		case ENTRY_GetQueryObjectiv: case ENTRY_GetQueryObjectui64v: return "q.o";
+		case ENTRY_GetAttribLocation: case ENTRY_GetUniformBlockIndex: case ENTRY_GetUniformLocation: return "pn";
+		case ENTRY_QueryCounter: return "q";
+		case ENTRY_ReadPixels: return "......o";
+		case ENTRY_Uniform1f: case ENTRY_Uniform1i: case ENTRY_Uniform2f: case ENTRY_Uniform3f: case ENTRY_Uniform4f: return "l";
+		case ENTRY_Uniform2fv: case ENTRY_Uniform3fv: case ENTRY_Uniform4fv: return "l.d";
+		case ENTRY_UniformMatrix2fv: case ENTRY_UniformMatrix3fv: case ENTRY_UniformMatrix4fv: return "l..d";
+		case ENTRY_BufferData: return "..d";
+		case ENTRY_BufferSubData: return "...d";
+		case ENTRY_TexImage2D: case ENTRY_TexSubImage2D: return "........d";
+		case ENTRY_TexImage3D: return ".........d";
+		case ENTRY_TexSubImage3D: return "..........d";
+		case ENTRY_CompressedTexImage2D: return ".......d";
+		case ENTRY_TexParameterfv: return "..d";
+		default: return "";
+		}
+	}
+
+	// @return Whether the memory of an entry point is pixels, an offset when a buffer is bound to GL_PIXEL_UNPACK_BUFFER
+	static bool readsPixels(int entry) {
+		return entry == ENTRY_TexImage2D || entry == ENTRY_TexImage3D || entry == ENTRY_TexSubImage2D ||
+			entry == ENTRY_TexSubImage3D || entry == ENTRY_CompressedTexImage2D;
+	}
+
+	// @return Bytes of the memory a d argument points to
+	// @param alignment, rowLength GL_UNPACK_ALIGNMENT and GL_UNPACK_ROW_LENGTH
+	static size_t dataBytes(int entry, const int64_t* slots, int alignment, int rowLength) {
+		switch (entry) {
+		case ENTRY_BufferData: return (size_t)slots[1];
+		case ENTRY_BufferSubData: return (size_t)slots[2];
+		case ENTRY_TexImage2D: return imageBytes(slots[6], slots[7], slots[3], slots[4], 1, alignment, rowLength);
+		case ENTRY_TexImage3D: return imageBytes(slots[7], slots[8], slots[3], slots[4], slots[5], alignment, rowLength);
+		case ENTRY_TexSubImage2D: return imageBytes(slots[6], slots[7], slots[4], slots[5], 1, alignment, rowLength);
+		case ENTRY_TexSubImage3D: return imageBytes(slots[8], slots[9], slots[5], slots[6], slots[7], alignment, rowLength);
+		case ENTRY_CompressedTexImage2D: return (size_t)slots[6];
+		case ENTRY_Uniform2fv: return (size_t)slots[1] * 2 * sizeof(GLfloat);
+		case ENTRY_Uniform3fv: return (size_t)slots[1] * 3 * sizeof(GLfloat);
+		case ENTRY_Uniform4fv: case ENTRY_UniformMatrix2fv: return (size_t)slots[1] * 4 * sizeof(GLfloat);
+		case ENTRY_UniformMatrix3fv: return (size_t)slots[1] * 9 * sizeof(GLfloat);
+		case ENTRY_UniformMatrix4fv: return (size_t)slots[1] * 16 * sizeof(GLfloat);
+		case ENTRY_TexParameterfv: return (slots[1] == GL_TEXTURE_BORDER_COLOR ? 4 : 1) * sizeof(GLfloat);
+		default: return 0;
+		}
+	}
+
+	// @return Bytes GL reads for an image from client memory, rows padded to the unpack alignment
+	static size_t imageBytes(int64_t format, int64_t type, int64_t width, int64_t height, int64_t depth, int alignment, int rowLength) {
+		if (width <= 0 || height <= 0 || depth <= 0) {
+			return 0;
+		}
+		long long pixel = GLCounters::imageBytes((GLenum)format, (GLenum)type, 1, 1, 1);
+		long long row = (rowLength > 0 ? rowLength : width) * pixel;
+		row = (row + alignment - 1) / alignment * alignment;
+		return (size_t)(row * (height * depth - 1) + width * pixel);
+	}
+
+	// @return Number of arguments of an entry point
+	static int arity(int entry) {
+#define GL_ARITY(name) argumentCount(glad_gl##name),
+#define GL_ARITY_PAIR(generate, remove, type) argumentCount(glad_gl##generate), argumentCount(glad_gl##remove),
+		static const int counts[] = {
+			GL_COUNTED_CALLS(GL_ARITY)
+			GL_ACCOUNTED_CALLS(GL_ARITY)
+			GL_OBJECT_CALLS(GL_ARITY_PAIR)
+		};
+#undef GL_ARITY
+#undef GL_ARITY_PAIR
+		return counts[entry];
+	}
+
+	// @return GLObjectType whose names an entry point generates or deletes, -1 for other entry points
+	static int objectType(int entry) {
+#define GL_TYPE_OF(generate, remove, type) if (entry == ENTRY_##generate || entry == ENTRY_##remove) return type;
+		GL_OBJECT_CALLS(GL_TYPE_OF)
+#undef GL_TYPE_OF
+		return -1;
+	}
+
+	// @return Whether an entry point generates names, glGenBuffers and the like
+	static bool generates(int entry) {
+#define GL_GENERATES(generate, remove, type) if (entry == ENTRY_##generate) return true;
+		GL_OBJECT_CALLS(GL_GENERATES)
+#undef GL_GENERATES
+		return false;
+	}
+
+	// @return Whether the value an entry point returns is written after its call
+	static bool returnsName(int entry) {
+		return entry == ENTRY_CreateShader || entry == ENTRY_CreateProgram || entry == ENTRY_GetUniformLocation;
+	}
+private:
+	template <typename R, typename... Args>
+	static int argumentCount(R (APIENTRYP)(Args...)) {
+		return (int)sizeof...(Args);
+	}
+};
+
+// @dev the value a wrapped call returned, nothing for void calls
+template <typename R>
+struct GLForward {
+	R value;
+	template <typename F, typename... Args>
+	GLForward(F function, Args... args) : value(function(args...)) {}
+	int64_t slot() const {
+		return GLStream::toSlot(value);
+	}
+	R get() const {
+		return value;
+	}
+};
+template <>
+struct GLForward<void> {
+	template <typename F, typename... Args>
+	GLForward(F function, Args... args) {
+		function(args...);
+	}
+	int64_t slot() const {
+		return 0;
+	}
+	void get() const {}
+};
+
+// @dev Records GL calls for GLReplay. Once installed, right after gladLoadGLLoader like GLCounters,
+// every call goes through a recording wrapper in front of whatever glad's pointers held. What the
+// frames before a capture leave behind is kept as the preamble, in tables holding the latest of
+// everything that can be set again: bindings and other context state, uniforms by program and
+// location, the contents of every buffer and the setup of every vertex array. Only the calls
+// creating objects and filling textures are kept in the order they were made, each after the
+// bindings it depends on; draws, clears and queries are dropped. The tables are written out when a
+// capture starts, the frames captured then hold every call as it was made, except for the waits
+// and timer queries of the application. The file is the preamble followed by the frames, see
+// GLStream for the encoding; once it is written the preamble goes on from the tables. Calls come
+// from the thread owning the context, begin may be called from any thread.
+class GLCapture
+{
+public:
+	// @dev put the recording wrappers in front of glad's function pointers, once
+	void install() {
+		if (installed) {
+			return;
+		}
+		installed = true;
+#define GL_RECORD(name) hook<ENTRY_##name>(glad_gl##name);
+#define GL_RECORD_PAIR(generate, remove, type) hook<ENTRY_##generate>(glad_gl##generate); hook<ENTRY_##remove>(glad_gl##remove);
+		GL_COUNTED_CALLS(GL_RECORD)
+		GL_ACCOUNTED_CALLS(GL_RECORD)
+		GL_OBJECT_CALLS(GL_RECORD_PAIR)
+#undef GL_RECORD
+#undef GL_RECORD_PAIR
+	}
+
+	// @return Whether the wrappers are in place
+	bool isInstalled() const {
+		return installed;
+	}
+
+	// @dev capture frames from the next beginFrame on
+	// @param width, height Size of the default framebuffer, the replay draws into a target of that size
+	void begin(const std::string& path, int frames, int width, int height) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!installed || frames <= 0) {
+			return;
+		}
+		request.path = path;
+		request.frames = frames;
+		request.width = width;
+		request.height = height;
+		requested = true;
+	}
+
+	// @dev the calls from here on belong to a new frame, a capture asked for starts with it
+	void beginFrame() {
+		if (!installed || capturing) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!requested) {
+				return;
+			}
+			requested = false;
+			current = request;
+			status = "Capturing " + std::to_string(current.frames) + " frames";
+		}
+		// the tables are made part of the preamble
+		for (auto& buffer : buffers) {
+			if (!buffer.second.written) {
+				writeBuffer(buffer.first, buffer.second);
+			}
+		}
+		for (auto& uniforms : pendingUniforms) {
+			encode(stream, ENTRY_UseProgram, &uniforms.first);
+			for (auto& uniform : uniforms.second) {
+				stream += uniform.second;
+			}
+			preamble.erase(SettingKey(ENTRY_UseProgram, 0, 0));
+		}
+		pendingUniforms.clear();
+		sync();
+		captureStart = stream.size();
+		frames.clear();
+		frameEnds.clear();
+		capturing = true;
+	}
+
+	// @dev end a frame, the capture is written once it has all its frames
+	void endFrame() {
+		if (!installed) {
+			return;
+		}
+		if (capturing) {
+			frameEnds.push_back(frames.size());
+			if ((int)frameEnds.size() == current.frames) {
+				capturing = false;
+				bool written = write();
+				std::string().swap(frames);
+				frameEnds.clear();
+				std::lock_guard<std::mutex> lock(mutex);
+				status = written ? "Wrote " + current.path : "Failed to write " + current.path;
+			}
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		recordedBytes = stream.size() + frames.size();
+	}
+
+	// @dev window asking for captures
+	void overlay() {
+		if (!installed) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		ImGui::Begin("GL capture");
+		ImGui::Text("%.1f MB recorded", recordedBytes / 1048576.0);
+		ImGui::SliderInt("Frames", &overlayFrames, 1, 300);
+		if (ImGui::Button("Capture") && !requested) {
+			ImGuiIO& io = ImGui::GetIO();
+			char path[64];
+			snprintf(path, sizeof(path), "capture_%d.glcap", saved++);
+			request.path = path;
+			request.frames = overlayFrames;
+			request.width = (int)(io.DisplaySize.x * io.DisplayFramebufferScale.x);
+			request.height = (int)(io.DisplaySize.y * io.DisplayFramebufferScale.y);
+			requested = true;
+		}
+		ImGui::Text("%s", status.c_str());
+		ImGui::End();
+	}
+
+	// makes GLCapture an instance
+	static GLCapture* getInstance() {
+		if (instance == NULL) {
+			instance = new GLCapture();
+		}
+		return instance;
+	}
+private:
+	typedef void (APIENTRYP GLProc)(void);
+
+	// @dev a capture asked for
+	typedef struct Request {
+		std::string path;
+		int frames = 0;
+		int width = 0;
+		int height = 0;
+	}Request;
+
+	// @dev range of a buffer mapped for writing, written when it is unmapped
+	typedef struct Mapping {
+		const void* data = NULL;
+		int64_t offset = 0;
+		int64_t length = 0;
+	}Mapping;
+
+	// @dev latest call setting a piece of state, with its arguments
+	typedef struct Setting {
+		int entry = 0;
+		int64_t slots[5] = {};
+	}Setting;
+	// entry point, or the first of a group setting the same state, and the arguments telling apart
+	// what is set
+	typedef std::tuple<int, int64_t, int64_t> SettingKey;
+
+	// @dev contents of a buffer as the calls left them
+	typedef struct Shadow {
+		std::string bytes;
+		int64_t usage = GL_STATIC_DRAW;
+		// the preamble holds these contents
+		bool written = false;
+	}Shadow;
+
+	// @dev an attribute of a vertex array, the buffer bound when it was pointed there
+	typedef struct Attribute {
+		int64_t buffer = 0;
+		int64_t pointer[6] = {};
+		bool pointed = false;
+		bool enabled = false;
+		int64_t divisor = 0;
+	}Attribute;
+
+	// @dev setup of a vertex array
+	typedef struct VertexArray {
+		std::map<int64_t, Attribute> attributes;
+		int64_t elements = 0;
+		// the preamble has generated the name, and holds this setup
+		bool generated = false;
+		bool written = false;
+	}VertexArray;
+
+	static GLCapture* instance;
+	bool installed = false;
+	// the functions the wrappers call, by GLEntryPoint
+	GLProc next[GL_ENTRY_POINTS] = {};
+	// the preamble, the frames of the running capture
+	std::string stream;
+	std::string frames;
+	// the call being recorded for the preamble and for the frames
+	std::string record;
+	std::string captured;
+	bool capturing = false;
+	Request current;
+	size_t captureStart = 0;
+	std::vector<size_t> frameEnds;
+	// state as the calls left it, also what later calls are recorded against
+	std::unordered_map<int64_t, int64_t> bound;
+	int64_t program = 0;
+	int64_t activeTexture = GL_TEXTURE0;
+	int64_t vertexArray = 0;
+	int unpackAlignment = 4;
+	int unpackRowLength = 0;
+	std::unordered_map<int64_t, Mapping> mappings;
+	std::map<SettingKey, Setting> settings;
+	std::map<int64_t, Shadow> buffers;
+	std::map<int64_t, VertexArray> arrays;
+	// latest value of a uniform by program and location, the locations already asked for by program
+	std::map<int64_t, std::map<int64_t, std::string>> pendingUniforms;
+	std::set<std::pair<int64_t, std::string>> locations;
+	// settings as replaying the preamble leaves them, those missing are unknown
+	std::map<SettingKey, Setting> preamble;
+	// guards what other threads read and write
+	std::mutex mutex;
+	bool requested = false;
+	Request request;
+	size_t recordedBytes = 0;
+	std::string status = "Idle";
+	int overlayFrames = 10;
+	int saved = 0;
+
+	GLCapture() {}
+
+	template <int ENTRY, typename R, typename... Args>
+	void hook(R (APIENTRYP& pointer)(Args...)) {
+		next[ENTRY] = (GLProc)pointer;
+		pointer = recorded<ENTRY, R, Args...>;
+	}
+
+	template <int ENTRY, typename R, typename... Args>
+	static R APIENTRY recorded(Args... args) {
+		GLCapture* capture = instance;
+		int64_t slots[] = { GLStream::toSlot(args)..., 0 };
+		capture->before(ENTRY, slots);
+		GLForward<R> result((R (APIENTRYP)(Args...))capture->next[ENTRY], args...);
+		capture->after(ENTRY, slots, result.slot());
+		return result.get();
+	}
+
+	// @return Whether a call only reads state or draws, those are left out of the preamble
+	static bool transient(int entry) {
+		switch (entry) {
+		case ENTRY_DrawArrays: case ENTRY_DrawArraysInstanced: case ENTRY_DrawElements: case ENTRY_DrawElementsInstanced:
+		case ENTRY_Clear: case ENTRY_ReadPixels: case ENTRY_CheckFramebufferStatus: case ENTRY_IsEnabled:
+		case ENTRY_GetInteger64v: case ENTRY_GetIntegerv: case ENTRY_GetProgramInfoLog: case ENTRY_GetProgramiv:
+		case ENTRY_GetShaderInfoLog: case ENTRY_GetShaderiv: case ENTRY_GetString: case ENTRY_GetStringi:
+			return true;
+		default:
+			return untimed(entry);
+		}
+	}
+
+	// @return Whether a call waits for the GPU or times it, those are left out of the frames as well,
+	// the replay times the frames itself
+	static bool untimed(int entry) {
+		switch (entry) {
+		case ENTRY_Finish: case ENTRY_GetQueryObjectiv: case ENTRY_GetQueryObjectui64v:
+		case ENTRY_BeginQuery: case ENTRY_EndQuery: case ENTRY_QueryCounter:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// @return Whether the preamble keeps a call in a table rather than in the order it was made
+	bool tabled(int entry, const int64_t* slots) {
+		switch (entry) {
+		case ENTRY_BindBuffer: case ENTRY_BufferData: case ENTRY_BufferSubData: case ENTRY_MapBufferRange: case ENTRY_UnmapBuffer:
+		case ENTRY_GenVertexArrays: case ENTRY_DeleteVertexArrays:
+		case ENTRY_VertexAttribPointer: case ENTRY_EnableVertexAttribArray: case ENTRY_VertexAttribDivisor:
+			return true;
+		default:
+			SettingKey key;
+			return settingKey(entry, slots, key);
+		}
+	}
+
+	// @return Whether a call sets state the preamble keeps the latest of, and the key it is kept by
+	bool settingKey(int entry, const int64_t* slots, SettingKey& key) {
+		switch (entry) {
+		case ENTRY_BindBuffer:
+			// the element buffer belongs to the vertex array
+			key = SettingKey(entry, slots[0], 0);
+			return slots[0] != GL_ELEMENT_ARRAY_BUFFER;
+		case ENTRY_BindBufferRange:
+			key = SettingKey(entry, slots[0], slots[1]);
+			return true;
+		case ENTRY_BindTexture:
+			key = SettingKey(entry, activeTexture, slots[0]);
+			return true;
+		case ENTRY_BindFramebuffer: case ENTRY_BindRenderbuffer: case ENTRY_BindSampler: case ENTRY_PixelStorei: case ENTRY_PolygonMode:
+			key = SettingKey(entry, slots[0], 0);
+			return true;
+		case ENTRY_Enable: case ENTRY_Disable:
+			key = SettingKey(ENTRY_Enable, slots[0], 0);
+			return true;
+		case ENTRY_BlendEquation: case ENTRY_BlendEquationSeparate:
+			key = SettingKey(ENTRY_BlendEquation, 0, 0);
+			return true;
+		case ENTRY_BlendFunc: case ENTRY_BlendFuncSeparate:
+			key = SettingKey(ENTRY_BlendFunc, 0, 0);
+			return true;
+		case ENTRY_ActiveTexture: case ENTRY_BindVertexArray: case ENTRY_UseProgram: case ENTRY_ClearColor: case ENTRY_ColorMask:
+		case ENTRY_CullFace: case ENTRY_DepthFunc: case ENTRY_DepthMask: case ENTRY_PolygonOffset: case ENTRY_Scissor: case ENTRY_Viewport:
+			key = SettingKey(entry, 0, 0);
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	static bool same(const Setting& a, const Setting& b) {
+		return a.entry == b.entry && memcmp(a.slots, b.slots, sizeof(a.slots)) == 0;
+	}
+
+	void set(const SettingKey& key, int entry, const int64_t* slots) {
+		Setting& setting = settings[key];
+		setting.entry = entry;
+		int arguments = GLStream::arity(entry);
+		for (int i = 0; i < 5; i++) {
+			setting.slots[i] = i < arguments ? slots[i] : 0;
+		}
+	}
+
+	// @dev write a call's entry point, arguments and the memory they point to
+	void encode(std::string& out, int entry, const int64_t* slots) {
+		GLStream::put(out, entry);
+		int arguments = GLStream::arity(entry);
+		for (int i = 0; i < arguments; i++) {
+			GLStream::put(out, slots[i]);
+		}
+		const char* roles = GLStream::roles(entry);
+		for (int i = 0; roles[i] != '\0'; i++) {
+			const void* data = (const void*)(intptr_t)slots[i];
+			if (roles[i] == 'd') {
+				bool client = data != NULL && !(GLStream::readsPixels(entry) && bound[GL_PIXEL_UNPACK_BUFFER] != 0);
+				GLStream::putBytes(out, client ? data : NULL, GLStream::dataBytes(entry, slots, unpackAlignment, unpackRowLength));
+			}
+			else if (roles[i] == 'n') {
+				GLStream::putBytes(out, data, data != NULL ? strlen((const char*)data) : 0);
+			}
+		}
+		if (GLStream::objectType(entry) >= 0 && !GLStream::generates(entry)) {
+			const GLuint* names = (const GLuint*)(intptr_t)slots[1];
+			for (int64_t i = 0; i < slots[0]; i++) {
+				GLStream::put(out, names[i]);
+			}
+		}
+		else if (entry == ENTRY_ShaderSource) {
+			const GLchar* const* strings = (const GLchar* const*)(intptr_t)slots[2];
+			const GLint* lengths = (const GLint*)(intptr_t)slots[3];
+			for (int64_t i = 0; i < slots[1]; i++) {
+				GLStream::putBytes(out, strings[i], lengths != NULL && lengths[i] >= 0 ? (size_t)lengths[i] : strlen(strings[i]));
+			}
+		}
+		else if (entry == ENTRY_UnmapBuffer) {
+			Mapping mapping = mappings[bound[slots[0]]];
+			GLStream::putBytes(out, mapping.data, (size_t)mapping.length);
+		}
+	}
+
+	void encodeBind(std::string& out, int64_t target, int64_t buffer) {
+		int64_t slots[] = { target, buffer };
+		encode(out, ENTRY_BindBuffer, slots);
+	}
+
+	// @dev hand the contents of a buffer to the preamble, through a target no vertex array holds
+	void writeBuffer(int64_t name, Shadow& shadow) {
+		encodeBind(stream, GL_COPY_WRITE_BUFFER, name);
+		int64_t slots[] = { GL_COPY_WRITE_BUFFER, (int64_t)shadow.bytes.size(), (int64_t)(intptr_t)shadow.bytes.data(), shadow.usage };
+		encode(stream, ENTRY_BufferData, slots);
+		preamble.erase(SettingKey(ENTRY_BindBuffer, GL_COPY_WRITE_BUFFER, 0));
+		shadow.written = true;
+	}
+
+	// @dev generate a vertex array in the preamble and set it up as the calls left it
+	void writeArray(int64_t name, VertexArray& array) {
+		if (!array.generated) {
+			int64_t generate[] = { 1, 0 };
+			encode(stream, ENTRY_GenVertexArrays, generate);
+			GLStream::put(stream, name);
+			array.generated = true;
+		}
+		encode(stream, ENTRY_BindVertexArray, &name);
+		for (auto& entry : array.attributes) {
+			Attribute& attribute = entry.second;
+			if (attribute.pointed) {
+				encodeBind(stream, GL_ARRAY_BUFFER, attribute.buffer);
+				encode(stream, ENTRY_VertexAttribPointer, attribute.pointer);
+			}
+			if (attribute.enabled) {
+				encode(stream, ENTRY_EnableVertexAttribArray, &entry.first);
+			}
+			int64_t divisor[] = { entry.first, attribute.divisor };
+			encode(stream, ENTRY_VertexAttribDivisor, divisor);
+		}
+		encodeBind(stream, GL_ELEMENT_ARRAY_BUFFER, array.elements);
+		preamble.erase(SettingKey(ENTRY_BindVertexArray, 0, 0));
+		preamble.erase(SettingKey(ENTRY_BindBuffer, GL_ARRAY_BUFFER, 0));
+		array.written = true;
+	}
+
+	// @dev bring the preamble's vertex arrays and settings up to the calls made so far
+	void sync() {
+		for (auto& array : arrays) {
+			if (!array.second.written) {
+				writeArray(array.first, array.second);
+			}
+		}
+		SettingKey active(ENTRY_ActiveTexture, 0, 0);
+		for (auto& entry : settings) {
+			auto written = preamble.find(entry.first);
+			if (entry.first == active || (written != preamble.end() && same(written->second, entry.second))) {
+				continue;
+			}
+			// a texture is bound to the unit it was bound to, a range binds the whole target too
+			if (entry.second.entry == ENTRY_BindTexture) {
+				encode(stream, ENTRY_ActiveTexture, &std::get<1>(entry.first));
+				preamble.erase(active);
+			}
+			else if (entry.second.entry == ENTRY_BindBufferRange) {
+				preamble.erase(SettingKey(ENTRY_BindBuffer, entry.second.slots[0], 0));
+			}
+			encode(stream, entry.second.entry, entry.second.slots);
+			preamble[entry.first] = entry.second;
+		}
+		auto unit = settings.find(active);
+		if (unit != settings.end()) {
+			auto written = preamble.find(active);
+			if (written == preamble.end() || !same(written->second, unit->second)) {
+				encode(stream, ENTRY_ActiveTexture, unit->second.slots);
+				preamble[active] = unit->second;
+			}
+		}
+	}
+
+	// @dev deleted names are no longer bound, in the settings and in the preamble alike
+	void unbind(char role, const GLuint* names, int64_t count) {
+		for (std::map<SettingKey, Setting>* table : { &settings, &preamble }) {
+			for (auto& entry : *table) {
+				const char* roles = GLStream::roles(entry.second.entry);
+				for (int i = 0; roles[i] != '\0'; i++) {
+					if (roles[i] == role && std::find(names, names + count, (GLuint)entry.second.slots[i]) != names + count) {
+						entry.second.slots[i] = 0;
+					}
+				}
+			}
+		}
+	}
+
+	void before(int entry, const int64_t* slots) {
+		record.clear();
+		captured.clear();
+		if (capturing && !untimed(entry)) {
+			encode(captured, entry, slots);
+		}
+		if (!transient(entry) && !tabled(entry, slots)) {
+			encode(record, entry, slots);
+		}
+		// pixels are read from a buffer as the preamble holds it
+		if (GLStream::readsPixels(entry)) {
+			auto buffer = buffers.find(bound[GL_PIXEL_UNPACK_BUFFER]);
+			if (buffer != buffers.end() && !buffer->second.written) {
+				writeBuffer(buffer->first, buffer->second);
+			}
+		}
+	}
+
+	void after(int entry, const int64_t* slots, int64_t result) {
+		for (std::string* out : { &captured, &record }) {
+			if (!out->empty() && GLStream::generates(entry)) {
+				const GLuint* names = (const GLuint*)(intptr_t)slots[1];
+				for (int64_t i = 0; i < slots[0]; i++) {
+					GLStream::put(*out, names[i]);
+				}
+			}
+			else if (!out->empty() && GLStream::returnsName(entry)) {
+				GLStream::put(*out, result);
+			}
+		}
+		frames += captured;
+		track(entry, slots, result);
+		if (record.empty()) {
+			return;
+		}
+		// locations are asked for once a link, a uniform keeps its latest value
+		if (entry == ENTRY_GetUniformLocation) {
+			if (!locations.insert(std::make_pair(slots[0], std::string((const char*)(intptr_t)slots[1]))).second) {
+				return;
+			}
+		}
+		else if (GLStream::roles(entry)[0] == 'l') {
+			// without a program in use GL turns the uniform down
+			if (slots[0] >= 0 && program != 0) {
+				pendingUniforms[program][slots[0]] = record;
+			}
+			return;
+		}
+		sync();
+		stream += record;
+	}
+
+	// @dev follow the state later calls are recorded against and keep the tables
+	void track(int entry, const int64_t* slots, int64_t result) {
+		SettingKey key;
+		if (settingKey(entry, slots, key)) {
+			if (entry == ENTRY_BindFramebuffer && slots[0] == GL_FRAMEBUFFER) {
+				int64_t draw[] = { GL_DRAW_FRAMEBUFFER, slots[1] };
+				int64_t read[] = { GL_READ_FRAMEBUFFER, slots[1] };
+				set(SettingKey(entry, GL_DRAW_FRAMEBUFFER, 0), entry, draw);
+				set(SettingKey(entry, GL_READ_FRAMEBUFFER, 0), entry, read);
+			}
+			else {
+				set(key, entry, slots);
+			}
+		}
+		switch (entry) {
+		case ENTRY_ActiveTexture:
+			activeTexture = slots[0];
+			break;
+		case ENTRY_BindBuffer:
+			bound[slots[0]] = slots[1];
+			if (slots[0] == GL_ELEMENT_ARRAY_BUFFER && arrays.count(vertexArray) > 0) {
+				VertexArray& array = arrays[vertexArray];
+				array.elements = slots[1];
+				array.written = false;
+			}
+			break;
+		case ENTRY_BindBufferRange:
+			// binding a range binds the whole target as well
+			bound[slots[0]] = slots[2];
+			{
+				int64_t whole[] = { slots[0], slots[2] };
+				set(SettingKey(ENTRY_BindBuffer, slots[0], 0), ENTRY_BindBuffer, whole);
+			}
+			break;
+		case ENTRY_BindVertexArray:
+			vertexArray = slots[0];
+			bound[GL_ELEMENT_ARRAY_BUFFER] = arrays.count(vertexArray) > 0 ? arrays[vertexArray].elements : 0;
+			break;
+		case ENTRY_UseProgram:
+			program = slots[0];
+			break;
+		case ENTRY_LinkProgram: case ENTRY_DeleteProgram:
+			pendingUniforms.erase(slots[0]);
+			for (auto location = locations.begin(); location != locations.end();) {
+				location = location->first == slots[0] ? locations.erase(location) : std::next(location);
+			}
+			break;
+		case ENTRY_PixelStorei:
+			if (slots[0] == GL_UNPACK_ALIGNMENT) {
+				unpackAlignment = (int)slots[1];
+			}
+			else if (slots[0] == GL_UNPACK_ROW_LENGTH) {
+				unpackRowLength = (int)slots[1];
+			}
+			break;
+		case ENTRY_BufferData: {
+			if (bound[slots[0]] == 0) {
+				break;
+			}
+			Shadow& shadow = buffers[bound[slots[0]]];
+			const char* data = (const char*)(intptr_t)slots[2];
+			shadow.bytes = data != NULL ? std::string(data, (size_t)slots[1]) : std::string((size_t)slots[1], '\0');
+			shadow.usage = slots[3];
+			shadow.written = false;
+			break;
+		}
+		case ENTRY_BufferSubData: {
+			if (buffers.count(bound[slots[0]]) == 0) {
+				break;
+			}
+			Shadow& shadow = buffers[bound[slots[0]]];
+			if (slots[1] >= 0 && slots[1] + slots[2] <= (int64_t)shadow.bytes.size()) {
+				memcpy(&shadow.bytes[(size_t)slots[1]], (const void*)(intptr_t)slots[3], (size_t)slots[2]);
+			}
+			shadow.written = false;
+			break;
+		}
+		case ENTRY_MapBufferRange:
+			if (slots[3] & GL_MAP_WRITE_BIT) {
+				Mapping& mapping = mappings[bound[slots[0]]];
+				mapping.data = (const void*)(intptr_t)result;
+				mapping.offset = slots[1];
+				mapping.length = slots[2];
+			}
+			break;
+		case ENTRY_UnmapBuffer: {
+			auto mapping = mappings.find(bound[slots[0]]);
+			if (mapping != mappings.end() && buffers.count(mapping->first) > 0) {
+				Shadow& shadow = buffers[mapping->first];
+				if (mapping->second.data != NULL && mapping->second.offset + mapping->second.length <= (int64_t)shadow.bytes.size()) {
+					memcpy(&shadow.bytes[(size_t)mapping->second.offset], mapping->second.data, (size_t)mapping->second.length);
+				}
+				shadow.written = false;
+				mappings.erase(mapping);
+			}
+			break;
+		}
+		case ENTRY_VertexAttribPointer: case ENTRY_EnableVertexAttribArray: case ENTRY_VertexAttribDivisor: {
+			if (arrays.count(vertexArray) == 0) {
+				break;
+			}
+			VertexArray& array = arrays[vertexArray];
+			Attribute& attribute = array.attributes[slots[0]];
+			if (entry == ENTRY_VertexAttribPointer) {
+				attribute.buffer = bound[GL_ARRAY_BUFFER];
+				std::copy(slots, slots + 6, attribute.pointer);
+				attribute.pointed = true;
+			}
+			else if (entry == ENTRY_EnableVertexAttribArray) {
+				attribute.enabled = true;
+			}
+			else {
+				attribute.divisor = slots[1];
+			}
+			array.written = false;
+			break;
+		}
+		case ENTRY_GenVertexArrays: {
+			const GLuint* names = (const GLuint*)(intptr_t)slots[1];
+			for (int64_t i = 0; i < slots[0]; i++) {
+				arrays[names[i]] = VertexArray();
+			}
+			break;
+		}
+		case ENTRY_DeleteVertexArrays: {
+			const GLuint* names = (const GLuint*)(intptr_t)slots[1];
+			for (int64_t i = 0; i < slots[0]; i++) {
+				auto array = arrays.find(names[i]);
+				if (array == arrays.end()) {
+					continue;
+				}
+				// arrays the preamble never generated are left out of it
+				if (array->second.generated) {
+					int64_t remove[] = { 1, (int64_t)(intptr_t)&names[i] };
+					encode(stream, ENTRY_DeleteVertexArrays, remove);
+				}
+				arrays.erase(array);
+				if (vertexArray == names[i]) {
+					vertexArray = 0;
+					bound[GL_ELEMENT_ARRAY_BUFFER] = 0;
+				}
+			}
+			unbind('v', names, slots[0]);
+			break;
+		}
+		case ENTRY_DeleteBuffers: {
+			const GLuint* names = (const GLuint*)(intptr_t)slots[1];
+			for (int64_t i = 0; i < slots[0]; i++) {
+				buffers.erase(names[i]);
+				for (auto& binding : bound) {
+					binding.second = binding.second == names[i] ? 0 : binding.second;
+				}
+			}
+			unbind('b', names, slots[0]);
+			break;
+		}
+		case ENTRY_DeleteTextures:
+			unbind('t', (const GLuint*)(intptr_t)slots[1], slots[0]);
+			break;
+		case ENTRY_DeleteFramebuffers:
+			unbind('f', (const GLuint*)(intptr_t)slots[1], slots[0]);
+			break;
+		case ENTRY_DeleteRenderbuffers:
+			unbind('r', (const GLuint*)(intptr_t)slots[1], slots[0]);
+			break;
+		default:
+			break;
+		}
+	}
+
+	// @dev write the preamble and the captured frames
+	bool write() {
+		FILE* out = fopen(current.path.c_str(), "wb");
+		if (out == NULL) {
+			std::cout << "Failed to write " << current.path << std::endl;
+			return false;
+		}
+		std::string header(GLStream::magic(), 8);
+		GLStream::put(header, GLStream::VERSION);
+		GLStream::put(header, current.width);
+		GLStream::put(header, current.height);
+		GLStream::put(header, GL_ENTRY_POINTS);
+		for (int entry = 0; entry < GL_ENTRY_POINTS; entry++) {
+			const char* name = GLCounters::entryName(entry);
+			GLStream::putBytes(header, name, strlen(name));
+		}
+		GLStream::put(header, (int64_t)captureStart);
+		GLStream::put(header, (int64_t)frameEnds.size());
+		size_t previous = 0;
+		for (size_t end : frameEnds) {
+			GLStream::put(header, (int64_t)(end - previous));
+			previous = end;
+		}
+		fwrite(header.data(), 1, header.size(), out);
+		fwrite(stream.data(), 1, captureStart, out);
+		fwrite(frames.data(), 1, frames.size(), out);
+		fclose(out);
+		std::cout << "Captured " << frameEnds.size() << " frames after a preamble of " << captureStart / 1024 << " KB, "
+			<< frames.size() / 1024 << " KB of frames, to " << current.path << std::endl;
+		return true;
+	}
+};
+
+GLCapture* GLCapture::instance = NULL;
@@ -0,0 +1,465 @@
+#pragma once
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+#include "imgui.h"
+
+// entry points only counted, named without their gl prefix
+#define GL_COUNTED_CALLS(X) \
+	X(ActiveTexture) X(AttachShader) X(BeginQuery) X(BindBufferRange) X(BindFramebuffer) X(BindRenderbuffer) \
+	X(BindSampler) X(BindTexture) X(BindVertexArray) X(BlendEquation) X(BlendEquationSeparate) X(BlendFunc) \
+	X(BlendFuncSeparate) X(CheckFramebufferStatus) X(Clear) X(ClearColor) X(ColorMask) X(CompileShader) \
+	X(CullFace) X(DepthFunc) X(DepthMask) X(DetachShader) X(Disable) X(DrawArrays) X(DrawArraysInstanced) \
+	X(DrawBuffer) X(DrawElements) X(DrawElementsInstanced) X(Enable) X(EnableVertexAttribArray) X(EndQuery) \
+	X(Finish) X(FramebufferRenderbuffer) X(FramebufferTexture) X(FramebufferTexture2D) X(FramebufferTextureLayer) \
+	X(GenerateMipmap) X(GetAttribLocation) X(GetInteger64v) X(GetIntegerv) X(GetProgramInfoLog) X(GetProgramiv) \
+	X(GetQueryObjectiv) X(GetQueryObjectui64v) X(GetShaderInfoLog) X(GetShaderiv) X(GetString) X(GetStringi) \
+	X(GetUniformBlockIndex) X(GetUniformLocation) X(IsEnabled) X(LinkProgram) X(PixelStorei) X(PolygonMode) \
+	X(PolygonOffset) X(QueryCounter) X(ReadBuffer) X(ReadPixels) X(RenderbufferStorage) X(Scissor) X(ShaderSource) \
+	X(TexParameterfv) X(TexParameteri) X(Uniform1f) X(Uniform1i) X(Uniform2f) X(Uniform2fv) X(Uniform3f) \
+	X(Uniform3fv) X(Uniform4f) X(Uniform4fv) X(UniformBlockBinding) X(UniformMatrix2fv) X(UniformMatrix3fv) \
+	X(UniformMatrix4fv) X(UnmapBuffer) X(UseProgram) X(VertexAttribDivisor) X(VertexAttribPointer) X(Viewport)
+
+// entry points counted and accounted for by a wrapper of their own
+#define GL_ACCOUNTED_CALLS(X) \
+	X(BindBuffer) X(BufferData) X(BufferSubData) X(MapBufferRange) X(TexImage2D) X(TexImage3D) X(TexSubImage2D) \
+	X(TexSubImage3D) X(CompressedTexImage2D) X(CreateShader) X(DeleteShader) X(CreateProgram) X(DeleteProgram)
+
+// entry points generating and deleting names of an object type, X(generate, delete, type)
+#define GL_OBJECT_CALLS(X) \
+	X(GenBuffers, DeleteBuffers, OBJECT_BUFFERS) \
+	X(GenTextures, DeleteTextures, OBJECT_TEXTURES) \
+	X(GenVertexArrays, DeleteVertexArrays, OBJECT_VERTEX_ARRAYS) \
+	X(GenFramebuffers, DeleteFramebuffers, OBJECT_FRAMEBUFFERS) \
+	X(GenRenderbuffers, DeleteRenderbuffers, OBJECT_RENDERBUFFERS) \
+	X(GenQueries, DeleteQueries, OBJECT_QUERIES)
+
+#define GL_ENTRY(name) ENTRY_##name,
+#define GL_ENTRY_PAIR(generate, remove, type) ENTRY_##generate, ENTRY_##remove,
+// every watched entry point
+enum GLEntryPoint {
+	GL_COUNTED_CALLS(GL_ENTRY)
+	GL_ACCOUNTED_CALLS(GL_ENTRY)
+	GL_OBJECT_CALLS(GL_ENTRY_PAIR)
+	GL_ENTRY_POINTS
+};
+#undef GL_ENTRY
+#undef GL_ENTRY_PAIR
+
+// kinds of GL objects kept track of
+enum GLObjectType {
+	OBJECT_BUFFERS, OBJECT_TEXTURES, OBJECT_VERTEX_ARRAYS, OBJECT_FRAMEBUFFERS, OBJECT_RENDERBUFFERS,
+	OBJECT_QUERIES, OBJECT_SHADERS, OBJECT_PROGRAMS, GL_OBJECT_TYPES
+};
+
+// @dev totals of the GL calls GLCounters watches since they were last taken
+typedef struct GLCounts {
+	// calls of every GLEntryPoint
+	long long calls[GL_ENTRY_POINTS] = {};
+	long long drawCalls = 0;
+	long long uniformUploads = 0;
+	// bytes given to glBufferData and glBufferSubData and of buffer ranges mapped for writing
+	long long bufferBytes = 0;
+	// bytes of texture images read from client memory, uploads from a pixel buffer are in bufferBytes
+	long long textureBytes = 0;
+	// objects of every GLObjectType alive when the counts were taken
+	long long liveObjects[GL_OBJECT_TYPES] = {};
+}GLCounts;
+
+// @dev Accounts for what the application asks of GL by putting wrappers in front of glad's function
+// pointers: calls of every entry point the application uses, bytes uploaded into buffers and textures
+// and the names of the objects alive, by type. Nothing is counted before install, which has to follow
+// gladLoadGLLoader so that every object is seen being created, and the counters are plain integers:
+// only one thread at a time may use the context, take closes a frame on it. The counts of the last
+// frame taken may be read from any thread. What is still alive after the application has released
+// everything is a leak, reportLeaks lists it.
+class GLCounters
+{
+public:
+	GLCounts counts;
+	// bytes uploaded since install
+	long long totalBufferBytes = 0;
+	long long totalTextureBytes = 0;
+
+	// @dev replace the watched function pointers by the counting wrappers, once
+	void install() {
+		if (installed) {
+			return;
+		}
+		installed = true;
+#define GL_HOOK(name) hook<ENTRY_##name>(glad_gl##name);
+		GL_COUNTED_CALLS(GL_HOOK)
+#undef GL_HOOK
+#define GL_HOOK_OBJECTS(generate, remove, type) \
+		replace(ENTRY_##generate, glad_gl##generate, generateObjects<ENTRY_##generate, type>); \
+		replace(ENTRY_##remove, glad_gl##remove, deleteObjects<ENTRY_##remove, type>);
+		GL_OBJECT_CALLS(GL_HOOK_OBJECTS)
+#undef GL_HOOK_OBJECTS
+		replace(ENTRY_BindBuffer, glad_glBindBuffer, countBindBuffer);
+		replace(ENTRY_BufferData, glad_glBufferData, countBufferData);
+		replace(ENTRY_BufferSubData, glad_glBufferSubData, countBufferSubData);
+		replace(ENTRY_MapBufferRange, glad_glMapBufferRange, countMapBufferRange);
+		replace(ENTRY_TexImage2D, glad_glTexImage2D, countTexImage2D);
+		replace(ENTRY_TexImage3D, glad_glTexImage3D, countTexImage3D);
+		replace(ENTRY_TexSubImage2D, glad_glTexSubImage2D, countTexSubImage2D);
+		replace(ENTRY_TexSubImage3D, glad_glTexSubImage3D, countTexSubImage3D);
+		replace(ENTRY_CompressedTexImage2D, glad_glCompressedTexImage2D, countCompressedTexImage2D);
+		replace(ENTRY_CreateShader, glad_glCreateShader, countCreateShader);
+		replace(ENTRY_DeleteShader, glad_glDeleteShader, countDeleteShader);
+		replace(ENTRY_CreateProgram, glad_glCreateProgram, countCreateProgram);
+		replace(ENTRY_DeleteProgram, glad_glDeleteProgram, countDeleteProgram);
+	}
+
+	// @return Whether the wrappers are in place
+	bool isInstalled() const {
+		return installed;
+	}
+
+	// @dev close a frame on the thread using the context, its counts are shown by overlay
+	// @return Counts since the last call, the counters start again from zero
+	GLCounts take() {
+		GLCounts taken = counts;
+		counts = GLCounts();
+		const int draws[] = { ENTRY_DrawArrays, ENTRY_DrawArraysInstanced, ENTRY_DrawElements, ENTRY_DrawElementsInstanced };
+		for (int entry : draws) {
+			taken.drawCalls += taken.calls[entry];
+		}
+		const int uniforms[] = { ENTRY_Uniform1f, ENTRY_Uniform1i, ENTRY_Uniform2f, ENTRY_Uniform2fv, ENTRY_Uniform3f, ENTRY_Uniform3fv,
+			ENTRY_Uniform4f, ENTRY_Uniform4fv, ENTRY_UniformMatrix2fv, ENTRY_UniformMatrix3fv, ENTRY_UniformMatrix4fv };
+		for (int entry : uniforms) {
+			taken.uniformUploads += taken.calls[entry];
+		}
+		for (int type = 0; type < GL_OBJECT_TYPES; type++) {
+			taken.liveObjects[type] = (long long)live[type].size();
+		}
+		totalBufferBytes += taken.bufferBytes;
+		totalTextureBytes += taken.textureBytes;
+		std::lock_guard<std::mutex> lock(mutex);
+		last = taken;
+		lastPeak = std::vector<long long>(peak, peak + GL_OBJECT_TYPES);
+		lastTotalBufferBytes = totalBufferBytes;
+		lastTotalTextureBytes = totalTextureBytes;
+		return taken;
+	}
+
+	// @return Number of objects of a type alive now, call on the thread using the context
+	long long liveObjects(int type) const {
+		return (long long)live[type].size();
+	}
+
+	// @dev print every object still alive, call once the application has released what it created
+	// @return Number of objects leaked
+	long long reportLeaks() {
+		if (!installed) {
+			return 0;
+		}
+		long long leaked = 0;
+		for (int type = 0; type < GL_OBJECT_TYPES; type++) {
+			if (live[type].empty()) {
+				continue;
+			}
+			std::vector<GLuint> names(live[type].begin(), live[type].end());
+			std::sort(names.begin(), names.end());
+			std::cout << "GL leak: " << names.size() << " " << objectName(type) << " still alive:";
+			for (int i = 0; i < (int)names.size() && i < 16; i++) {
+				std::cout << " " << names[i];
+			}
+			if (names.size() > 16) {
+				std::cout << " ...";
+			}
+			std::cout << std::endl;
+			leaked += (long long)names.size();
+		}
+		if (leaked == 0) {
+			std::cout << "No GL objects leaked" << std::endl;
+		}
+		return leaked;
+	}
+
+	// @dev window with the calls, uploads and live objects of the last frame taken
+	void overlay() {
+		if (!installed) {
+			return;
+		}
+		GLCounts shown;
+		std::vector<long long> shownPeak;
+		long long bufferTotal = 0, textureTotal = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			shown = last;
+			shownPeak = lastPeak;
+			bufferTotal = lastTotalBufferBytes;
+			textureTotal = lastTotalTextureBytes;
+		}
+		ImGui::Begin("GL calls");
+		ImGui::Text("%lld draws, %lld uniform uploads", shown.drawCalls, shown.uniformUploads);
+		ImGui::Text("Uploaded %.1f KB to buffers, %.1f KB to textures", shown.bufferBytes / 1024.0, shown.textureBytes / 1024.0);
+		ImGui::Text("Since start %.1f MB to buffers, %.1f MB to textures", bufferTotal / 1048576.0, textureTotal / 1048576.0);
+		ImGui::Separator();
+		ImGui::Columns(3, "objects");
+		ImGui::Text("Objects");
+		ImGui::NextColumn();
+		ImGui::Text("Alive");
+		ImGui::NextColumn();
+		ImGui::Text("Peak");
+		ImGui::NextColumn();
+		for (int type = 0; type < GL_OBJECT_TYPES && type < (int)shownPeak.size(); type++) {
+			ImGui::Text("%s", objectName(type));
+			ImGui::NextColumn();
+			ImGui::Text("%lld", shown.liveObjects[type]);
+			ImGui::NextColumn();
+			ImGui::Text("%lld", shownPeak[type]);
+			ImGui::NextColumn();
+		}
+		ImGui::Columns(1);
+		ImGui::Separator();
+		// the busiest entry points first
+		std::vector<int> entries;
+		for (int entry = 0; entry < GL_ENTRY_POINTS; entry++) {
+			if (shown.calls[entry] > 0) {
+				entries.push_back(entry);
+			}
+		}
+		std::sort(entries.begin(), entries.end(), [&](int a, int b) { return shown.calls[a] > shown.calls[b]; });
+		ImGui::Columns(2, "calls");
+		for (int entry : entries) {
+			ImGui::Text("%s", entryName(entry));
+			ImGui::NextColumn();
+			ImGui::Text("%lld", shown.calls[entry]);
+			ImGui::NextColumn();
+		}
+		ImGui::Columns(1);
+		ImGui::End();
+	}
+
+	// @return Name of a GLEntryPoint, glDrawArrays for ENTRY_DrawArrays
+	static const char* entryName(int entry) {
+#define GL_NAME(name) "gl" #name,
+#define GL_NAME_PAIR(generate, remove, type) "gl" #generate, "gl" #remove,
+		static const char* names[] = {
+			GL_COUNTED_CALLS(GL_NAME)
+			GL_ACCOUNTED_CALLS(GL_NAME)
+			GL_OBJECT_CALLS(GL_NAME_PAIR)
+		};
+#undef GL_NAME
+#undef GL_NAME_PAIR
+		return names[entry];
+	}
+
+	// @return Name of a GLObjectType
+	static const char* objectName(int type) {
+		static const char* names[] = { "buffers", "textures", "vertexArrays", "framebuffers", "renderbuffers", "queries", "shaders", "programs" };
+		return names[type];
+	}
+
+	// @dev bytes of an image in client memory, rows are taken as tightly packed
+	static long long imageBytes(GLenum format, GLenum type, GLsizei width, GLsizei height, GLsizei depth) {
+		int components = 4;
+		switch (format) {
+		case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX:
+			components = 1;
+			break;
+		case GL_RG: case GL_RG_INTEGER: case GL_DEPTH_STENCIL:
+			components = 2;
+			break;
+		case GL_RGB: case GL_BGR: case GL_RGB_INTEGER:
+			components = 3;
+			break;
+		default:
+			break;
+		}
+		int size = 1;
+		switch (type) {
+		case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+			size = 2;
+			break;
+		case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT:
+			size = 4;
+			break;
+		// packed types hold the whole pixel
+		case GL_UNSIGNED_INT_24_8: case GL_UNSIGNED_INT_8_8_8_8: case GL_UNSIGNED_INT_8_8_8_8_REV: case GL_UNSIGNED_INT_2_10_10_10_REV:
+			size = 4;
+			components = 1;
+			break;
+		case GL_UNSIGNED_SHORT_5_6_5: case GL_UNSIGNED_SHORT_4_4_4_4: case GL_UNSIGNED_SHORT_5_5_5_1:
+			size = 2;
+			components = 1;
+			break;
+		default:
+			break;
+		}
+		return (long long)width * height * depth * components * size;
+	}
+
+	// makes GLCounters an instance
+	static GLCounters* getInstance() {
+		if (instance == NULL) {
+			instance = new GLCounters();
+		}
+		return instance;
+	}
+private:
+	typedef void (APIENTRYP GLProc)(void);
+
+	static GLCounters* instance;
+	bool installed = false;
+	// the functions glad loaded, by GLEntryPoint
+	GLProc loaded[GL_ENTRY_POINTS] = {};
+	// buffer bound to GL_PIXEL_UNPACK_BUFFER, texture uploads read from it instead of client memory
+	GLuint unpackBuffer = 0;
+	// names alive and the most alive at once, by GLObjectType
+	std::unordered_set<GLuint> live[GL_OBJECT_TYPES];
+	long long peak[GL_OBJECT_TYPES] = {};
+	// guards what overlay reads
+	std::mutex mutex;
+	GLCounts last;
+	std::vector<long long> lastPeak;
+	long long lastTotalBufferBytes = 0;
+	long long lastTotalTextureBytes = 0;
+
+	GLCounters() {}
+
+	// @dev keep the function glad loaded for an entry point and put a wrapper in its place
+	template <typename F>
+	void replace(int entry, F& pointer, F wrapper) {
+		loaded[entry] = (GLProc)pointer;
+		pointer = wrapper;
+	}
+
+	// @dev put a wrapper only counting calls in front of an entry point
+	template <int ENTRY, typename R, typename... Args>
+	void hook(R (APIENTRYP& pointer)(Args...)) {
+		replace(ENTRY, pointer, counted<ENTRY, R, Args...>);
+	}
+
+	// @return The function glad loaded for an entry point, as the type of its pointer
+	template <typename F>
+	static F original(int entry, F) {
+		return (F)instance->loaded[entry];
+	}
+
+	void created(int type, GLuint name) {
+		if (name == 0) {
+			return;
+		}
+		live[type].insert(name);
+		peak[type] = std::max(peak[type], (long long)live[type].size());
+	}
+
+	void deleted(int type, GLuint name) {
+		live[type].erase(name);
+	}
+
+	// @dev count the bytes of a texture upload unless they come from a pixel buffer
+	void countImage(const void* pixels, long long bytes) {
+		if (pixels != NULL && unpackBuffer == 0) {
+			counts.textureBytes += bytes;
+		}
+	}
+
+	template <int ENTRY, typename R, typename... Args>
+	static R APIENTRY counted(Args... args) {
+		instance->counts.calls[ENTRY]++;
+		return ((R (APIENTRYP)(Args...))instance->loaded[ENTRY])(args...);
+	}
+
+	template <int ENTRY, int TYPE>
+	static void APIENTRY generateObjects(GLsizei n, GLuint* names) {
+		instance->counts.calls[ENTRY]++;
+		original(ENTRY, glad_glGenBuffers)(n, names);
+		for (GLsizei i = 0; i < n; i++) {
+			instance->created(TYPE, names[i]);
+		}
+	}
+
+	template <int ENTRY, int TYPE>
+	static void APIENTRY deleteObjects(GLsizei n, const GLuint* names) {
+		instance->counts.calls[ENTRY]++;
+		original(ENTRY, glad_glDeleteBuffers)(n, names);
+		for (GLsizei i = 0; i < n; i++) {
+			instance->deleted(TYPE, names[i]);
+		}
+	}
+
+	static void APIENTRY countBindBuffer(GLenum target, GLuint buffer) {
+		instance->counts.calls[ENTRY_BindBuffer]++;
+		if (target == GL_PIXEL_UNPACK_BUFFER) {
+			instance->unpackBuffer = buffer;
+		}
+		original(ENTRY_BindBuffer, glad_glBindBuffer)(target, buffer);
+	}
+	static void APIENTRY countBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+		instance->counts.calls[ENTRY_BufferData]++;
+		// without data the store is only allocated
+		if (data != NULL) {
+			instance->counts.bufferBytes += size;
+		}
+		original(ENTRY_BufferData, glad_glBufferData)(target, size, data, usage);
+	}
+	static void APIENTRY countBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+		instance->counts.calls[ENTRY_BufferSubData]++;
+		instance->counts.bufferBytes += size;
+		original(ENTRY_BufferSubData, glad_glBufferSubData)(target, offset, size, data);
+	}
+	static void* APIENTRY countMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+		instance->counts.calls[ENTRY_MapBufferRange]++;
+		if (access & GL_MAP_WRITE_BIT) {
+			instance->counts.bufferBytes += length;
+		}
+		return original(ENTRY_MapBufferRange, glad_glMapBufferRange)(target, offset, length, access);
+	}
+	static void APIENTRY countTexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels) {
+		instance->counts.calls[ENTRY_TexImage2D]++;
+		instance->countImage(pixels, imageBytes(format, type, width, height, 1));
+		original(ENTRY_TexImage2D, glad_glTexImage2D)(target, level, internalFormat, width, height, border, format, type, pixels);
+	}
+	static void APIENTRY countTexImage3D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels) {
+		instance->counts.calls[ENTRY_TexImage3D]++;
+		instance->countImage(pixels, imageBytes(format, type, width, height, depth));
+		original(ENTRY_TexImage3D, glad_glTexImage3D)(target, level, internalFormat, width, height, depth, border, format, type, pixels);
+	}
+	static void APIENTRY countTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) {
+		instance->counts.calls[ENTRY_TexSubImage2D]++;
+		instance->countImage(pixels, imageBytes(format, type, width, height, 1));
+		original(ENTRY_TexSubImage2D, glad_glTexSubImage2D)(target, level, x, y, width, height, format, type, pixels);
+	}
+	static void APIENTRY countTexSubImage3D(GLenum target, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels) {
+		instance->counts.calls[ENTRY_TexSubImage3D]++;
+		instance->countImage(pixels, imageBytes(format, type, width, height, depth));
+		original(ENTRY_TexSubImage3D, glad_glTexSubImage3D)(target, level, x, y, z, width, height, depth, format, type, pixels);
+	}
+	static void APIENTRY countCompressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void* data) {
+		instance->counts.calls[ENTRY_CompressedTexImage2D]++;
+		instance->countImage(data, imageSize);
+		original(ENTRY_CompressedTexImage2D, glad_glCompressedTexImage2D)(target, level, internalFormat, width, height, border, imageSize, data);
+	}
+	static GLuint APIENTRY countCreateShader(GLenum type) {
+		instance->counts.calls[ENTRY_CreateShader]++;
+		GLuint shader = original(ENTRY_CreateShader, glad_glCreateShader)(type);
+		instance->created(OBJECT_SHADERS, shader);
+		return shader;
+	}
+	static void APIENTRY countDeleteShader(GLuint shader) {
+		instance->counts.calls[ENTRY_DeleteShader]++;
+		original(ENTRY_DeleteShader, glad_glDeleteShader)(shader);
+		instance->deleted(OBJECT_SHADERS, shader);
+	}
+	static GLuint APIENTRY countCreateProgram() {
+		instance->counts.calls[ENTRY_CreateProgram]++;
+		GLuint program = original(ENTRY_CreateProgram, glad_glCreateProgram)();
+		instance->created(OBJECT_PROGRAMS, program);
+		return program;
+	}
+	static void APIENTRY countDeleteProgram(GLuint program) {
+		instance->counts.calls[ENTRY_DeleteProgram]++;
+		original(ENTRY_DeleteProgram, glad_glDeleteProgram)(program);
+		instance->deleted(OBJECT_PROGRAMS, program);
+	}
+};
+
+GLCounters* GLCounters::instance = NULL;
@@ -0,0 +1,656 @@
+#pragma once
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "GLCapture.h"
+#include "GLCounters.h"
+#include "HeadlessRenderer.h"
+#include "SceneBenchmark.h"
+
+// @dev how a capture is replayed
+typedef struct ReplayOptions {
+	std::string capture;
+	// times the captured frames are replayed and measured
+	int loops = 10;
+	// times they are replayed before, not measured
+	int warmup = 1;
+	// results, none writes nothing
+	std::string output = "replay.json";
+}ReplayOptions;
+
+// @dev Replay of a capture written by GLCapture, run with
+//   CubeHappyLand --replay file.glcap [--loops n] [--warmup n] [--output file.json|none]
+// The calls are decoded once, before anything is timed: arguments are kept as they were written and
+// the memory they pointed to is copied into one arena, so replaying a call is a table lookup and a
+// call through glad. Names of objects and uniform locations are mapped from the captured ones to
+// the ones this context hands out, the default framebuffer is replaced by a target of the captured
+// size. The preamble is replayed once, then the frames are replayed in a loop, each one timed on
+// the CPU up to its last call, up to glFinish and on the GPU between two GL_TIMESTAMP queries.
+// Running the same capture on two builds or drivers compares what they spend on the same calls.
+class GLReplay
+{
+public:
+	ReplayOptions options;
+
+	GLReplay() {}
+	~GLReplay() {}
+
+	// @dev read the options following --replay
+	// @param first Index of the capture in argv
+	// @return false after printing the usage if an option is unknown or its value malformed
+	static bool parse(int argc, char** argv, int first, ReplayOptions& options) {
+		if (first < argc) {
+			options.capture = argv[first];
+		}
+		bool valid = !options.capture.empty() && options.capture[0] != '-';
+		for (int i = first + 1; i < argc && valid; i += 2) {
+			const char* name = argv[i];
+			const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+			if (value == NULL) {
+				valid = false;
+			}
+			else if (strcmp(name, "--loops") == 0) {
+				options.loops = atoi(value);
+				valid = options.loops > 0;
+			}
+			else if (strcmp(name, "--warmup") == 0) {
+				options.warmup = atoi(value);
+				valid = options.warmup >= 0;
+			}
+			else if (strcmp(name, "--output") == 0) {
+				options.output = strcmp(value, "none") == 0 ? "" : value;
+			}
+			else {
+				valid = false;
+			}
+			if (!valid) {
+				std::cout << "Invalid replay option " << name << (value != NULL ? " " : "") << (value != NULL ? value : "") << std::endl;
+			}
+		}
+		if (!valid) {
+			std::cout << "usage: CubeHappyLand --replay file.glcap [--loops n] [--warmup n] [--output file.json|none]" << std::endl;
+		}
+		return valid;
+	}
+
+	// @dev replay the capture without a window and write the results
+	// @return 0 on success, for the exit code
+	int run() {
+		std::vector<unsigned char> file;
+		if (!read(file) || !decode(file)) {
+			return -1;
+		}
+		file.clear();
+		file.shrink_to_fit();
+		HeadlessRenderer renderer;
+		if (!renderer.createContext()) {
+			return -1;
+		}
+		if (!gladLoadGLLoader((GLADloadproc)HeadlessRenderer::getProcAddress)) {
+			std::cout << "Failed to load GLAD!" << std::endl;
+			renderer.destroy();
+			return -1;
+		}
+		if (!renderer.createTarget(width, height)) {
+			renderer.destroy();
+			return -1;
+		}
+		target = renderer.framebuffer;
+		GLuint queries[2];
+		glGenQueries(2, queries);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		replay(0, preambleCalls);
+		glFinish();
+		double preambleMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		int preambleErrors = errors();
+
+		std::vector<double> cpu, frame, gpu;
+		std::vector<double> frameCpu(frames.size(), 0.0), frameGpu(frames.size(), 0.0);
+		for (int loop = 0; loop < options.warmup + options.loops; loop++) {
+			bool measured = loop >= options.warmup;
+			for (int f = 0; f < (int)frames.size(); f++) {
+				start = std::chrono::steady_clock::now();
+				glQueryCounter(queries[0], GL_TIMESTAMP);
+				replay(f == 0 ? preambleCalls : frames[f - 1], frames[f]);
+				glQueryCounter(queries[1], GL_TIMESTAMP);
+				double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				glFinish();
+				double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				GLuint64 begin = 0, end = 0;
+				glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &begin);
+				glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+				double gpuMs = (end - begin) / 1.0e6;
+				if (measured) {
+					cpu.push_back(cpuMs);
+					frame.push_back(frameMs);
+					gpu.push_back(gpuMs);
+					frameCpu[f] += cpuMs / options.loops;
+					frameGpu[f] += gpuMs / options.loops;
+				}
+			}
+		}
+		int frameErrors = errors();
+		if (preambleErrors > 0 || frameErrors > 0) {
+			std::cout << "The replay raised " << preambleErrors << " GL errors in the preamble and " << frameErrors << " in the frames" << std::endl;
+		}
+		std::cout << "Replayed " << frames.size() << " frames of " << options.capture << " " << options.loops << " times at " << width << "x" << height
+			<< ": cpu p50 " << SceneBenchmark::percentile(cpu, 50.0) << " ms, frame p50 " << SceneBenchmark::percentile(frame, 50.0)
+			<< " p99 " << SceneBenchmark::percentile(frame, 99.0) << " ms, gpu p50 " << SceneBenchmark::percentile(gpu, 50.0)
+			<< " ms, preamble " << preambleMs << " ms" << std::endl;
+		int result = write(cpu, frame, gpu, frameCpu, frameGpu, preambleMs, preambleErrors + frameErrors) ? 0 : -1;
+		glDeleteQueries(2, queries);
+		renderer.destroy();
+		return result;
+	}
+private:
+	// @dev calls a glad function with the arguments of a call, returns its result as a slot
+	typedef int64_t (*Invoker)(const int64_t* slots);
+
+	// @dev one decoded call, the indices point into values and blobs
+	typedef struct ReplayCall {
+		int entry = 0;
+		int slots = 0;
+		// names generated or deleted, or the value the call returned
+		int extras = 0;
+		int blobs = 0;
+		// the arguments have names or locations to map
+		bool mapped = false;
+	}ReplayCall;
+
+	// @dev memory a call pointed to, copied into the arena
+	typedef struct ReplayBlob {
+		size_t offset = 0;
+		size_t bytes = 0;
+		bool null = true;
+	}ReplayBlob;
+
+	int width = 0;
+	int height = 0;
+	std::vector<ReplayCall> calls;
+	std::vector<int64_t> values;
+	std::vector<ReplayBlob> blobs;
+	std::vector<unsigned char> arena;
+	// calls of the preamble, then the end of every frame
+	int preambleCalls = 0;
+	std::vector<int> frames;
+	// memory the o arguments are written to
+	std::vector<unsigned char> scratch[2];
+	std::vector<GLuint> names;
+	// captured names to the ones of this context by GLObjectType, locations by captured program and location
+	std::unordered_map<int64_t, int64_t> objects[GL_OBJECT_TYPES];
+	std::unordered_map<int64_t, std::unordered_map<int64_t, int64_t>> locations;
+	// captured state the mapping depends on
+	int64_t program = 0;
+	int64_t drawFramebuffer = 0;
+	int64_t readFramebuffer = 0;
+	std::unordered_map<int64_t, int64_t> bound;
+	std::unordered_map<int64_t, void*> mapped;
+	GLuint target = 0;
+
+	// @dev load the whole capture
+	bool read(std::vector<unsigned char>& file) {
+		FILE* in = fopen(options.capture.c_str(), "rb");
+		if (in == NULL) {
+			std::cout << "Failed to open " << options.capture << std::endl;
+			return false;
+		}
+		fseek(in, 0, SEEK_END);
+		long size = ftell(in);
+		fseek(in, 0, SEEK_SET);
+		file.resize(size > 0 ? (size_t)size : 0);
+		bool complete = size > 8 && fread(file.data(), 1, file.size(), in) == file.size() && memcmp(file.data(), GLStream::magic(), 8) == 0;
+		fclose(in);
+		if (!complete) {
+			std::cout << options.capture << " is not a GL capture" << std::endl;
+		}
+		return complete;
+	}
+
+	// @dev turn the stream into calls, the memory they point to into the arena
+	bool decode(const std::vector<unsigned char>& file) {
+		const unsigned char* in = file.data() + 8;
+		const unsigned char* end = file.data() + file.size();
+		int64_t version = 0, fileWidth = 0, fileHeight = 0, entries = 0;
+		if (!GLStream::get(in, end, version) || version != GLStream::VERSION || !GLStream::get(in, end, fileWidth) ||
+			!GLStream::get(in, end, fileHeight) || !GLStream::get(in, end, entries) || fileWidth <= 0 || fileHeight <= 0 || entries <= 0) {
+			std::cout << options.capture << " has an unknown header" << std::endl;
+			return false;
+		}
+		width = (int)fileWidth;
+		height = (int)fileHeight;
+		// entry points of the capture by name, a build adding some still reads older captures
+		std::vector<int> local;
+		for (int64_t i = 0; i < entries; i++) {
+			int64_t length = 0;
+			if (!GLStream::get(in, end, length) || length <= 0 || length - 1 > end - in) {
+				return malformed();
+			}
+			std::string name((const char*)in, (size_t)(length - 1));
+			in += length - 1;
+			int entry = -1;
+			for (int known = 0; known < GL_ENTRY_POINTS && entry < 0; known++) {
+				entry = name == GLCounters::entryName(known) ? known : -1;
+			}
+			local.push_back(entry);
+		}
+		int64_t preambleBytes = 0, frameCount = 0;
+		if (!GLStream::get(in, end, preambleBytes) || !GLStream::get(in, end, frameCount) || frameCount <= 0) {
+			return malformed();
+		}
+		std::vector<int64_t> frameBytes((size_t)frameCount);
+		for (int64_t& bytes : frameBytes) {
+			if (!GLStream::get(in, end, bytes)) {
+				return malformed();
+			}
+		}
+		// calls of the preamble and of every frame end at these offsets into the body
+		std::vector<int64_t> ends(1, preambleBytes);
+		for (int64_t bytes : frameBytes) {
+			ends.push_back(ends.back() + bytes);
+		}
+		const unsigned char* body = in;
+		std::vector<int> marks;
+		for (;;) {
+			while (marks.size() < ends.size() && in - body == ends[marks.size()]) {
+				marks.push_back((int)calls.size());
+			}
+			if (in >= end) {
+				break;
+			}
+			int64_t captured = 0;
+			if (!GLStream::get(in, end, captured) || captured < 0 || captured >= entries) {
+				return malformed();
+			}
+			int entry = local[(size_t)captured];
+			if (entry < 0) {
+				std::cout << options.capture << " calls a GL function this build does not know" << std::endl;
+				return false;
+			}
+			if (!decodeCall(entry, in, end)) {
+				return malformed();
+			}
+		}
+		if (marks.size() != ends.size()) {
+			return malformed();
+		}
+		preambleCalls = marks[0];
+		frames.assign(marks.begin() + 1, marks.end());
+		resolve();
+		return true;
+	}
+
+	bool malformed() {
+		std::cout << options.capture << " is truncated or malformed" << std::endl;
+		return false;
+	}
+
+	// @dev read one call, the layout GLCapture::encode and after write
+	bool decodeCall(int entry, const unsigned char*& in, const unsigned char* end) {
+		ReplayCall call;
+		call.entry = entry;
+		call.slots = (int)values.size();
+		call.blobs = (int)blobs.size();
+		int arguments = GLStream::arity(entry);
+		for (int i = 0; i < arguments; i++) {
+			int64_t value = 0;
+			if (!GLStream::get(in, end, value)) {
+				return false;
+			}
+			values.push_back(value);
+		}
+		const int64_t* slots = values.data() + call.slots;
+		const char* roles = GLStream::roles(entry);
+		call.mapped = strpbrk(roles, "btvfrqspl") != NULL || entry == ENTRY_DrawBuffer || entry == ENTRY_ReadBuffer;
+		int count = 0;
+		for (int i = 0; roles[i] != '\0'; i++) {
+			count += roles[i] == 'd' || roles[i] == 'n';
+		}
+		if (entry == ENTRY_ShaderSource) {
+			count += (int)slots[1];
+		}
+		else if (entry == ENTRY_UnmapBuffer) {
+			count++;
+		}
+		for (int i = 0; i < count; i++) {
+			if (!decodeBlob(in, end)) {
+				return false;
+			}
+		}
+		call.extras = (int)values.size();
+		int64_t extras = 0;
+		if (GLStream::objectType(entry) >= 0) {
+			extras = values[call.slots];
+		}
+		else if (GLStream::returnsName(entry)) {
+			extras = 1;
+		}
+		for (int64_t i = 0; i < extras; i++) {
+			int64_t value = 0;
+			if (!GLStream::get(in, end, value)) {
+				return false;
+			}
+			values.push_back(value);
+		}
+		calls.push_back(call);
+		return true;
+	}
+
+	bool decodeBlob(const unsigned char*& in, const unsigned char* end) {
+		int64_t length = 0;
+		if (!GLStream::get(in, end, length) || length < 0 || length - 1 > end - in) {
+			return false;
+		}
+		ReplayBlob blob;
+		if (length > 0) {
+			blob.null = false;
+			blob.bytes = (size_t)(length - 1);
+			// 16 byte aligned, floats and matrices are read straight from the arena
+			blob.offset = (arena.size() + 15) / 16 * 16;
+			arena.resize(blob.offset + blob.bytes + 1);
+			memcpy(&arena[blob.offset], in, blob.bytes);
+			// strings are terminated
+			arena[blob.offset + blob.bytes] = 0;
+			in += blob.bytes;
+		}
+		blobs.push_back(blob);
+		return true;
+	}
+
+	// @dev point the d and n arguments into the arena and the o arguments to the scratch memory
+	void resolve() {
+		size_t needed[2] = { 256, 256 };
+		for (ReplayCall& call : calls) {
+			int64_t* slots = values.data() + call.slots;
+			const char* roles = GLStream::roles(call.entry);
+			int blob = call.blobs, output = 0;
+			for (int i = 0; roles[i] != '\0'; i++) {
+				if (roles[i] == 'd' || roles[i] == 'n') {
+					const ReplayBlob& data = blobs[blob++];
+					if (!data.null) {
+						slots[i] = (int64_t)(intptr_t)&arena[data.offset];
+					}
+				}
+				else if (roles[i] == 'o') {
+					size_t bytes = 256;
+					if (call.entry == ENTRY_ReadPixels) {
+						bytes = (size_t)(slots[2] * slots[3]) * 16;
+					}
+					else if (call.entry == ENTRY_GetProgramInfoLog || call.entry == ENTRY_GetShaderInfoLog) {
+						bytes = (size_t)slots[1] + 1;
+					}
+					needed[output] = std::max(needed[output], bytes);
+					slots[i] = output++;
+				}
+			}
+		}
+		for (int i = 0; i < 2; i++) {
+			scratch[i].resize(needed[i]);
+		}
+		for (ReplayCall& call : calls) {
+			int64_t* slots = values.data() + call.slots;
+			const char* roles = GLStream::roles(call.entry);
+			for (int i = 0; roles[i] != '\0'; i++) {
+				if (roles[i] == 'o') {
+					slots[i] = (int64_t)(intptr_t)scratch[slots[i]].data();
+				}
+			}
+		}
+	}
+
+	// @dev make the calls [first, last)
+	void replay(int first, int last) {
+		static const Invoker invokers[] = {
+#define GL_INVOKER(name) &invoke<decltype(glad_gl##name), &glad_gl##name>,
+#define GL_INVOKER_PAIR(generate, remove, type) GL_INVOKER(generate) GL_INVOKER(remove)
+			GL_COUNTED_CALLS(GL_INVOKER)
+			GL_ACCOUNTED_CALLS(GL_INVOKER)
+			GL_OBJECT_CALLS(GL_INVOKER_PAIR)
+#undef GL_INVOKER
+#undef GL_INVOKER_PAIR
+		};
+		int64_t arguments[16];
+		for (int c = first; c < last; c++) {
+			const ReplayCall& call = calls[c];
+			const int64_t* slots = values.data() + call.slots;
+			int type = GLStream::objectType(call.entry);
+			if (type >= 0) {
+				replayObjects(call, type, invokers[call.entry]);
+				continue;
+			}
+			if (call.mapped) {
+				int arity = GLStream::arity(call.entry);
+				for (int i = 0; i < arity; i++) {
+					arguments[i] = slots[i];
+				}
+				map(call, arguments);
+				slots = arguments;
+			}
+			if (call.entry == ENTRY_UnmapBuffer) {
+				unmap(call);
+			}
+			else if (call.entry == ENTRY_ShaderSource) {
+				shaderSource(call, slots);
+				continue;
+			}
+			int64_t result = invokers[call.entry](slots);
+			follow(call, result);
+		}
+	}
+
+	// @dev glGen* and glDelete*, the captured names are mapped to the generated ones and forgotten when deleted
+	void replayObjects(const ReplayCall& call, int type, Invoker invoker) {
+		int64_t count = values[call.slots];
+		names.resize((size_t)std::max<int64_t>(count, 1));
+		bool generate = GLStream::generates(call.entry);
+		for (int64_t i = 0; i < count && !generate; i++) {
+			names[i] = (GLuint)name(type, values[call.extras + i]);
+		}
+		int64_t arguments[2] = { count, (int64_t)(intptr_t)names.data() };
+		invoker(arguments);
+		for (int64_t i = 0; i < count; i++) {
+			int64_t captured = values[call.extras + i];
+			if (generate) {
+				objects[type][captured] = names[i];
+			}
+			else {
+				objects[type].erase(captured);
+			}
+		}
+	}
+
+	// @return Name of this context for a captured one, captured names never seen are kept
+	int64_t name(int type, int64_t captured) {
+		if (captured == 0) {
+			return type == OBJECT_FRAMEBUFFERS ? target : 0;
+		}
+		auto found = objects[type].find(captured);
+		return found != objects[type].end() ? found->second : captured;
+	}
+
+	// @dev map the names and locations among the arguments of a call and follow the captured state they depend on
+	void map(const ReplayCall& call, int64_t* arguments) {
+		switch (call.entry) {
+		case ENTRY_BindBuffer:
+			bound[arguments[0]] = arguments[1];
+			break;
+		case ENTRY_BindBufferRange:
+			bound[arguments[0]] = arguments[2];
+			break;
+		case ENTRY_UseProgram:
+			program = arguments[0];
+			break;
+		case ENTRY_BindFramebuffer:
+			if (arguments[0] != GL_READ_FRAMEBUFFER) {
+				drawFramebuffer = arguments[1];
+			}
+			if (arguments[0] != GL_DRAW_FRAMEBUFFER) {
+				readFramebuffer = arguments[1];
+			}
+			break;
+		case ENTRY_DrawBuffer: case ENTRY_ReadBuffer:
+			// the target stands in for the default framebuffer, whose buffers it does not have
+			if ((call.entry == ENTRY_DrawBuffer ? drawFramebuffer : readFramebuffer) == 0 && arguments[0] != GL_NONE) {
+				arguments[0] = GL_COLOR_ATTACHMENT0;
+			}
+			break;
+		default:
+			break;
+		}
+		const char* roles = GLStream::roles(call.entry);
+		for (int i = 0; roles[i] != '\0'; i++) {
+			switch (roles[i]) {
+			case 'b': arguments[i] = name(OBJECT_BUFFERS, arguments[i]); break;
+			case 't': arguments[i] = name(OBJECT_TEXTURES, arguments[i]); break;
+			case 'v': arguments[i] = name(OBJECT_VERTEX_ARRAYS, arguments[i]); break;
+			case 'f': arguments[i] = name(OBJECT_FRAMEBUFFERS, arguments[i]); break;
+			case 'r': arguments[i] = name(OBJECT_RENDERBUFFERS, arguments[i]); break;
+			case 'q': arguments[i] = name(OBJECT_QUERIES, arguments[i]); break;
+			case 's': arguments[i] = name(OBJECT_SHADERS, arguments[i]); break;
+			case 'p': arguments[i] = name(OBJECT_PROGRAMS, arguments[i]); break;
+			case 'l': arguments[i] = location(arguments[i]); break;
+			default: break;
+			}
+		}
+	}
+
+	// @return Location of this context for a captured one of the current program
+	int64_t location(int64_t captured) {
+		auto uniforms = locations.find(program);
+		if (captured < 0 || uniforms == locations.end()) {
+			return captured;
+		}
+		auto found = uniforms->second.find(captured);
+		return found != uniforms->second.end() ? found->second : -1;
+	}
+
+	// @dev keep what a call returned that later calls refer to
+	void follow(const ReplayCall& call, int64_t result) {
+		switch (call.entry) {
+		case ENTRY_CreateShader:
+			objects[OBJECT_SHADERS][values[call.extras]] = result;
+			break;
+		case ENTRY_CreateProgram:
+			objects[OBJECT_PROGRAMS][values[call.extras]] = result;
+			break;
+		case ENTRY_DeleteShader:
+			objects[OBJECT_SHADERS].erase(values[call.slots]);
+			break;
+		case ENTRY_DeleteProgram:
+			objects[OBJECT_PROGRAMS].erase(values[call.slots]);
+			locations.erase(values[call.slots]);
+			break;
+		case ENTRY_LinkProgram:
+			locations.erase(values[call.slots]);
+			break;
+		case ENTRY_GetUniformLocation:
+			locations[values[call.slots]][values[call.extras]] = result;
+			break;
+		case ENTRY_MapBufferRange:
+			mapped[bound[values[call.slots]]] = (void*)(intptr_t)result;
+			break;
+		default:
+			break;
+		}
+	}
+
+	// @dev write what the application wrote into a mapped range before it is unmapped
+	void unmap(const ReplayCall& call) {
+		int64_t buffer = bound[values[call.slots]];
+		const ReplayBlob& data = blobs[call.blobs];
+		auto range = mapped.find(buffer);
+		if (range != mapped.end()) {
+			if (!data.null && range->second != NULL) {
+				memcpy(range->second, &arena[data.offset], data.bytes);
+			}
+			mapped.erase(range);
+		}
+	}
+
+	void shaderSource(const ReplayCall& call, const int64_t* slots) {
+		std::vector<const GLchar*> strings;
+		std::vector<GLint> lengths;
+		for (int64_t i = 0; i < slots[1]; i++) {
+			const ReplayBlob& data = blobs[call.blobs + i];
+			strings.push_back((const GLchar*)&arena[data.offset]);
+			lengths.push_back((GLint)data.bytes);
+		}
+		glShaderSource((GLuint)slots[0], (GLsizei)slots[1], strings.data(), lengths.data());
+	}
+
+	template <typename P, P* POINTER>
+	static int64_t invoke(const int64_t* slots) {
+		return invokeWith(*POINTER, slots);
+	}
+
+	template <typename R, typename... Args>
+	static int64_t invokeWith(R (APIENTRYP function)(Args...), const int64_t* slots) {
+		return forward(function, slots, std::index_sequence_for<Args...>());
+	}
+
+	template <typename R, typename... Args, size_t... I>
+	static int64_t forward(R (APIENTRYP function)(Args...), const int64_t* slots, std::index_sequence<I...>) {
+		(void)slots;
+		return GLForward<R>(function, GLStream::fromSlot<Args>(slots[I])...).slot();
+	}
+
+	// @return Number of GL errors raised since the last call
+	static int errors() {
+		int count = 0;
+		while (glGetError() != GL_NO_ERROR && count < 1000) {
+			count++;
+		}
+		return count;
+	}
+
+	// @dev the results as JSON
+	bool write(const std::vector<double>& cpu, const std::vector<double>& frame, const std::vector<double>& gpu,
+		const std::vector<double>& frameCpu, const std::vector<double>& frameGpu, double preambleMs, int glErrors) {
+		if (options.output.empty()) {
+			return true;
+		}
+		FILE* out = fopen(options.output.c_str(), "w");
+		if (out == NULL) {
+			std::cout << "Failed to write " << options.output << std::endl;
+			return false;
+		}
+		fprintf(out, "{\n");
+		fprintf(out, "  \"capture\": \"%s\",\n", SceneBenchmark::escape(options.capture.c_str()).c_str());
+		fprintf(out, "  \"renderer\": \"%s\",\n", SceneBenchmark::escape((const char*)glGetString(GL_RENDERER)).c_str());
+		fprintf(out, "  \"version\": \"%s\",\n", SceneBenchmark::escape((const char*)glGetString(GL_VERSION)).c_str());
+		fprintf(out, "  \"width\": %d,\n", width);
+		fprintf(out, "  \"height\": %d,\n", height);
+		fprintf(out, "  \"frames\": %d,\n", (int)frames.size());
+		fprintf(out, "  \"loops\": %d,\n", options.loops);
+		fprintf(out, "  \"warmupLoops\": %d,\n", options.warmup);
+		fprintf(out, "  \"calls\": {\"preamble\": %d, \"frames\": %d},\n", preambleCalls, (int)calls.size() - preambleCalls);
+		fprintf(out, "  \"glErrors\": %d,\n", glErrors);
+		fprintf(out, "  \"preambleMs\": %.4f,\n", preambleMs);
+		SceneBenchmark::writeStats(out, "cpuFrameTimeMs", cpu);
+		SceneBenchmark::writeStats(out, "frameTimeMs", frame);
+		SceneBenchmark::writeStats(out, "gpuFrameTimeMs", gpu);
+		// mean of every captured frame over the loops, a regression shows in the frames it is in
+		fprintf(out, "  \"cpuMsByFrame\": [");
+		for (int f = 0; f < (int)frameCpu.size(); f++) {
+			fprintf(out, "%s%.4f", f > 0 ? ", " : "", frameCpu[f]);
+		}
+		fprintf(out, "],\n");
+		fprintf(out, "  \"gpuMsByFrame\": [");
+		for (int f = 0; f < (int)frameGpu.size(); f++) {
+			fprintf(out, "%s%.4f", f > 0 ? ", " : "", frameGpu[f]);
+		}
+		fprintf(out, "]\n");
+		fprintf(out, "}\n");
+		fclose(out);
+		return true;
+	}
+};
@@ -66,6 +66,6 @@ public:
 		// do something
 	}
 
-	virtual void render(Camera camera, Light light) {}
+	virtual void render(Camera camera, Light& light) {}
 };
 
@@ -0,0 +1,262 @@
+#pragma once
+#include <glad/glad.h>
+#include <chrono>
+#include <cfloat>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "imgui.h"
+
+// @dev one measured pass of a frame
+typedef struct GpuScope {
+	int pass = 0;
+	// microseconds on the CPU's steady clock, comparable with time stamps taken on the CPU
+	double start = 0.0;
+	// milliseconds
+	double duration = 0.0;
+}GpuScope;
+
+// @dev the measured passes of one frame in the order they began
+typedef struct GpuFrame {
+	long long frame = -1;
+	std::vector<GpuScope> scopes;
+}GpuFrame;
+
+// @dev Time the GPU spends on named passes, measured with a pair of GL_TIMESTAMP queries around
+// every pass, so passes may nest and other timer queries may run inside them. The queries live in a
+// ring FRAMES deep: a frame's results are read once its last query is available, which is asked
+// without waiting, and its queries are written again FRAMES frames later. A GPU running further
+// behind drops those results instead of stalling the CPU. Frames are begun and ended on the thread
+// owning the context, the collected times may be read from any thread.
+class GpuTimer
+{
+public:
+	static const int FRAMES = 3;
+	static const int MAX_SCOPES = 32;
+	// frames shown in the graphs
+	static const int HISTORY = 120;
+
+	// @dev create the queries, the context has to be current
+	void initialize() {
+		if (initialized) {
+			return;
+		}
+		initialized = true;
+		for (Slot& slot : slots) {
+			glGenQueries(MAX_SCOPES * 2, slot.queries);
+		}
+		// GPU time stamps are moved onto the CPU's clock from one reading of both
+		GLint64 now = 0;
+		glGetInteger64v(GL_TIMESTAMP, &now);
+		gpuBase = now;
+		cpuBase = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// @dev start a frame, the results of finished frames are collected first
+	void beginFrame() {
+		collect();
+		Slot& slot = slots[frame % FRAMES];
+		if (slot.pending) {
+			std::lock_guard<std::mutex> lock(mutex);
+			dropped++;
+			slot.pending = false;
+		}
+		slot.frame = frame;
+		slot.scopes.clear();
+		slot.last = -1;
+	}
+
+	// @dev start timing a pass
+	// @return Scope to end, -1 if the frame has no queries left
+	int begin(const std::string& name) {
+		Slot& slot = slots[frame % FRAMES];
+		if (!initialized || (int)slot.scopes.size() == MAX_SCOPES) {
+			return -1;
+		}
+		int scope = (int)slot.scopes.size();
+		slot.scopes.push_back(pass(name));
+		glQueryCounter(slot.queries[scope * 2], GL_TIMESTAMP);
+		return scope;
+	}
+
+	// @dev end timing a pass
+	void end(int scope) {
+		if (scope < 0) {
+			return;
+		}
+		Slot& slot = slots[frame % FRAMES];
+		glQueryCounter(slot.queries[scope * 2 + 1], GL_TIMESTAMP);
+		slot.last = scope * 2 + 1;
+	}
+
+	// @dev end the frame, its results are read by a later beginFrame or collect
+	void endFrame() {
+		Slot& slot = slots[frame % FRAMES];
+		slot.pending = slot.last >= 0;
+		frame++;
+	}
+
+	// @dev read the results of the frames the GPU has finished, oldest first, never waits for it
+	void collect() {
+		for (long long f = frame - FRAMES; f < frame; f++) {
+			if (f < 0) {
+				continue;
+			}
+			Slot& slot = slots[f % FRAMES];
+			if (!slot.pending || slot.frame != f) {
+				continue;
+			}
+			// queries finish in order, the last one issued stands for the frame; with nested scopes that
+			// is the end of an outer scope, not of the scope begun last
+			GLint available = 0;
+			glGetQueryObjectiv(slot.queries[slot.last], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				return;
+			}
+			GpuFrame result;
+			result.frame = f;
+			for (int i = 0; i < (int)slot.scopes.size(); i++) {
+				GLuint64 start = 0, end = 0;
+				glGetQueryObjectui64v(slot.queries[i * 2], GL_QUERY_RESULT, &start);
+				glGetQueryObjectui64v(slot.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+				GpuScope scope;
+				scope.pass = slot.scopes[i];
+				scope.start = cpuBase + ((GLint64)start - gpuBase) / 1000.0;
+				scope.duration = (end - start) / 1.0e6;
+				result.scopes.push_back(scope);
+			}
+			slot.pending = false;
+			publish(result);
+		}
+	}
+
+	// @return Names of the passes seen so far, indices are the passes of GpuScope
+	std::vector<std::string> passes() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return names;
+	}
+
+	// @return Milliseconds of a pass in the latest collected frame, 0 if it did not run
+	float time(const std::string& name) {
+		std::lock_guard<std::mutex> lock(mutex);
+		for (int i = 0; i < (int)names.size(); i++) {
+			if (names[i] == name) {
+				return times[i];
+			}
+		}
+		return 0.0f;
+	}
+
+	// @return The latest collected frame
+	GpuFrame latest() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return latestFrame;
+	}
+
+	// @return The last HISTORY collected frames, oldest first
+	std::vector<GpuFrame> recent() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return std::vector<GpuFrame>(recentFrames.begin(), recentFrames.end());
+	}
+
+	// @dev window with a graph of every pass
+	void overlay() {
+		std::lock_guard<std::mutex> lock(mutex);
+		ImGui::Begin("GPU passes");
+		for (int i = 0; i < (int)names.size(); i++) {
+			char value[32];
+			snprintf(value, sizeof(value), "%.3f ms", times[i]);
+			ImGui::PlotLines(names[i].c_str(), history[i].data(), HISTORY, historyHead, value, 0.0f, FLT_MAX, ImVec2(0, 40));
+		}
+		ImGui::Text("%d frames dropped", dropped);
+		ImGui::End();
+	}
+
+	// @dev release the queries
+	void destroy() {
+		if (!initialized) {
+			return;
+		}
+		for (Slot& slot : slots) {
+			glDeleteQueries(MAX_SCOPES * 2, slot.queries);
+			slot.pending = false;
+		}
+		initialized = false;
+	}
+
+	// makes GpuTimer an instance
+	static GpuTimer* getInstance() {
+		if (instance == NULL) {
+			instance = new GpuTimer();
+		}
+		return instance;
+	}
+private:
+	static GpuTimer* instance;
+
+	// @dev the queries of one frame of the ring
+	typedef struct Slot {
+		GLuint queries[MAX_SCOPES * 2];
+		// pass of every scope begun
+		std::vector<int> scopes;
+		// query ended last, -1 before any scope has ended
+		int last = -1;
+		long long frame = -1;
+		bool pending = false;
+	}Slot;
+
+	bool initialized = false;
+	Slot slots[FRAMES];
+	long long frame = 0;
+	GLint64 gpuBase = 0;
+	double cpuBase = 0.0;
+	// guards what is read from other threads
+	std::mutex mutex;
+	std::vector<std::string> names;
+	// milliseconds of every pass in the latest collected frame
+	std::vector<float> times;
+	std::vector<std::vector<float>> history;
+	int historyHead = 0;
+	// frames whose results were overwritten before the GPU had finished them
+	int dropped = 0;
+	GpuFrame latestFrame;
+	std::deque<GpuFrame> recentFrames;
+
+	GpuTimer() {}
+
+	// @return Index of a pass, new names are added
+	int pass(const std::string& name) {
+		for (int i = 0; i < (int)names.size(); i++) {
+			if (names[i] == name) {
+				return i;
+			}
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		names.push_back(name);
+		times.push_back(0.0f);
+		history.push_back(std::vector<float>(HISTORY, 0.0f));
+		return (int)names.size() - 1;
+	}
+
+	// @dev make a collected frame the latest one
+	void publish(const GpuFrame& result) {
+		std::lock_guard<std::mutex> lock(mutex);
+		latestFrame = result;
+		recentFrames.push_back(result);
+		if ((int)recentFrames.size() > HISTORY) {
+			recentFrames.pop_front();
+		}
+		std::fill(times.begin(), times.end(), 0.0f);
+		for (const GpuScope& scope : result.scopes) {
+			times[scope.pass] += (float)scope.duration;
+		}
+		for (int i = 0; i < (int)history.size(); i++) {
+			history[i][historyHead] = times[i];
+		}
+		historyHead = (historyHead + 1) % HISTORY;
+	}
+};
+
+GpuTimer* GpuTimer::instance = NULL;
@@ -0,0 +1,249 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#define HEADLESS_EGL
+#endif
+
+// @dev what a headless run draws and where it writes it
+typedef struct HeadlessOptions {
+	int width = 1600;
+	int height = 1600;
+	// frames written, frames drawn while textures are still loading come before them
+	int frames = 1;
+	// most frames drawn before the first written one while textures are still loading or streaming
+	int warmup = 120;
+	// plane, cubes or grid
+	std::string scene = "cubes";
+	glm::vec3 eye = glm::vec3(0.0f, 4.0f, 9.0f);
+	glm::vec3 target = glm::vec3(0.0f, 0.0f, 0.0f);
+	float fovy = 45.0f;
+	// degrees the eye turns around the target from one frame to the next
+	float orbit = 0.0f;
+	// frames are written to <output>_0000.ppm and on, none writes nothing
+	std::string output = "frame";
+}HeadlessOptions;
+
+// @dev Rendering without a window, run with
+//   CubeHappyLand --headless [--scene plane|cubes|grid] [--size 1920x1080] [--camera x,y,z]
+//                            [--target x,y,z] [--fov degrees] [--orbit degrees] [--frames n]
+//                            [--warmup n] [--output prefix|none]
+// The context comes from EGL on Mesa's surfaceless platform, which needs neither a display server
+// nor a GPU: without one Mesa falls back to llvmpipe and renders on the CPU. There is no default
+// framebuffer, the scene is drawn into an RGBA8 color and a depth renderbuffer and every frame is
+// read back and written as a binary PPM.
+class HeadlessRenderer
+{
+public:
+	GLuint framebuffer = 0;
+	int width = 0;
+	int height = 0;
+
+	HeadlessRenderer() {}
+	~HeadlessRenderer() {}
+
+	// @dev read the options following --headless
+	// @param first Index of the first option in argv
+	// @return false after printing the usage if an option is unknown or its value malformed
+	static bool parse(int argc, char** argv, int first, HeadlessOptions& options) {
+		for (int i = first; i < argc; i += 2) {
+			const char* name = argv[i];
+			const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+			bool valid = true;
+			if (value == NULL) {
+				valid = false;
+			}
+			else if (strcmp(name, "--scene") == 0) {
+				options.scene = value;
+				valid = options.scene == "plane" || options.scene == "cubes" || options.scene == "grid";
+			}
+			else if (strcmp(name, "--size") == 0) {
+				valid = sscanf(value, "%dx%d", &options.width, &options.height) == 2 && options.width > 0 && options.height > 0 && options.width <= 16384 && options.height <= 16384;
+			}
+			else if (strcmp(name, "--camera") == 0) {
+				valid = sscanf(value, "%f,%f,%f", &options.eye.x, &options.eye.y, &options.eye.z) == 3;
+			}
+			else if (strcmp(name, "--target") == 0) {
+				valid = sscanf(value, "%f,%f,%f", &options.target.x, &options.target.y, &options.target.z) == 3;
+			}
+			else if (strcmp(name, "--fov") == 0) {
+				options.fovy = (float)atof(value);
+				valid = options.fovy > 0.0f && options.fovy < 180.0f;
+			}
+			else if (strcmp(name, "--orbit") == 0) {
+				options.orbit = (float)atof(value);
+			}
+			else if (strcmp(name, "--frames") == 0) {
+				options.frames = atoi(value);
+				valid = options.frames > 0;
+			}
+			else if (strcmp(name, "--warmup") == 0) {
+				options.warmup = atoi(value);
+				valid = options.warmup >= 0;
+			}
+			else if (strcmp(name, "--output") == 0) {
+				options.output = strcmp(value, "none") == 0 ? "" : value;
+			}
+			else {
+				valid = false;
+			}
+			if (!valid) {
+				std::cout << "Invalid headless option " << name << (value != NULL ? " " : "") << (value != NULL ? value : "") << std::endl;
+				std::cout << "usage: CubeHappyLand --headless [--scene plane|cubes|grid] [--size WxH] [--camera x,y,z] [--target x,y,z]" << std::endl;
+				std::cout << "                    [--fov degrees] [--orbit degrees] [--frames n] [--warmup n] [--output prefix|none]" << std::endl;
+				return false;
+			}
+		}
+		if (options.eye == options.target) {
+			std::cout << "The headless camera has to be away from its target" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// @dev create an OpenGL 3.3 core context without a surface and make it current
+	bool createContext() {
+#ifdef HEADLESS_EGL
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay != NULL) {
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		}
+		// drivers without the surfaceless platform may still allow a context without surface on their default display
+		if (display == EGL_NO_DISPLAY) {
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		}
+		EGLint major = 0, minor = 0;
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+			std::cout << "Failed to initialize EGL!" << std::endl;
+			return false;
+		}
+		if (!eglBindAPI(EGL_OPENGL_API)) {
+			std::cout << "EGL does not provide desktop OpenGL!" << std::endl;
+			return false;
+		}
+		// a config is needed for the context only, nothing is drawn into a surface of it
+		EGLint configAttributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+		EGLConfig config;
+		EGLint configs = 0;
+		if (!eglChooseConfig(display, configAttributes, &config, 1, &configs) || configs == 0) {
+			std::cout << "No EGL config for OpenGL!" << std::endl;
+			return false;
+		}
+		EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 3,
+			EGL_CONTEXT_MINOR_VERSION, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+		if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+			std::cout << "Failed to create an OpenGL 3.3 context without surface!" << std::endl;
+			return false;
+		}
+		return true;
+#else
+		std::cout << "Headless rendering needs EGL, it is only available on Linux" << std::endl;
+		return false;
+#endif
+	}
+
+	// @dev loader of the context's functions for glad
+	static void* getProcAddress(const char* name) {
+#ifdef HEADLESS_EGL
+		return (void*)eglGetProcAddress(name);
+#else
+		return NULL;
+#endif
+	}
+
+	// @dev create the framebuffer frames are drawn into
+	bool createTarget(int width, int height) {
+		this->width = width;
+		this->height = height;
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glGenRenderbuffers(1, &color);
+		glBindRenderbuffer(GL_RENDERBUFFER, color);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+		glGenRenderbuffers(1, &depth);
+		glBindRenderbuffer(GL_RENDERBUFFER, depth);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		if (status != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Headless framebuffer incomplete: 0x" << std::hex << status << std::dec << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// @dev read the target back and write it as a binary PPM, top row first
+	bool save(const std::string& path) {
+		pixels.resize((size_t)width * height * 3);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+		FILE* out = fopen(path.c_str(), "wb");
+		if (out == NULL) {
+			std::cout << "Failed to write " << path << std::endl;
+			return false;
+		}
+		fprintf(out, "P6\n%d %d\n255\n", width, height);
+		// OpenGL's rows start at the bottom
+		for (int y = height - 1; y >= 0; y--) {
+			fwrite(&pixels[(size_t)y * width * 3], 1, (size_t)width * 3, out);
+		}
+		fclose(out);
+		return true;
+	}
+
+	// @return Path of a frame, <output>_0000.ppm for the first
+	static std::string framePath(const std::string& output, int frame) {
+		char number[24];
+		snprintf(number, sizeof(number), "_%04d.ppm", frame);
+		return output + number;
+	}
+
+	// @dev release the target, the context stays current
+	void destroyTarget() {
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &color);
+		glDeleteRenderbuffers(1, &depth);
+		framebuffer = color = depth = 0;
+	}
+
+	// @dev release the target and the context
+	void destroy() {
+		destroyTarget();
+#ifdef HEADLESS_EGL
+		if (display != EGL_NO_DISPLAY) {
+			eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			if (context != EGL_NO_CONTEXT) {
+				eglDestroyContext(display, context);
+			}
+			eglTerminate(display);
+			display = EGL_NO_DISPLAY;
+			context = EGL_NO_CONTEXT;
+		}
+#endif
+	}
+
+private:
+	GLuint color = 0;
+	GLuint depth = 0;
+	std::vector<unsigned char> pixels;
+#ifdef HEADLESS_EGL
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLContext context = EGL_NO_CONTEXT;
+#endif
+};
@@ -0,0 +1,138 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "MappedFile.h"
+
+// S3TC is an extension, RGTC is core since OpenGL 3.0
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// @dev KTX 1.1 container holding a 2D texture with its mip chain. Reading maps the file, the level
+// pointers point straight into the mapping and are valid until close.
+class KtxFile
+{
+public:
+	// format of the texel data and the format it is sampled as
+	GLenum internalFormat = 0;
+	GLenum baseFormat = 0;
+	// size of level 0
+	unsigned int width = 0;
+	unsigned int height = 0;
+	// texel data and its size per mip level
+	std::vector<const unsigned char*> levels;
+	std::vector<unsigned int> levelSizes;
+
+	KtxFile() {}
+	~KtxFile() {}
+
+	// @dev map and validate a container, only single 2D textures with compressed data are accepted
+	// @return False if the file is missing or not such a container
+	bool open(const char* path) {
+		close();
+		if (!file.open(path)) {
+			return false;
+		}
+		if (file.size < HEADER_SIZE || memcmp(file.data, IDENTIFIER, 12) != 0 || field(0) != ENDIANNESS) {
+			std::cout << "Not a KTX file: " << path << std::endl;
+			close();
+			return false;
+		}
+		// compressed formats have neither a type nor a format
+		if (field(1) != 0 || field(3) != 0 || field(8) != 0 || field(9) != 0 || field(10) != 1) {
+			close();
+			return false;
+		}
+		internalFormat = field(4);
+		baseFormat = field(5);
+		width = field(6);
+		height = field(7);
+		unsigned int levelCount = field(11) == 0 ? 1 : field(11);
+		size_t offset = HEADER_SIZE + (size_t)field(12);
+		for (unsigned int i = 0; i < levelCount; i++) {
+			if (offset + 4 > file.size) {
+				break;
+			}
+			unsigned int size;
+			memcpy(&size, file.data + offset, 4);
+			offset += 4;
+			if (offset + size > file.size) {
+				break;
+			}
+			levels.push_back(file.data + offset);
+			levelSizes.push_back(size);
+			// levels are padded to four bytes
+			offset += (size + 3) & ~3u;
+		}
+		if (levels.size() != levelCount) {
+			std::cout << "Truncated KTX file: " << path << std::endl;
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	// @dev release the mapping
+	void close() {
+		file.close();
+		levels.clear();
+		levelSizes.clear();
+	}
+
+	// @dev write a compressed 2D texture
+	// @param levels Texel data of every mip level, level 0 first
+	// @return False if the file cannot be written
+	static bool write(const char* path, GLenum internalFormat, GLenum baseFormat, unsigned int width, unsigned int height, const std::vector<std::vector<unsigned char>>& levels) {
+		FILE* out = fopen(path, "wb");
+		if (out == NULL) {
+			return false;
+		}
+		// the images are stored bottom row first like OpenGL expects them
+		static const char orientation[] = "KTXorientation\0S=r,T=u";
+		unsigned int keyValueSize = (unsigned int)sizeof(orientation);
+		unsigned int keyValuePadded = (4 + keyValueSize + 3) & ~3u;
+		unsigned int header[13] = { ENDIANNESS, 0, 1, 0, internalFormat, baseFormat, width, height, 0, 0, 1, (unsigned int)levels.size(), keyValuePadded };
+		const unsigned char padding[4] = { 0, 0, 0, 0 };
+		fwrite(IDENTIFIER, 1, 12, out);
+		fwrite(header, 4, 13, out);
+		fwrite(&keyValueSize, 4, 1, out);
+		fwrite(orientation, 1, keyValueSize, out);
+		fwrite(padding, 1, keyValuePadded - 4 - keyValueSize, out);
+		for (const std::vector<unsigned char>& level : levels) {
+			unsigned int size = (unsigned int)level.size();
+			fwrite(&size, 4, 1, out);
+			fwrite(level.data(), 1, size, out);
+			fwrite(padding, 1, ((size + 3) & ~3u) - size, out);
+		}
+		bool written = ferror(out) == 0;
+		fclose(out);
+		return written;
+	}
+
+private:
+	static const unsigned int ENDIANNESS = 0x04030201;
+	static const size_t HEADER_SIZE = 64;
+	static const unsigned char IDENTIFIER[12];
+	MappedFile file;
+
+	// @dev 32 bit header field after the identifier
+	unsigned int field(int index) {
+		unsigned int value;
+		memcpy(&value, file.data + 12 + index * 4, 4);
+		return value;
+	}
+};
+
+const unsigned char KtxFile::IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
@@ -5,6 +5,17 @@
 
 enum LIGHT_TYPE { POINT_LIGHT, PARALELL_LIGHT };
 
+// @dev the values of a light the UI edits, a copy can be changed while the light itself is drawn
+typedef struct LightState {
+	glm::vec3 position;
+	glm::vec3 color;
+	float ambientFactor;
+	float diffuseFactor;
+	float specularFactor;
+	float shininess;
+	bool visible;
+}LightState;
+
 float light_vertices[] = {
 				-0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
 				 0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
@@ -51,11 +62,11 @@ public:
 	// reflection strength
 	float shininess = 32;
 	// vertex array object id
-	unsigned int VAO;
+	unsigned int VAO = 0;
 	// vertex buffer object id
-	unsigned int VBO;
+	unsigned int VBO = 0;
 	// texture id
-	unsigned int texture;
+	unsigned int texture = 0;
 	// path of texture
 	const char* pointLightIcon = "Resources/Icons/bulb.jpg";
 	const char* paralLightIcon = "Resources/Icons/paral.jpg";
@@ -88,9 +99,37 @@ public:
 		glEnableVertexAttribArray(1);
 	}
 	~Light() {
-		// deallocate
-		glDeleteVertexArrays(1, &VAO);
-		glDeleteBuffers(1, &VBO);
+		destroy();
+	}
+
+	// @dev deallocate the buffers and the shader and give back the icon, while the context is current
+	void destroy() {
+		if (VAO != 0) {
+			glDeleteVertexArrays(1, &VAO);
+			glDeleteBuffers(1, &VBO);
+			glDeleteProgram(shader.ID);
+			TextureManager::getInstance()->release(texture);
+		}
+		VAO = 0;
+		VBO = 0;
+	}
+
+	// @dev copy of the values the UI edits
+	LightState state() const {
+		LightState state = { this->transform.position, lightColor, ambientFactor, diffuseFactor, specularFactor, shininess, visible };
+		return state;
+	}
+
+	// @dev take over edited values
+	void apply(const LightState& state) {
+		this->transform.position = state.position;
+		lightColor = state.color;
+		ambientFactor = state.ambientFactor;
+		diffuseFactor = state.diffuseFactor;
+		specularFactor = state.specularFactor;
+		shininess = state.shininess;
+		visible = state.visible;
+		status = visible ? "Visible" : "Invisible";
 	}
 
 
@@ -125,12 +164,12 @@ public:
 		// projection
 		// projection = glm::perspective(glm::radians(100.0f), (float)WINDOW_WIDTH * 2.0f / (float)WINDOW_HEIGHT,  0.1f, 10.0f);
 		projection = glm::perspective(glm::radians(camera.fovy), camera.aspect, camera.zNear, camera.zFar);
+		// enable the shader program
+		shader.use();
 		// pass to shader
 		shader.setMat4("model", model);
 		shader.setMat4("view", view);
 		shader.setMat4("projection", projection);
-		// enable the shader program
-		shader.use();
 		glBindVertexArray(VAO);
 		glDrawArrays(GL_TRIANGLES, 0, 6);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
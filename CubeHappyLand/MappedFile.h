@@ -0,0 +1,113 @@
+#pragma once
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// @dev Read only view of a whole file mapped into memory, pages are read by the OS on first touch
+// instead of being copied through a buffer.
+class MappedFile
+{
+public:
+	// first byte of the file, null while closed
+	const unsigned char* data = nullptr;
+	// length of the file in bytes
+	size_t size = 0;
+
+	MappedFile() {}
+	~MappedFile() {
+		close();
+	}
+
+	// @dev map a file
+	// @return False if the file does not exist, is empty or cannot be mapped
+	bool open(const char* path) {
+		close();
+#ifdef _WIN32
+		file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER length;
+		if (!GetFileSizeEx(file, &length) || length.QuadPart == 0) {
+			close();
+			return false;
+		}
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) {
+			close();
+			return false;
+		}
+		data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		size = (size_t)length.QuadPart;
+#else
+		descriptor = ::open(path, O_RDONLY);
+		if (descriptor < 0) {
+			return false;
+		}
+		struct stat status;
+		if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+			close();
+			return false;
+		}
+		void* view = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		data = view == MAP_FAILED ? nullptr : (const unsigned char*)view;
+		size = (size_t)status.st_size;
+#endif
+		if (data == nullptr) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	// @dev unmap the file
+	void close() {
+#ifdef _WIN32
+		if (data != nullptr) {
+			UnmapViewOfFile(data);
+		}
+		if (mapping != NULL) {
+			CloseHandle(mapping);
+		}
+		if (file != INVALID_HANDLE_VALUE) {
+			CloseHandle(file);
+		}
+		mapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (data != nullptr) {
+			munmap((void*)data, size);
+		}
+		if (descriptor >= 0) {
+			::close(descriptor);
+		}
+		descriptor = -1;
+#endif
+		data = nullptr;
+		size = 0;
+	}
+
+private:
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#else
+	int descriptor = -1;
+#endif
+	// a mapping is owned by one object
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
@@ -0,0 +1,167 @@
+#pragma once
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include "Object.h"
+#include "TextureManager.h"
+
+// @dev Materials of the lit scene stacked into array textures. Every map is a layer and a material
+// names the layers of its diffuse and specular map, which objects carry in their constants, so
+// objects with different materials are drawn without binding a texture in between. Maps only ever
+// used as specular maps go into a second array following the first's layers, an array takes the
+// format of its first map, so grey specular maps keep a single channel.
+// Draws are counted to tell how many binds separate 2D textures would have taken.
+class MaterialArray
+{
+public:
+	typedef struct Material {
+		std::string name;
+		int diffuseLayer;
+		int specularLayer;
+	}Material;
+	std::vector<Material> materials;
+	// array textures of the maps and of the maps only used as specular maps, valid once load has been called
+	unsigned int texture = 0;
+	unsigned int specularTexture = 0;
+	// layers of the first array, the second array's come after them
+	int colorLayers = 0;
+	// statistics of the frame, complete once the next frame binds the array
+	int draws = 0;
+	int binds = 0;
+	int bindsSaved = 0;
+
+	MaterialArray() {}
+	~MaterialArray() {}
+
+	// @dev add a material, maps already in the array are shared
+	// @param diffuse Path of the diffuse map
+	// @param specular Path of the specular map
+	// @return Index of the material
+	int add(const char* name, const char* diffuse, const char* specular) {
+		Material material = { name, layer(diffuse), layer(specular) };
+		materials.push_back(material);
+		return (int)materials.size() - 1;
+	}
+
+	// @dev load the maps of every added material into the arrays, fine mip levels are streamed in as
+	// objects come close. The layers of the materials are final from here on.
+	void load() {
+		std::vector<std::string> colorMaps, specularMaps;
+		std::vector<int> order(layers.size());
+		for (int i = 0; i < (int)layers.size(); i++) {
+			if (usedAsDiffuse(i)) {
+				order[i] = (int)colorMaps.size();
+				colorMaps.push_back(layers[i]);
+			}
+		}
+		colorLayers = (int)colorMaps.size();
+		for (int i = 0; i < (int)layers.size(); i++) {
+			if (!usedAsDiffuse(i)) {
+				order[i] = colorLayers + (int)specularMaps.size();
+				specularMaps.push_back(layers[i]);
+			}
+		}
+		for (Material& material : materials) {
+			material.diffuseLayer = order[material.diffuseLayer];
+			material.specularLayer = order[material.specularLayer];
+		}
+		layers = colorMaps;
+		layers.insert(layers.end(), specularMaps.begin(), specularMaps.end());
+		TextureParams params;
+		params.minFilter = GL_LINEAR_MIPMAP_LINEAR;
+		params.stream = true;
+		texture = TextureManager::getInstance()->loadArray(colorMaps, params);
+		if (!specularMaps.empty()) {
+			specularTexture = TextureManager::getInstance()->loadArray(specularMaps, params);
+		}
+	}
+
+	// @dev ask for the mip level an object drawn with the array needs, every layer shares it
+	// @param distance Distance from the eye to the closest point of the object
+	// @param uvDensity Texture repeats per world unit on the object
+	// @param pixelsPerUnit Pixels a world unit covers at a distance of one
+	void request(float distance, float uvDensity, float pixelsPerUnit) {
+		TextureManager::getInstance()->requestFootprint(texture, uvDensity, distance, pixelsPerUnit);
+		if (specularTexture != 0) {
+			TextureManager::getInstance()->requestFootprint(specularTexture, uvDensity, distance, pixelsPerUnit);
+		}
+	}
+
+	// @dev give the arrays' references back to the texture manager
+	void release() {
+		TextureManager::getInstance()->release(texture);
+		TextureManager::getInstance()->release(specularTexture);
+		texture = 0;
+		specularTexture = 0;
+	}
+
+	// @dev let an object use a material, takes effect with the object's next constant update
+	void apply(Object& object, int material) {
+		object.diffuseLayer = materials[material].diffuseLayer;
+		object.specularLayer = materials[material].specularLayer;
+	}
+
+	// @dev index of the material an object uses
+	// @return -1 if the object's layers are no material
+	int find(const Object& object) {
+		for (int i = 0; i < (int)materials.size(); i++) {
+			if (materials[i].diffuseLayer == object.diffuseLayer && materials[i].specularLayer == object.specularLayer) {
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	// @dev bind the arrays and start counting the draws of a frame
+	// @param unit, specularUnit Texture units the shader samples the arrays from
+	void bind(GLenum unit, GLenum specularUnit) {
+		glActiveTexture(specularUnit);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, specularTexture);
+		glActiveTexture(unit);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+		draws = 0;
+		binds = 0;
+		bindsSaved = 0;
+		lastDiffuse = -1;
+		lastSpecular = -1;
+	}
+
+	// @dev count a draw of an object with the bound array
+	void draw(const Object& object) {
+		// separate textures would rebind every map that differs from the previous draw's
+		binds += object.diffuseLayer != lastDiffuse ? 1 : 0;
+		binds += object.specularLayer != lastSpecular ? 1 : 0;
+		lastDiffuse = object.diffuseLayer;
+		lastSpecular = object.specularLayer;
+		draws++;
+		// the array itself took one bind
+		bindsSaved = binds - 1;
+	}
+
+private:
+	// paths of the maps in layer order, the order changes once they are loaded
+	std::vector<std::string> layers;
+	// maps of the previous draw
+	int lastDiffuse = -1;
+	int lastSpecular = -1;
+
+	// @dev layer of a map, appended if it is not in the array yet
+	int layer(const char* path) {
+		for (int i = 0; i < (int)layers.size(); i++) {
+			if (layers[i] == path) {
+				return i;
+			}
+		}
+		layers.push_back(path);
+		return (int)layers.size() - 1;
+	}
+
+	bool usedAsDiffuse(int layer) const {
+		for (const Material& material : materials) {
+			if (material.diffuseLayer == layer) {
+				return true;
+			}
+		}
+		return false;
+	}
+};
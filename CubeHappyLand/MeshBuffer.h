@@ -0,0 +1,53 @@
+#pragma once
+#include <glad/glad.h>
+
+// @dev Interleaved mesh uploaded once and drawn by every object sharing it, vertices are laid out
+// as position, normal, texture coordinates.
+class MeshBuffer
+{
+public:
+	// vertex array object id
+	unsigned int VAO = 0;
+	// vertex buffer object id
+	unsigned int VBO = 0;
+	// number of vertices
+	int count = 0;
+
+	MeshBuffer() {}
+	~MeshBuffer() {}
+
+	// @dev upload the vertices
+	// @param vertices Eight floats per vertex
+	// @param count Number of vertices
+	void create(const float* vertices, int count) {
+		this->count = count;
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, count * 8 * sizeof(float), vertices, GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glEnableVertexAttribArray(2);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindVertexArray(0);
+	}
+
+	// @dev deallocate the buffers
+	void destroy() {
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+		VAO = 0;
+		VBO = 0;
+	}
+
+	// @dev draw the whole mesh with the current program
+	void draw() {
+		glBindVertexArray(VAO);
+		glDrawArrays(GL_TRIANGLES, 0, count);
+		glBindVertexArray(0);
+	}
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include "Shader.h"
+#include "ObjectBuffer.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -42,6 +43,11 @@ public:
 	}Transform;
 	// position, rotation and scale of the object
 	Transform transform;
+	// slot of the object's matrices in the object buffer, -1 until they are first computed
+	int constantSlot = -1;
+	// layers of the object's diffuse and specular map in the material array
+	int diffuseLayer = 0;
+	int specularLayer = 0;
 
 
 	// Operations
@@ -66,4 +72,63 @@ public:
 	void lookAt(glm::vec3 target) {
 		// do something
 	}
+
+	// Transform stage
+	//
+	// @dev Recompute the matrices of the object when its transform, material or the camera has changed
+	// since the last call and hand them to the object buffer. The normal matrix needs an inverse, so it is
+	// only recomputed when the object itself has changed.
+	// @param viewProjection Projection matrix times view matrix of the camera
+	// @param meshScale Size of the mesh, multiplied into the scaling
+	void updateConstants(const glm::mat4& viewProjection, float meshScale = 1.0f) {
+		bool moved = constantSlot == -1
+			|| transform.position != cachedPosition
+			|| transform.rotation != cachedRotation
+			|| transform.scale * meshScale != cachedScale;
+		bool retextured = diffuseLayer != (int)constants.materialLayers.x || specularLayer != (int)constants.materialLayers.y;
+		if (!moved && !retextured && viewProjection == cachedViewProjection) {
+			return;
+		}
+		ObjectBuffer* objectBuffer = ObjectBuffer::getInstance();
+		if (constantSlot == -1) {
+			constantSlot = objectBuffer->allocate();
+		}
+		if (moved) {
+			cachedPosition = transform.position;
+			cachedRotation = transform.rotation;
+			cachedScale = transform.scale * meshScale;
+			// identity matrix
+			glm::mat4 model = glm::mat4(1.0f);
+			// translate to position
+			model = glm::translate(model, cachedPosition);
+			// rotate around x-axis
+			model = glm::rotate(model, glm::radians(cachedRotation[0]), glm::vec3(1.0f, 0.0f, 0.0f));
+			// rotate around y-axis
+			model = glm::rotate(model, glm::radians(cachedRotation[1]), glm::vec3(0.0f, 1.0f, 0.0f));
+			// rotate around z-axis
+			model = glm::rotate(model, glm::radians(cachedRotation[2]), glm::vec3(0.0f, 0.0f, 1.0f));
+			// scaling
+			model = glm::scale(model, cachedScale);
+			constants.model = model;
+			constants.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+		}
+		cachedViewProjection = viewProjection;
+		constants.mvp = viewProjection * constants.model;
+		constants.materialLayers = glm::vec4((float)diffuseLayer, (float)specularLayer, 0.0f, 0.0f);
+		objectBuffer->update(constantSlot, constants);
+	}
+
+	// @dev make the object's matrices visible to the shaders' Object block
+	void bindConstants() {
+		ObjectBuffer::getInstance()->bind(constantSlot);
+	}
+
+private:
+	// transform and camera the current matrices were computed from
+	glm::vec3 cachedPosition;
+	glm::vec3 cachedRotation;
+	glm::vec3 cachedScale;
+	glm::mat4 cachedViewProjection;
+	// matrices of the object
+	ObjectConstants constants;
 };
\ No newline at end of file
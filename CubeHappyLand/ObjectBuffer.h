@@ -0,0 +1,180 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstring>
+#include <vector>
+#include "Shader.h"
+
+// @dev matrices of one object as laid out in the Object block of ShaderCode.h, the normal matrix is
+// padded to a mat4 so the std140 layout matches the C++ one
+typedef struct ObjectConstants {
+	glm::mat4 model;
+	glm::mat4 mvp;
+	glm::mat4 normalMatrix;
+	// layers of the diffuse and specular map in the material array
+	glm::vec4 materialLayers;
+}ObjectConstants;
+
+// @dev slots changed since the last collect, uploaded by the thread owning the context
+typedef struct ObjectUpload {
+	// bytes from the first to the last changed slot and where they go
+	std::vector<unsigned char> bytes;
+	int offset = 0;
+	// bytes the buffer has to hold
+	int size = 0;
+	// number of slots in the range
+	int slots = 0;
+}ObjectUpload;
+
+// @dev Per object constant buffer. Every object owns a slot holding its model, MVP and normal matrix,
+// which are computed on the CPU only when the object or the camera changes instead of per vertex.
+// Changed slots are collected in a CPU copy and uploaded with a single call per frame, drawing an
+// object just binds its range of the buffer. Updating slots needs no context: collect copies the
+// changed range out and upload hands it to GL, so matrices can be computed on another thread than
+// the one drawing.
+class ObjectBuffer
+{
+private:
+	ObjectBuffer() {}
+	~ObjectBuffer() {
+		glDeleteBuffers(1, &UBO);
+		delete instance;
+	}
+	// uniform buffer object id
+	unsigned int UBO = 0;
+	// bytes between two slots, respects GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	int stride = 0;
+	// slots of the CPU copy
+	int capacity = 0;
+	// capacity at the last collect, growing the buffer uploads every slot again
+	int collectedCapacity = 0;
+	// bytes allocated on the GPU
+	int allocatedBytes = 0;
+	// range for flush
+	ObjectUpload pending;
+	// slots in use
+	int size = 0;
+	// CPU copy of the buffer
+	std::vector<unsigned char> data;
+	// range of slots changed since the last flush
+	int dirtyBegin = 0;
+	int dirtyEnd = 0;
+public:
+	// binding point of the Object block
+	static const GLuint BINDING = 1;
+	// statistics of the last flush
+	int uploadedSlots = 0;
+
+	// @dev find the stride between slots, needs the context and has to run before slots are
+	// allocated on a thread without it
+	void initialize() {
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		stride = ((int)sizeof(ObjectConstants) + alignment - 1) / alignment * alignment;
+	}
+
+	// @dev reserve a slot for an object
+	// @return Index of the slot
+	int allocate() {
+		if (stride == 0) {
+			initialize();
+		}
+		if (size == capacity) {
+			reserve(capacity == 0 ? 64 : capacity * 2);
+		}
+		return size++;
+	}
+
+	// @dev store new matrices of a slot, they reach the GPU with the next flush
+	void update(int slot, const ObjectConstants& constants) {
+		memcpy(&data[slot * stride], &constants, sizeof(ObjectConstants));
+		if (dirtyBegin == dirtyEnd) {
+			dirtyBegin = slot;
+			dirtyEnd = slot + 1;
+		}
+		else {
+			dirtyBegin = slot < dirtyBegin ? slot : dirtyBegin;
+			dirtyEnd = slot + 1 > dirtyEnd ? slot + 1 : dirtyEnd;
+		}
+	}
+
+	// @dev delete the buffer while the context is current, the next flush creates it again with
+	// every slot
+	void destroy() {
+		glDeleteBuffers(1, &UBO);
+		UBO = 0;
+		allocatedBytes = 0;
+		collectedCapacity = 0;
+	}
+
+	// @dev upload every slot changed since the last flush, called once per frame before drawing
+	void flush() {
+		collect(pending);
+		upload(pending);
+	}
+
+	// @dev copy out the slots changed since the last collect
+	void collect(ObjectUpload& out) {
+		if (capacity != collectedCapacity) {
+			collectedCapacity = capacity;
+			dirtyBegin = 0;
+			dirtyEnd = size;
+		}
+		out.size = capacity * stride;
+		out.slots = dirtyEnd - dirtyBegin;
+		out.offset = dirtyBegin * stride;
+		out.bytes.assign(data.begin() + dirtyBegin * stride, data.begin() + dirtyEnd * stride);
+		dirtyBegin = dirtyEnd = 0;
+	}
+
+	// @dev write collected slots into the buffer, growing it first if needed
+	void upload(const ObjectUpload& changes) {
+		uploadedSlots = changes.slots;
+		if (changes.size > allocatedBytes) {
+			// a grown copy is collected whole, the old buffer has nothing left to keep
+			glDeleteBuffers(1, &UBO);
+			glGenBuffers(1, &UBO);
+			glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+			glBufferData(GL_UNIFORM_BUFFER, changes.size, NULL, GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+			allocatedBytes = changes.size;
+		}
+		if (changes.bytes.empty()) {
+			return;
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, changes.offset, (GLsizeiptr)changes.bytes.size(), changes.bytes.data());
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	// @dev make the matrices of a slot visible to the Object block of the current program
+	void bind(int slot) {
+		glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, UBO, slot * stride, sizeof(ObjectConstants));
+	}
+
+	// @dev connect the Object block of a program to our binding point
+	void bindProgram(Shader& shader) {
+		GLuint index = glGetUniformBlockIndex(shader.ID, "Object");
+		if (index != GL_INVALID_INDEX) {
+			glUniformBlockBinding(shader.ID, index, BINDING);
+		}
+	}
+
+	// makes ObjectBuffer an instance
+	static ObjectBuffer* getInstance() {
+		if (instance == NULL) {
+			instance = new ObjectBuffer();
+		}
+		return instance;
+	}
+private:
+	static ObjectBuffer* instance;
+
+	// @dev grow the CPU copy, slots keep their content and the buffer follows with the next upload
+	void reserve(int slots) {
+		data.resize(slots * stride);
+		capacity = slots;
+	}
+};
+
+ObjectBuffer* ObjectBuffer::instance = NULL;
@@ -3,6 +3,8 @@
 #include "Object.h"
 #include "Camera.h"
 #include "Light.h"
+#include "DepthStream.h"
+#include "MeshBuffer.h"
 
 GLfloat planeVertices[] = {
 	// Positions          // Normals         // Texture Coords
@@ -24,6 +26,10 @@ private:
 	// vertex buffer object id
 	unsigned int VBO;
 public:
+	// position only stream for depth passes
+	static DepthStream depthStream;
+	// mesh of the lit passes
+	static MeshBuffer mesh;
 	Plane() {}
 	Plane(glm::vec3 position, glm::vec3 rotation, glm::vec3 scale) {
 		this->transform.position = position;
@@ -32,96 +38,44 @@ public:
 	}
 	~Plane() {}
 
-	// render depth map
-	void render(Shader shader) {
-		glm::vec3 position = this->transform.position;
-		glm::vec3 rotation = this->transform.rotation;
+	// @dev distance from a point to the closest point of the plane, rotation is not taken into account
+	float distanceTo(glm::vec3 eye) {
 		glm::vec3 scale = this->transform.scale;
+		glm::vec3 center = this->transform.position + glm::vec3(0.0f, -0.5f * scale.y, 0.0f);
+		glm::vec3 halfSize = glm::vec3(25.0f * scale.x, 0.0f, 25.0f * scale.z);
+		return glm::length(eye - glm::clamp(eye, center - halfSize, center + halfSize));
+	}
 
-		unsigned int VAO;
-		glGenVertexArrays(1, &VAO);
-		unsigned int VBO;
-		glGenBuffers(1, &VBO);
-
-		glBindVertexArray(VAO);
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+	// @dev texture repeats per world unit, the mesh repeats the texture 25 times over 50 units
+	float uvDensity() {
+		glm::vec3 scale = this->transform.scale;
+		return 0.5f / glm::max(glm::min(scale.x, scale.z), 0.001f);
+	}
 
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (GLvoid*)0);
-		glEnableVertexAttribArray(0);
+	// render depth map
+	void render(Shader shader) {
+		// positions only, shared by every instance
+		if (depthStream.VAO == 0) {
+			depthStream.create(planeVertices, 6, 8);
+		}
 
-		// transformation
-		// identity matrix
-		glm::mat4 model = glm::mat4(1.0f);
-		// translate to position
-		model = glm::translate(model, glm::vec3(position[0], position[1], position[2]));
-		// rotate around x-axis
-		model = glm::rotate(model, glm::radians(rotation[0]), glm::vec3(1.0f, 0.0f, 0.0f));
-		// rotate around y-axis
-		model = glm::rotate(model, glm::radians(rotation[1]), glm::vec3(0.0f, 1.0f, 0.0f));
-		// rotate around z-axis
-		model = glm::rotate(model, glm::radians(rotation[2]), glm::vec3(0.0f, 0.0f, 1.0f));
-		// scaling
-		model = glm::scale(model, glm::vec3(scale[0], scale[1], scale[2]));
-		shader.setMat4("model", model);
 		// enable the shader program
 		shader.use();
-		glBindVertexArray(VAO);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+		bindConstants();
+		depthStream.draw();
 	}
 	// render with texture
-	void render(Camera camera, Light light, Shader shader) {
-
-		glm::vec3 position = this->transform.position;
-		glm::vec3 rotation = this->transform.rotation;
-		glm::vec3 scale = this->transform.scale;
-
-		unsigned int VAO;
-		glGenVertexArrays(1, &VAO);
-		unsigned int VBO;
-		glGenBuffers(1, &VBO);
-
-		glBindVertexArray(VAO);
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), planeVertices, GL_STATIC_DRAW);
+	void render(Camera camera, Light& light, Shader shader) {
 
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-		glEnableVertexAttribArray(0);
-		glEnableVertexAttribArray(1);
-		glEnableVertexAttribArray(2);
+		// full vertices, shared by every instance
+		if (mesh.VAO == 0) {
+			mesh.create(planeVertices, 6);
+		}
 
 		// DRAW
 		shader.use();
-		// create Transform
-		// identity matrix
-		glm::mat4 model = glm::mat4(1.0f);
-		glm::mat4 view = glm::mat4(1.0f);
-		glm::mat4 projection = glm::mat4(1.0f);
-		// transformation
-		// translate to position
-		model = glm::translate(model, glm::vec3(position[0], position[1], position[2]));
-		// rotate around x-axis
-		model = glm::rotate(model, glm::radians(rotation[0]), glm::vec3(1.0f, 0.0f, 0.0f));
-		// rotate around y-axis
-		model = glm::rotate(model, glm::radians(rotation[1]), glm::vec3(0.0f, 1.0f, 0.0f));
-		// rotate around z-axis
-		model = glm::rotate(model, glm::radians(rotation[2]), glm::vec3(0.0f, 0.0f, 1.0f));
-		// scaling
-		model = glm::scale(model, glm::vec3(scale[0], scale[1], scale[2]));
-		// view
-		view = glm::lookAt(camera.transform.position, -camera.transform.forward + camera.transform.position, camera.transform.up);
-		// projection
-		// projection = glm::perspective(glm::radians(100.0f), (float)WINDOW_WIDTH * 2.0f / (float)WINDOW_HEIGHT,  0.1f, 10.0f);
-		projection = glm::perspective(glm::radians(camera.fovy), camera.aspect, camera.zNear, camera.zFar);
-		// pass to shader
-		// view
-		shader.setMat4("model", model);
-		shader.setMat4("view", view);
-		shader.setMat4("projection", projection);
+		// matrices computed by the transform stage
+		bindConstants();
 		// light properties
 		shader.setVec3("light.ambient", 0.2f, 0.2f, 0.2f);
 		shader.setVec3("light.diffuse", 0.5f, 0.5f, 0.5f);
@@ -130,10 +84,9 @@ public:
 		shader.setVec3("light.position", light.transform.position);
 		shader.setVec3("light.color", light.lightColor);
 		shader.setFloat("material.shininess", light.shininess);
-		glBindVertexArray(VAO);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+		mesh.draw();
 	}
 };
 
+DepthStream Plane::depthStream;
+MeshBuffer Plane::mesh;
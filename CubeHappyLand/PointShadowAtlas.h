@@ -0,0 +1,253 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <string>
+#include "Shader.h"
+
+// @dev Omnidirectional shadow maps for point lights. Every light owns a slot of six consecutive
+// layers (+X, -X, +Y, -Y, +Z, -Z) in one shared depth texture array, so all point lights are
+// sampled through a single sampler and rendered by one layered pass each. A geometry shader
+// routes every triangle to the faces it touches with gl_Layer, and objects are culled against
+// the six face frustums on the CPU beforehand. Only updateBudget lights are redrawn per frame.
+class PointShadowAtlas
+{
+public:
+	// number of point lights sharing the atlas, keep in sync with pointLights[] in the lit shaders
+	static const int MAX_LIGHTS = 4;
+	// layers used by one light
+	static const int FACES = 6;
+
+	// resolution of each cube face
+	unsigned int resolution = 512;
+	// cut off planes of the face frustums
+	float nearPlane = 0.1f;
+	float farPlane = 25.0f;
+	// maximum number of lights redrawn in one frame
+	int updateBudget = 1;
+	// depth texture array holding MAX_LIGHTS * FACES layers
+	unsigned int depthArray = 0;
+	// statistics of the last frame
+	int updatedLights = 0;
+	int culledFaces = 0;
+
+	PointShadowAtlas() {}
+	~PointShadowAtlas() {}
+
+	// @dev create the layered depth texture and the frame buffers rendering into it
+	// @param resolution Size of each cube face in pixels
+	void initialize(unsigned int resolution) {
+		this->resolution = resolution;
+
+		glGenTextures(1, &depthArray);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, MAX_LIGHTS * FACES, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		// hardware depth comparison gives us a 2x2 PCF for free
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+		// layered frame buffer, gl_Layer selects the face written by the geometry shader
+		glGenFramebuffers(1, &layeredFBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, layeredFBO);
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Point shadow frame buffer is not complete!" << std::endl;
+		}
+		// glClear on a layered attachment clears every layer, so single layers are cleared through this one
+		glGenFramebuffers(1, &layerFBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, layerFBO);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	// @dev deallocate the texture array and frame buffers
+	void destroy() {
+		glDeleteFramebuffers(1, &layeredFBO);
+		glDeleteFramebuffers(1, &layerFBO);
+		glDeleteTextures(1, &depthArray);
+	}
+
+	// @dev reserve a slot for a point light
+	// @return Index of the slot or -1 if the atlas is full
+	int allocate() {
+		for (int i = 0; i < MAX_LIGHTS; i++) {
+			if (!slots[i].used) {
+				slots[i] = Slot();
+				slots[i].used = true;
+				return i;
+			}
+		}
+		std::cout << "Point shadow atlas is full!" << std::endl;
+		return -1;
+	}
+
+	// @dev give a slot back to the atlas
+	void release(int slot) {
+		if (slot >= 0 && slot < MAX_LIGHTS) {
+			slots[slot].used = false;
+		}
+	}
+
+	// @dev update the position of a light, its shadow is redrawn only if the light has moved
+	void setPosition(int slot, glm::vec3 position) {
+		if (slot < 0 || slot >= MAX_LIGHTS) {
+			return;
+		}
+		if (slots[slot].position != position) {
+			slots[slot].position = position;
+			slots[slot].dirty = true;
+		}
+	}
+
+	// @dev position of the light a slot has been rendered for
+	glm::vec3 position(int slot) const {
+		return slots[slot].position;
+	}
+
+	// @dev mark every shadow as out of date, called whenever a shadow caster has changed
+	void invalidate() {
+		for (int i = 0; i < MAX_LIGHTS; i++) {
+			slots[i].dirty = true;
+		}
+	}
+
+	// @dev pick the next shadow to redraw. Dirty slots are served round robin and at most updateBudget
+	// of them per frame, the rest keep their previous maps until a later frame.
+	// @return Slot to render or -1 if nothing is left to do this frame
+	int next() {
+		if (updatedLights >= updateBudget) {
+			return -1;
+		}
+		for (int i = 1; i <= MAX_LIGHTS; i++) {
+			int slot = (cursor + i) % MAX_LIGHTS;
+			if (slots[slot].used && slots[slot].dirty) {
+				cursor = slot;
+				return slot;
+			}
+		}
+		return -1;
+	}
+
+	// @dev begin a new frame, resets the per frame budget
+	void beginFrame() {
+		updatedLights = 0;
+		culledFaces = 0;
+	}
+
+	// @dev world to clip space matrix of one cube face of a light
+	glm::mat4 faceMatrix(glm::vec3 position, int face) const {
+		// face directions and up vectors follow the cube map convention used when sampling
+		static const glm::vec3 directions[FACES] = {
+			{ 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f },
+			{ 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+			{ 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }
+		};
+		static const glm::vec3 ups[FACES] = {
+			{ 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+			{ 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+			{ 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }
+		};
+		glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, nearPlane, farPlane);
+		return projection * glm::lookAt(position, position + directions[face], ups[face]);
+	}
+
+	// @dev cull a bounding sphere against the six face frustums of a light
+	// @param light Position of the light
+	// @param center Center of the bounding sphere
+	// @param radius Radius of the bounding sphere
+	// @return Bit mask of faces the sphere intersects, bit i stands for layer i of the slot
+	int faceMask(glm::vec3 light, glm::vec3 center, float radius) {
+		glm::vec3 c = center - light;
+		// out of range of the light
+		if (glm::length(c) - radius > farPlane) {
+			culledFaces += FACES;
+			return 0;
+		}
+		const float invSqrt2 = 0.70710678f;
+		int mask = 0;
+		for (int face = 0; face < FACES; face++) {
+			int axis = face / 2;
+			float sign = (face % 2 == 0) ? 1.0f : -1.0f;
+			float a = sign * c[axis];
+			// the four side planes of a 90 degree frustum are a = +-b for both other axes
+			bool inside = true;
+			for (int other = 0; other < 3 && inside; other++) {
+				if (other == axis) {
+					continue;
+				}
+				if ((a - c[other]) * invSqrt2 < -radius || (a + c[other]) * invSqrt2 < -radius) {
+					inside = false;
+				}
+			}
+			if (inside) {
+				mask |= 1 << face;
+			}
+		}
+		culledFaces += FACES - bitCount(mask);
+		return mask;
+	}
+
+	// @dev bind the atlas for drawing the shadow of one slot, clears its six layers and uploads
+	// the face matrices to the layered depth shader
+	// @param slot Slot of the light
+	// @param shader Layered depth shader
+	void begin(int slot, Shader& shader) {
+		glViewport(0, 0, resolution, resolution);
+		// clear only the layers of this slot so other lights keep their maps
+		glBindFramebuffer(GL_FRAMEBUFFER, layerFBO);
+		for (int face = 0; face < FACES; face++) {
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, slot * FACES + face);
+			glClear(GL_DEPTH_BUFFER_BIT);
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, layeredFBO);
+
+		shader.use();
+		for (int face = 0; face < FACES; face++) {
+			shader.setMat4("faceMatrices[" + std::to_string(face) + "]", faceMatrix(slots[slot].position, face));
+		}
+		shader.setInt("layerBase", slot * FACES);
+	}
+
+	// @dev finish drawing the shadow of one slot
+	void end(int slot) {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		slots[slot].dirty = false;
+		updatedLights++;
+	}
+
+	// @dev first layer of a slot in the texture array
+	int layer(int slot) const {
+		return slot * FACES;
+	}
+
+private:
+	typedef struct Slot {
+		bool used = false;
+		bool dirty = true;
+		glm::vec3 position = { 0.0f, 0.0f, 0.0f };
+	}Slot;
+	Slot slots[MAX_LIGHTS];
+	// frame buffer with the whole texture array attached
+	unsigned int layeredFBO = 0;
+	// frame buffer used to clear single layers
+	unsigned int layerFBO = 0;
+	// last slot served by next()
+	int cursor = MAX_LIGHTS - 1;
+
+	static int bitCount(int mask) {
+		int count = 0;
+		for (; mask; mask >>= 1) {
+			count += mask & 1;
+		}
+		return count;
+	}
+};
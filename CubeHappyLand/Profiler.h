@@ -0,0 +1,248 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "GpuTimer.h"
+
+// zones are built in unless PROFILER_DISABLED is defined, then the profiler is compiled out and the
+// PROFILE_ macros expand to nothing
+#ifndef PROFILER_DISABLED
+#define PROFILER_ENABLED
+#endif
+
+#ifdef PROFILER_ENABLED
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROFILER_TSC
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define PROFILER_TSC
+#endif
+
+// @dev a finished zone, times are raw ticks of Profiler::ticks
+typedef struct ProfileEvent {
+	const char* name;
+	uint64_t begin;
+	uint64_t end;
+}ProfileEvent;
+
+// @dev Ring of the zones one thread has finished. Only the owning thread writes: it fills the slot
+// after the last one and then publishes the new count, a reader copies the slots and afterwards
+// drops those the writer may have reused meanwhile. Neither side takes a lock.
+class ProfileBuffer
+{
+public:
+	// zones kept per thread, a power of two
+	static const uint64_t CAPACITY = 1 << 15;
+	std::string thread;
+	int id = 0;
+
+	ProfileBuffer(int id) : id(id), events(new ProfileEvent[CAPACITY]) {
+		thread = "Thread " + std::to_string(id);
+	}
+
+	void push(const char* name, uint64_t begin, uint64_t end) {
+		uint64_t index = written.load(std::memory_order_relaxed);
+		ProfileEvent& event = events[index & (CAPACITY - 1)];
+		event.name = name;
+		event.begin = begin;
+		event.end = end;
+		written.store(index + 1, std::memory_order_release);
+	}
+
+	// @return The zones still in the ring, oldest first
+	std::vector<ProfileEvent> copy() const {
+		uint64_t end = written.load(std::memory_order_acquire);
+		uint64_t first = end > CAPACITY ? end - CAPACITY : 0;
+		std::vector<ProfileEvent> copied;
+		for (uint64_t i = first; i < end; i++) {
+			copied.push_back(events[i & (CAPACITY - 1)]);
+		}
+		// the writer has gone on meanwhile, the oldest copies may have been overwritten, and the slot
+		// after the last published one may be half written; the fence keeps the copies above from
+		// being read after the count
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t after = written.load(std::memory_order_relaxed);
+		uint64_t valid = after + 1 > CAPACITY ? after + 1 - CAPACITY : 0;
+		if (valid > first) {
+			copied.erase(copied.begin(), copied.begin() + (size_t)std::min(valid - first, (uint64_t)copied.size()));
+		}
+		return copied;
+	}
+private:
+	std::atomic<uint64_t> written{ 0 };
+	std::unique_ptr<ProfileEvent[]> events;
+};
+
+// @dev CPU profiler. Scopes marked with PROFILE_ZONE are timed with the CPU's time stamp counter,
+// or the steady clock where there is none, and recorded into a ring of the thread running them,
+// so a zone costs two counter reads and a store. Buffers are created on a thread's first zone and
+// kept after it ends. writeTrace turns what the rings hold into a Chrome trace, for chrome://tracing
+// or Perfetto, together with the GPU passes of GpuTimer; ticks are converted to microseconds of the
+// steady clock, the clock GpuTimer puts its passes on.
+class Profiler
+{
+public:
+	// @return Current tick of the profiler's clock
+	static inline uint64_t ticks() {
+#ifdef PROFILER_TSC
+		return __rdtsc();
+#else
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	// @return Ring of the calling thread, created on its first zone
+	static ProfileBuffer* buffer() {
+		static thread_local ProfileBuffer* current = NULL;
+		if (current == NULL) {
+			current = getInstance()->add();
+		}
+		return current;
+	}
+
+	// @dev name the calling thread in traces
+	void nameThread(const char* name) {
+		ProfileBuffer* current = buffer();
+		std::lock_guard<std::mutex> lock(mutex);
+		current->thread = name;
+	}
+
+	// @return Number of threads that have recorded zones
+	int threads() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return (int)buffers.size();
+	}
+
+	// @dev write the zones of every thread and the given GPU frames as Chrome trace events
+	// @param passes Names of the GPU passes, GpuTimer::passes
+	// @return false if the file could not be written
+	bool writeTrace(const std::string& path, const std::vector<GpuFrame>& gpuFrames, const std::vector<std::string>& passes) {
+		FILE* out = fopen(path.c_str(), "w");
+		if (out == NULL) {
+			std::cout << "Failed to write " << path << std::endl;
+			return false;
+		}
+		// ticks per microsecond, measured over the profiler's lifetime so far
+		uint64_t tick = ticks();
+		double now = microseconds();
+		double rate = now > startTime ? (tick - startTick) / (now - startTime) : 1.0;
+		fprintf(out, "{\"traceEvents\": [\n");
+		fprintf(out, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"CubeHappyLand\"}}");
+		std::vector<ProfileBuffer*> threads;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (std::unique_ptr<ProfileBuffer>& buffer : buffers) {
+				threads.push_back(buffer.get());
+				fprintf(out, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}", buffer->id, escape(buffer->thread).c_str());
+			}
+		}
+		int zones = 0;
+		for (ProfileBuffer* thread : threads) {
+			for (const ProfileEvent& event : thread->copy()) {
+				double begin = startTime + ((double)event.begin - (double)startTick) / rate;
+				double duration = (event.end - event.begin) / rate;
+				fprintf(out, ",\n{\"name\": \"%s\", \"cat\": \"cpu\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}", escape(event.name).c_str(), thread->id, begin, duration);
+				zones++;
+			}
+		}
+		// the GPU is a thread of its own
+		fprintf(out, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"GPU\"}}");
+		for (const GpuFrame& gpuFrame : gpuFrames) {
+			for (const GpuScope& scope : gpuFrame.scopes) {
+				fprintf(out, ",\n{\"name\": \"%s\", \"cat\": \"gpu\", \"ph\": \"X\", \"pid\": 1, \"tid\": 0, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"frame\": %lld}}",
+					escape(passes[scope.pass]).c_str(), scope.start, scope.duration * 1000.0, gpuFrame.frame);
+			}
+		}
+		fprintf(out, "\n], \"displayTimeUnit\": \"ms\"}\n");
+		fclose(out);
+		std::cout << "Wrote " << zones << " zones of " << threads.size() << " threads and " << gpuFrames.size() << " GPU frames to " << path << std::endl;
+		return true;
+	}
+
+	// @dev window saving the trace on demand
+	void overlay() {
+		ImGui::Begin("Profiler");
+		ImGui::Text("%d threads, %d zones kept per thread", threads(), (int)ProfileBuffer::CAPACITY);
+		if (ImGui::Button("Save trace")) {
+			char path[64];
+			snprintf(path, sizeof(path), "trace_%d.json", saved++);
+			GpuTimer* gpuTimer = GpuTimer::getInstance();
+			writeTrace(path, gpuTimer->recent(), gpuTimer->passes());
+		}
+		ImGui::End();
+	}
+
+	// makes Profiler an instance
+	static Profiler* getInstance() {
+		if (instance == NULL) {
+			instance = new Profiler();
+		}
+		return instance;
+	}
+private:
+	static Profiler* instance;
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ProfileBuffer>> buffers;
+	uint64_t startTick = 0;
+	double startTime = 0.0;
+	int saved = 0;
+
+	Profiler() {
+		startTick = ticks();
+		startTime = microseconds();
+	}
+
+	ProfileBuffer* add() {
+		std::lock_guard<std::mutex> lock(mutex);
+		buffers.push_back(std::unique_ptr<ProfileBuffer>(new ProfileBuffer((int)buffers.size() + 1)));
+		return buffers.back().get();
+	}
+
+	static double microseconds() {
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	static std::string escape(const std::string& text) {
+		std::string escaped;
+		for (char c : text) {
+			if (c == '"' || c == '\\') {
+				escaped += '\\';
+			}
+			escaped += c;
+		}
+		return escaped;
+	}
+};
+
+Profiler* Profiler::instance = NULL;
+
+// @dev times the scope it is declared in
+class ProfileZone
+{
+public:
+	ProfileZone(const char* name) : name(name), begin(Profiler::ticks()) {}
+	~ProfileZone() {
+		Profiler::buffer()->push(name, begin, Profiler::ticks());
+	}
+private:
+	const char* name;
+	uint64_t begin;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// time the rest of the enclosing scope, the name has to outlive the profiler, a string literal
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_THREAD(name) Profiler::getInstance()->nameThread(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_THREAD(name)
+#endif
@@ -0,0 +1,168 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+
+// @dev axis aligned rectangle, minimum and maximum included
+typedef struct QuadBounds {
+	float minX, minY, maxX, maxY;
+}QuadBounds;
+
+inline bool overlaps(const QuadBounds& a, const QuadBounds& b) {
+	return a.minX <= b.maxX && b.minX <= a.maxX && a.minY <= b.maxY && b.minY <= a.maxY;
+}
+
+// @dev Loose quadtree of ids with bounds. Each node owns a square and accepts items within that square
+// grown by half its size on every side. An item goes down to the child holding its center as long as
+// it fits the child's loose square, so items crossing split lines still sink unless they are larger
+// than the child itself. A leaf splits once it holds more than NODE_CAPACITY items, items that fit no
+// child, such as ones outside the world square, are kept in the node above.
+class QuadTree
+{
+public:
+	static const int NODE_CAPACITY = 16;
+	static const int MAX_DEPTH = 14;
+
+	QuadTree() {
+		reset({ -1.0f, -1.0f, 1.0f, 1.0f });
+	}
+	~QuadTree() {}
+
+	// @dev remove every item and set the square the tree divides
+	void reset(const QuadBounds& world) {
+		nodes.clear();
+		nodes.push_back(Node());
+		nodes[0].bounds = world;
+		count = 0;
+	}
+
+	void insert(int id, const QuadBounds& bounds) {
+		QuadItem item = { id, bounds };
+		int node = 0, depth = 0;
+		while (true) {
+			Node& current = nodes[node];
+			if (current.children < 0) {
+				current.items.push_back(item);
+				if ((int)current.items.size() > NODE_CAPACITY && depth < MAX_DEPTH) {
+					split(node);
+				}
+				break;
+			}
+			int child = childContaining(node, bounds);
+			if (child < 0) {
+				current.items.push_back(item);
+				break;
+			}
+			node = child;
+			depth++;
+		}
+		count++;
+	}
+
+	// @dev remove an item, its bounds must be the ones it was inserted with
+	// @return False if the item was not found
+	bool remove(int id, const QuadBounds& bounds) {
+		int node = 0;
+		while (node >= 0) {
+			std::vector<QuadItem>& items = nodes[node].items;
+			for (size_t i = 0; i < items.size(); i++) {
+				if (items[i].id == id) {
+					items[i] = items.back();
+					items.pop_back();
+					count--;
+					return true;
+				}
+			}
+			node = nodes[node].children < 0 ? -1 : childContaining(node, bounds);
+		}
+		return false;
+	}
+
+	// @dev append the ids of the items overlapping an area
+	void query(const QuadBounds& area, std::vector<int>& result) const {
+		visit(0, area, result);
+	}
+
+	int size() const {
+		return count;
+	}
+
+	int nodeCount() const {
+		return (int)nodes.size();
+	}
+
+private:
+	typedef struct QuadItem {
+		int id;
+		QuadBounds bounds;
+	}QuadItem;
+
+	typedef struct Node {
+		QuadBounds bounds;
+		// first of the four children, -1 for a leaf
+		int children = -1;
+		std::vector<QuadItem> items;
+	}Node;
+
+	std::vector<Node> nodes;
+	int count = 0;
+
+	// @dev square of a node grown by half its size on every side, all its items lie within
+	QuadBounds loose(int node) const {
+		const QuadBounds& b = nodes[node].bounds;
+		float marginX = (b.maxX - b.minX) * 0.5f, marginY = (b.maxY - b.minY) * 0.5f;
+		return { b.minX - marginX, b.minY - marginY, b.maxX + marginX, b.maxY + marginY };
+	}
+
+	// @dev child holding the center of the bounds, -1 if they do not fit its loose square
+	int childContaining(int node, const QuadBounds& bounds) const {
+		const Node& current = nodes[node];
+		float centerX = (current.bounds.minX + current.bounds.maxX) * 0.5f;
+		float centerY = (current.bounds.minY + current.bounds.maxY) * 0.5f;
+		int column = (bounds.minX + bounds.maxX) * 0.5f < centerX ? 0 : 1;
+		int row = (bounds.minY + bounds.maxY) * 0.5f < centerY ? 0 : 1;
+		int child = current.children + row * 2 + column;
+		QuadBounds area = loose(child);
+		if (bounds.minX < area.minX || bounds.maxX > area.maxX || bounds.minY < area.minY || bounds.maxY > area.maxY) {
+			return -1;
+		}
+		return child;
+	}
+
+	// @dev make four children and move down the items that fit one of them
+	void split(int node) {
+		int first = (int)nodes.size();
+		QuadBounds b = nodes[node].bounds;
+		float centerX = (b.minX + b.maxX) * 0.5f, centerY = (b.minY + b.maxY) * 0.5f;
+		// nodes may move while growing, the parent is looked up by index again afterwards
+		nodes.resize(first + 4);
+		nodes[first].bounds = { b.minX, b.minY, centerX, centerY };
+		nodes[first + 1].bounds = { centerX, b.minY, b.maxX, centerY };
+		nodes[first + 2].bounds = { b.minX, centerY, centerX, b.maxY };
+		nodes[first + 3].bounds = { centerX, centerY, b.maxX, b.maxY };
+		nodes[node].children = first;
+		std::vector<QuadItem> items;
+		items.swap(nodes[node].items);
+		for (const QuadItem& item : items) {
+			int child = childContaining(node, item.bounds);
+			nodes[child < 0 ? node : child].items.push_back(item);
+		}
+	}
+
+	void visit(int node, const QuadBounds& area, std::vector<int>& result) const {
+		const Node& current = nodes[node];
+		for (const QuadItem& item : current.items) {
+			if (overlaps(item.bounds, area)) {
+				result.push_back(item.id);
+			}
+		}
+		if (current.children < 0) {
+			return;
+		}
+		for (int i = 0; i < 4; i++) {
+			// the root may hold items anywhere, children only hold items inside their loose square
+			if (overlaps(loose(current.children + i), area)) {
+				visit(current.children + i, area, result);
+			}
+		}
+	}
+};
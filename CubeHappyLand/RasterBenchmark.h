@@ -0,0 +1,165 @@
+#pragma once
+#include <glad/glad.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "Batch2D.h"
+#include "Rasterizer.h"
+#include "RasterView.h"
+
+// @dev Pixel throughput of the software rasterizer against drawing every pixel as a GL quad, run with
+//   CubeHappyLand --bench-raster
+// One frame is the same set of lines, circles and triangles, drawn
+//   - by the rasterizer alone
+//   - by the rasterizer, uploaded and drawn through RasterView
+//   - as one batched quad per pixel through Batch2D
+//   - as one quad per pixel with its own vertex buffer, the way the tools used to draw
+// GL timings end with glFinish. Without a shader program only the rasterizer is timed.
+class RasterBenchmark
+{
+public:
+	int size = 512;
+	int frames = 20;
+
+	RasterBenchmark() {}
+	~RasterBenchmark() {}
+
+	// @dev run every variant and print pixels per second
+	// @param shaderProgram Program of the 2D tools, 0 for the rasterizer only
+	int run(unsigned int shaderProgram) {
+		Rasterizer raster;
+		raster.resize(size, size);
+		srand(11);
+		for (int i = 0; i < 300; i++) {
+			int shape[6];
+			for (int k = 0; k < 6; k++) {
+				shape[k] = rand() % (size + size / 2) - size / 4;
+			}
+			shapes.push_back(std::vector<int>(shape, shape + 6));
+		}
+
+		double seconds = time([&]() {
+			draw(raster);
+		});
+		long long pixels = raster.written;
+		report("rasterizer", pixels, seconds);
+		if (shaderProgram == 0) {
+			return 0;
+		}
+
+		glViewport(0, 0, size, size);
+		glDisable(GL_DEPTH_TEST);
+		RasterView view;
+		seconds = time([&]() {
+			draw(raster);
+			view.present(raster, -1.0f, -1.0f, 1.0f, 1.0f);
+			glFinish();
+		});
+		report("rasterizer + upload", pixels, seconds);
+
+		// one quad for every covered pixel
+		std::vector<int> covered;
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++) {
+				if (raster.pixels[(size_t)y * size + x] != 0) {
+					covered.push_back(x);
+					covered.push_back(y);
+				}
+			}
+		}
+		long long quads = (long long)covered.size() / 2;
+		float color[3] = { 1.0f, 1.0f, 1.0f };
+		float half = 1.0f / size;
+		Batch2D* batch = Batch2D::getInstance();
+		seconds = time([&]() {
+			for (size_t i = 0; i < covered.size(); i += 2) {
+				float x = (covered[i] + 0.5f) * 2.0f / size - 1.0f, y = (covered[i + 1] + 0.5f) * 2.0f / size - 1.0f;
+				batch->rectangle(x - half, y - half, x + half, y + half, color, shaderProgram);
+			}
+			batch->endFrame();
+			glFinish();
+		});
+		report("GL quads, batched", quads, seconds);
+
+		// a vertex buffer per quad is slow, a slice of the quads is enough for the rate
+		long long slice = std::min(quads, 20000LL);
+		seconds = time([&]() {
+			for (long long i = 0; i < slice; i++) {
+				float x = (covered[i * 2] + 0.5f) * 2.0f / size - 1.0f, y = (covered[i * 2 + 1] + 0.5f) * 2.0f / size - 1.0f;
+				quad(x, y, half, color, shaderProgram);
+			}
+			glFinish();
+		}, 3);
+		report("GL quads, one buffer each", slice, seconds);
+		view.destroy();
+		glEnable(GL_DEPTH_TEST);
+		return 0;
+	}
+
+private:
+	std::vector<std::vector<int>> shapes;
+
+	// @dev one frame of the workload, a third each of lines, circles and triangles
+	void draw(Rasterizer& raster) {
+		raster.clear(0);
+		uint32_t color = Rasterizer::rgba(0.9f, 0.6f, 0.2f);
+		for (size_t i = 0; i < shapes.size(); i++) {
+			const std::vector<int>& s = shapes[i];
+			if (i % 3 == 0) {
+				raster.line(s[0], s[1], s[2], s[3], color);
+			}
+			else if (i % 3 == 1) {
+				raster.circle(s[0], s[1], abs(s[2]) / 4, color);
+			}
+			else {
+				// small triangles like the tools draw
+				raster.triangle((float)s[0], (float)s[1], s[0] + s[2] / 8.0f, s[1] + s[3] / 8.0f, s[0] + s[4] / 8.0f, (float)s[1] + 5.0f, color);
+			}
+		}
+	}
+
+	// @dev best average frame time in seconds
+	template<typename F>
+	double time(F frame, int runs = 0) {
+		runs = runs > 0 ? runs : frames;
+		double best = 1e30;
+		for (int round = 0; round < 3; round++) {
+			auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < runs; i++) {
+				frame();
+			}
+			best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / runs);
+		}
+		return best;
+	}
+
+	static void report(const char* name, long long pixels, double seconds) {
+		std::cout << name << ": " << pixels << " pixels in " << seconds * 1000.0 << " ms, " << pixels / seconds / 1e6 << " M pixels/s" << std::endl;
+	}
+
+	// @dev a quad with its own buffers, created and deleted for one draw
+	static void quad(float x, float y, float half, const float* color, unsigned int shaderProgram) {
+		float vertices[] = {
+			x - half, y - half, 0.0f, color[0], color[1], color[2],
+			x + half, y - half, 0.0f, color[0], color[1], color[2],
+			x - half, y + half, 0.0f, color[0], color[1], color[2],
+			x + half, y + half, 0.0f, color[0], color[1], color[2]
+		};
+		unsigned int VAO, VBO;
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glUseProgram(shaderProgram);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		glBindVertexArray(0);
+		glDeleteBuffers(1, &VBO);
+		glDeleteVertexArrays(1, &VAO);
+	}
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <glad/glad.h>
+#include "Rasterizer.h"
+#include "Shader.h"
+#include "ShaderCode.h"
+
+// @dev Shows a Rasterizer's framebuffer: it is uploaded into a texture once per frame and drawn as
+// one quad with nearest filtering, so every framebuffer pixel stays a sharp square on screen.
+class RasterView
+{
+public:
+	// bytes uploaded by the last present
+	size_t uploaded = 0;
+
+	RasterView() {}
+	~RasterView() {}
+
+	// @dev upload the framebuffer and draw it, the quad does not touch the depth buffer
+	// @param left, bottom, right, top Quad in normalized device coordinates
+	void present(const Rasterizer& raster, float left, float bottom, float right, float top) {
+		if (raster.width == 0 || raster.height == 0) {
+			return;
+		}
+		if (program == nullptr) {
+			program = new Shader(raster_vertex, raster_fragment);
+			glGenVertexArrays(1, &VAO);
+			glGenTextures(1, &texture);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		}
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		if (raster.width != width || raster.height != height) {
+			width = raster.width;
+			height = raster.height;
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, raster.pixels.data());
+		}
+		else {
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, raster.pixels.data());
+		}
+		uploaded = raster.pixels.size() * 4;
+
+		GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+		glDisable(GL_DEPTH_TEST);
+		program->use();
+		program->setInt("raster", 0);
+		program->setVec4("rect", left, bottom, right, top);
+		glBindVertexArray(VAO);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		glBindVertexArray(0);
+		if (depthTest) {
+			glEnable(GL_DEPTH_TEST);
+		}
+	}
+
+	// @dev release the texture and the program
+	void destroy() {
+		if (program != nullptr) {
+			glDeleteTextures(1, &texture);
+			glDeleteVertexArrays(1, &VAO);
+			glDeleteProgram(program->ID);
+			delete program;
+		}
+		program = nullptr;
+		width = 0;
+		height = 0;
+	}
+
+private:
+	Shader* program = nullptr;
+	// the quad's corners come from gl_VertexID, core profile still wants a vertex array bound
+	unsigned int VAO = 0;
+	unsigned int texture = 0;
+	int width = 0;
+	int height = 0;
+};
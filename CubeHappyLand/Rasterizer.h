@@ -0,0 +1,238 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RASTERIZER_SSE2
+#include <emmintrin.h>
+#endif
+
+// @dev Integer rasterizer drawing into a framebuffer in memory, it needs no OpenGL context so it can
+// run headless. Pixel (x, y) covers [x, x + 1) x [y, y + 1) with row 0 at the bottom, like the
+// texture the framebuffer is uploaded into by RasterView.
+//   - lines with the midpoint algorithm, clipped by jumping straight to the first visible step
+//   - circles with the midpoint algorithm and eightfold symmetry
+//   - triangles with edge functions in 28.4 fixed point and the top left fill rule, every row is
+//     solved for the span inside all three edges and filled four pixels at a time on SSE2
+// Everything is clipped to a rectangle, which defaults to the whole framebuffer.
+class Rasterizer
+{
+public:
+	int width = 0;
+	int height = 0;
+	// RGBA8 pixels row by row from the bottom
+	std::vector<uint32_t> pixels;
+	// pixels written since the last clear
+	long long written = 0;
+
+	Rasterizer() {}
+	~Rasterizer() {}
+
+	// @dev size the framebuffer and clear it to transparent black, the clip rectangle is reset and
+	// the storage is only reallocated if it grows
+	void resize(int newWidth, int newHeight) {
+		width = std::max(newWidth, 0);
+		height = std::max(newHeight, 0);
+		pixels.assign((size_t)width * height, 0);
+		written = 0;
+		resetClip();
+	}
+
+	// @dev fill the whole framebuffer
+	void clear(uint32_t color) {
+		std::fill(pixels.begin(), pixels.end(), color);
+		written = 0;
+	}
+
+	// @dev limit drawing to a rectangle, it is cut to the framebuffer
+	// @param x0 First column inside
+	// @param y0 First row inside
+	// @param x1 First column past the rectangle
+	// @param y1 First row past the rectangle
+	void setClip(int x0, int y0, int x1, int y1) {
+		clipX0 = std::max(x0, 0);
+		clipY0 = std::max(y0, 0);
+		clipX1 = std::min(x1, width);
+		clipY1 = std::min(y1, height);
+	}
+
+	void resetClip() {
+		setClip(0, 0, width, height);
+	}
+
+	// @dev pack a color, channels between 0 and 1
+	static uint32_t rgba(float r, float g, float b, float a = 1.0f) {
+		return channel(r) | channel(g) << 8 | channel(b) << 16 | channel(a) << 24;
+	}
+
+	void pixel(int x, int y, uint32_t color) {
+		if (x >= clipX0 && x < clipX1 && y >= clipY0 && y < clipY1) {
+			pixels[(size_t)y * width + x] = color;
+			written++;
+		}
+	}
+
+	// @dev line between the centers of two pixels, both ends included
+	void line(int x0, int y0, int x1, int y1, uint32_t color) {
+		if (clipX0 >= clipX1 || clipY0 >= clipY1) {
+			return;
+		}
+		int sx = x0 < x1 ? 1 : -1, sy = y0 < y1 ? 1 : -1;
+		long long dx = std::llabs((long long)x1 - x0), dy = std::llabs((long long)y1 - y0);
+		bool steep = dy > dx;
+		// steps go along the major axis, the minor axis moves at most one pixel per step
+		long long major = steep ? dy : dx, minor = steep ? dx : dy;
+		int start = steep ? y0 : x0, step = steep ? sy : sx;
+		int low = steep ? clipY0 : clipX0, high = (steep ? clipY1 : clipX1) - 1;
+		// steps whose major coordinate is inside the clip rectangle
+		long long first = 0, last = major;
+		if (step > 0) {
+			first = std::max(first, (long long)low - start);
+			last = std::min(last, (long long)high - start);
+		}
+		else {
+			first = std::max(first, (long long)start - high);
+			last = std::min(last, (long long)start - low);
+		}
+		if (first > last) {
+			return;
+		}
+		// minor offset and decision variable at the first step, as if every step before had been taken
+		long long offset = major == 0 ? 0 : (2 * minor * first + major - 1) / (2 * major);
+		long long decision = 2 * minor * (first + 1) - major - 2 * major * offset;
+		int minorStart = steep ? x0 : y0, minorStep = steep ? sx : sy;
+		int minorLow = steep ? clipX0 : clipY0, minorHigh = (steep ? clipX1 : clipY1) - 1;
+		for (long long i = first; i <= last; i++) {
+			long long m = minorStart + minorStep * offset;
+			if (m >= minorLow && m <= minorHigh) {
+				int a = (int)(start + step * i), b = (int)m;
+				pixels[steep ? (size_t)a * width + b : (size_t)b * width + a] = color;
+				written++;
+			}
+			if (decision > 0) {
+				offset++;
+				decision -= 2 * major;
+			}
+			decision += 2 * minor;
+		}
+	}
+
+	// @dev outline of a circle around the center of a pixel
+	void circle(int cx, int cy, int radius, uint32_t color) {
+		if (radius < 0 || cx + radius < clipX0 || cx - radius >= clipX1 || cy + radius < clipY0 || cy - radius >= clipY1) {
+			return;
+		}
+		int x = 0, y = radius, decision = 1 - radius;
+		while (x <= y) {
+			pixel(cx + x, cy + y, color);
+			pixel(cx - x, cy + y, color);
+			pixel(cx + x, cy - y, color);
+			pixel(cx - x, cy - y, color);
+			pixel(cx + y, cy + x, color);
+			pixel(cx - y, cy + x, color);
+			pixel(cx + y, cy - x, color);
+			pixel(cx - y, cy - x, color);
+			if (decision < 0) {
+				decision += 2 * x + 3;
+			}
+			else {
+				decision += 2 * (x - y) + 5;
+				y--;
+			}
+			x++;
+		}
+	}
+
+	// @dev filled triangle, covers the pixels whose centers are inside
+	// @param x0, y0... Corners in pixel units, pixel centers are at half integers
+	void triangle(float x0, float y0, float x1, float y1, float x2, float y2, uint32_t color) {
+		long long vx[3] = { fixed(x0), fixed(x1), fixed(x2) };
+		long long vy[3] = { fixed(y0), fixed(y1), fixed(y2) };
+		long long area = (vx[1] - vx[0]) * (vy[2] - vy[0]) - (vy[1] - vy[0]) * (vx[2] - vx[0]);
+		if (area == 0) {
+			return;
+		}
+		// counter clockwise, the inside is left of every edge
+		if (area < 0) {
+			std::swap(vx[1], vx[2]);
+			std::swap(vy[1], vy[2]);
+		}
+		// E(x, y) = a x + b y + c is positive left of the edge from v[i] to v[i + 1]
+		long long a[3], b[3], c[3];
+		for (int i = 0; i < 3; i++) {
+			int j = (i + 1) % 3;
+			a[i] = vy[i] - vy[j];
+			b[i] = vx[j] - vx[i];
+			c[i] = vx[i] * vy[j] - vy[i] * vx[j];
+			// pixels exactly on an edge belong to the triangle only for left and top edges
+			bool topLeft = a[i] > 0 || (a[i] == 0 && b[i] < 0);
+			c[i] += topLeft ? 0 : -1;
+		}
+		int minX = std::max(clipX0, (int)floorDiv(std::min({ vx[0], vx[1], vx[2] }), SUBPIXEL));
+		int maxX = std::min(clipX1 - 1, (int)floorDiv(std::max({ vx[0], vx[1], vx[2] }), SUBPIXEL));
+		int minY = std::max(clipY0, (int)floorDiv(std::min({ vy[0], vy[1], vy[2] }), SUBPIXEL));
+		int maxY = std::min(clipY1 - 1, (int)floorDiv(std::max({ vy[0], vy[1], vy[2] }), SUBPIXEL));
+		for (int y = minY; y <= maxY; y++) {
+			long long centerY = (long long)y * SUBPIXEL + SUBPIXEL / 2;
+			long long left = minX, right = maxX;
+			// a x + rest >= 0 at the centers, x * SUBPIXEL + SUBPIXEL / 2
+			for (int i = 0; i < 3 && left <= right; i++) {
+				long long rest = a[i] * (SUBPIXEL / 2) + b[i] * centerY + c[i];
+				long long slope = a[i] * SUBPIXEL;
+				if (slope > 0) {
+					left = std::max(left, -floorDiv(rest, slope));
+				}
+				else if (slope < 0) {
+					right = std::min(right, floorDiv(rest, -slope));
+				}
+				else if (rest < 0) {
+					right = left - 1;
+				}
+			}
+			if (left <= right) {
+				span(y, (int)left, (int)right, color);
+			}
+		}
+	}
+
+	// @dev fill a row from x0 to x1, both included and already clipped
+	void span(int y, int x0, int x1, uint32_t color) {
+		uint32_t* row = &pixels[(size_t)y * width];
+		int x = x0;
+#ifdef RASTERIZER_SSE2
+		__m128i fill = _mm_set1_epi32((int)color);
+		for (; x + 3 <= x1; x += 4) {
+			_mm_storeu_si128((__m128i*)(row + x), fill);
+		}
+#endif
+		for (; x <= x1; x++) {
+			row[x] = color;
+		}
+		written += x1 - x0 + 1;
+	}
+
+private:
+	// fixed point steps per pixel
+	static const long long SUBPIXEL = 16;
+	int clipX0 = 0;
+	int clipY0 = 0;
+	int clipX1 = 0;
+	int clipY1 = 0;
+
+	static uint32_t channel(float value) {
+		return (uint32_t)(std::max(0.0f, std::min(value, 1.0f)) * 255.0f + 0.5f);
+	}
+
+	static long long fixed(float value) {
+		return (long long)floor((double)value * SUBPIXEL + 0.5);
+	}
+
+	// @dev division rounding towards negative infinity
+	static long long floorDiv(long long numerator, long long denominator) {
+		long long quotient = numerator / denominator;
+		return (numerator % denominator != 0 && (numerator < 0) != (denominator < 0)) ? quotient - 1 : quotient;
+	}
+};
@@ -0,0 +1,296 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "imgui.h"
+#include "imgui_impl_opengl3.h"
+#include "GLCapture.h"
+#include "GLCounters.h"
+#include "GpuTimer.h"
+#include "Profiler.h"
+
+// @dev one frame handed from the main thread to the render thread
+typedef struct FramePacket {
+	// OpenGL work of the frame in submission order, run on the render thread
+	std::vector<std::function<void()>> commands;
+	// run on the main thread once the packet has been drawn, they pick up what the commands measured
+	std::vector<std::function<void()>> completions;
+	// copy of the frame's ImGui draw data, the lists are reused by later frames
+	ImDrawData drawData;
+	std::vector<ImDrawList*> drawLists;
+	// seconds the main thread spent building the packet, the render thread waited for it and drew it
+	double buildTime = 0.0;
+	double idleTime = 0.0;
+	double submitTime = 0.0;
+}FramePacket;
+
+// @dev Two stage frame pipeline. The main thread polls input, builds the UI and prepares the scene
+// into a packet: GL work is recorded as commands holding copies of what they draw, and ImGui's draw
+// data is copied when the packet ends. The render thread owns the context, plays the packets back
+// in order and swaps. With packets in flight the main thread builds frame n + 1 while frame n is
+// submitted, so a loaded frame takes about as long as the slower stage instead of both together.
+// Two packets make a double buffered pipeline, three let the main thread run one frame further
+// ahead. Everything commands touch besides their copies belongs to the render thread while it is
+// running; values it produces for the UI are handed back by completions. Without the thread
+// commands run right away and end draws and swaps itself.
+class RenderThread
+{
+public:
+	static const int MAX_PACKETS = 3;
+
+	// packets in flight, 2 or 3, a change restarts the thread with the next begin
+	int packets = 2;
+	// whether the main loop wants the render thread, applied by begin
+	bool threaded = true;
+
+	// statistics of the last packet that came back, in seconds
+	double buildTime = 0.0;
+	double submitTime = 0.0;
+	// time the render thread waited for that packet
+	double idleTime = 0.0;
+	// time the main thread waited for a free packet in the last begin
+	double waitTime = 0.0;
+
+	RenderThread() {}
+	~RenderThread() {
+		stop();
+		for (FramePacket& packet : ring) {
+			for (ImDrawList* list : packet.drawLists) {
+				IM_DELETE(list);
+			}
+		}
+	}
+
+	// @dev hand the window's context to a new render thread, it must be current on the calling thread
+	void start(GLFWwindow* window) {
+		if (running) {
+			return;
+		}
+		this->window = window;
+		packets = packets < 2 ? 2 : (packets > MAX_PACKETS ? MAX_PACKETS : packets);
+		ringSize = packets;
+		head = 0;
+		queued = 0;
+		inFlight = 0;
+		stopping = false;
+		running = true;
+		glfwMakeContextCurrent(NULL);
+		worker = std::thread([this]() { run(); });
+	}
+
+	// @dev let the render thread finish the queued packets, join it and make the context current here
+	void stop() {
+		if (!running) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		worker.join();
+		running = false;
+		glfwMakeContextCurrent(window);
+		// completions of the packets drawn last
+		for (int i = 0; i < ringSize; i++) {
+			finish(ring[i]);
+		}
+	}
+
+	// @dev start building a frame, waits until a packet is free and runs the completions of its
+	// previous frame, starts or stops the thread first if the settings changed
+	void begin() {
+		if (running && (!threaded || packets != ringSize)) {
+			stop();
+		}
+		if (threaded && !running && window != NULL) {
+			start(window);
+		}
+		Clock::time_point start = Clock::now();
+		if (running) {
+			std::unique_lock<std::mutex> lock(mutex);
+			returned.wait(lock, [this]() { return inFlight < ringSize; });
+			inFlight++;
+			current = &ring[head];
+		}
+		else {
+			current = &ring[0];
+		}
+		waitTime = seconds(start, Clock::now());
+		finish(*current);
+		buildStart = Clock::now();
+		inlineTime = 0.0;
+	}
+
+	// @dev record GL work, runs at once without the thread and counts as submitting then
+	void submit(std::function<void()> command) {
+		if (running) {
+			current->commands.push_back(std::move(command));
+		}
+		else {
+			Clock::time_point start = Clock::now();
+			command();
+			inlineTime += seconds(start, Clock::now());
+		}
+	}
+
+	// @dev run a function on the main thread once the current frame has been drawn
+	void complete(std::function<void()> completion) {
+		current->completions.push_back(std::move(completion));
+	}
+
+	// @dev finish the frame with ImGui's draw data and pass it on to be drawn and swapped
+	void end(ImDrawData* drawData) {
+		FramePacket& packet = *current;
+		packet.buildTime = seconds(buildStart, Clock::now()) - inlineTime;
+		copy(drawData, packet);
+		if (!running) {
+			Clock::time_point start = Clock::now();
+			draw(packet);
+			packet.submitTime = inlineTime + seconds(start, Clock::now());
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			head = (head + 1) % ringSize;
+			queued++;
+		}
+		wake.notify_one();
+	}
+
+	// @dev window with the pipeline settings and the time of both stages
+	void overlay() {
+		ImGui::Begin("Render thread");
+		ImGui::Checkbox("Threaded", &threaded);
+		bool triple = packets == 3;
+		if (ImGui::Checkbox("Triple buffered packets", &triple)) {
+			packets = triple ? 3 : 2;
+		}
+		ImGui::Text("build %.2f ms, submit %.2f ms", buildTime * 1000.0, submitTime * 1000.0);
+		ImGui::Text("main waited %.2f ms, render waited %.2f ms", waitTime * 1000.0, idleTime * 1000.0);
+		ImGui::End();
+	}
+
+private:
+	typedef std::chrono::steady_clock Clock;
+	GLFWwindow* window = NULL;
+	std::thread worker;
+	bool running = false;
+	FramePacket ring[MAX_PACKETS];
+	// packets in flight while the thread runs
+	int ringSize = 2;
+	FramePacket* current = &ring[0];
+	Clock::time_point buildStart;
+	// seconds commands ran inline in the frame being built
+	double inlineTime = 0.0;
+	std::mutex mutex;
+	// signals queued packets and shutdown to the render thread
+	std::condition_variable wake;
+	// signals drawn packets to the main thread
+	std::condition_variable returned;
+	// next packet the main thread fills
+	int head = 0;
+	// packets waiting for the render thread
+	int queued = 0;
+	// packets being built, queued or drawn
+	int inFlight = 0;
+	bool stopping = false;
+
+	static double seconds(Clock::time_point from, Clock::time_point to) {
+		return std::chrono::duration<double>(to - from).count();
+	}
+
+	// @dev render thread loop, packets are drawn in the order they were ended
+	void run() {
+		PROFILE_THREAD("Render");
+		glfwMakeContextCurrent(window);
+		int tail = 0;
+		for (;;) {
+			Clock::time_point waitStart = Clock::now();
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this]() { return stopping || queued > 0; });
+				if (queued == 0) {
+					break;
+				}
+			}
+			FramePacket& packet = ring[tail];
+			Clock::time_point start = Clock::now();
+			packet.idleTime = seconds(waitStart, start);
+			draw(packet);
+			packet.submitTime = seconds(start, Clock::now());
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				queued--;
+				inFlight--;
+			}
+			returned.notify_one();
+			tail = (tail + 1) % ringSize;
+		}
+		glfwMakeContextCurrent(NULL);
+	}
+
+	// @dev run the commands, draw the UI and swap, the GPU passes of the commands and the UI are timed
+	void draw(FramePacket& packet) {
+		PROFILE_ZONE("Render packet");
+		GpuTimer* gpuTimer = GpuTimer::getInstance();
+		GLCapture::getInstance()->beginFrame();
+		gpuTimer->beginFrame();
+		for (std::function<void()>& command : packet.commands) {
+			command();
+		}
+		packet.commands.clear();
+		if (packet.drawData.Valid) {
+			PROFILE_ZONE("ImGui_ImplOpenGL3_RenderDrawData");
+			int scope = gpuTimer->begin("ImGui");
+			ImGui_ImplOpenGL3_RenderDrawData(&packet.drawData);
+			gpuTimer->end(scope);
+		}
+		gpuTimer->endFrame();
+		GLCounters::getInstance()->take();
+		GLCapture::getInstance()->endFrame();
+		PROFILE_ZONE("Swap buffers");
+		glfwSwapBuffers(window);
+	}
+
+	// @dev hand the statistics of a drawn packet to the main thread and run its completions
+	void finish(FramePacket& packet) {
+		if (packet.completions.empty() && !packet.drawData.Valid) {
+			return;
+		}
+		buildTime = packet.buildTime;
+		idleTime = packet.idleTime;
+		submitTime = packet.submitTime;
+		for (std::function<void()>& completion : packet.completions) {
+			completion();
+		}
+		packet.completions.clear();
+		packet.drawData.Valid = false;
+	}
+
+	// @dev copy the draw lists, the next NewFrame overwrites ImGui's own
+	static void copy(ImDrawData* source, FramePacket& packet) {
+		packet.drawData.Clear();
+		if (source == NULL || !source->Valid) {
+			return;
+		}
+		packet.drawData = *source;
+		for (int i = 0; i < source->CmdListsCount; i++) {
+			const ImDrawList* list = source->CmdLists[i];
+			if (i == (int)packet.drawLists.size()) {
+				packet.drawLists.push_back(list->CloneOutput());
+				continue;
+			}
+			packet.drawLists[i]->CmdBuffer = list->CmdBuffer;
+			packet.drawLists[i]->IdxBuffer = list->IdxBuffer;
+			packet.drawLists[i]->VtxBuffer = list->VtxBuffer;
+			packet.drawLists[i]->Flags = list->Flags;
+		}
+		packet.drawData.CmdLists = packet.drawLists.data();
+	}
+};
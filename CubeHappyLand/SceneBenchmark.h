@@ -0,0 +1,429 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "GLCapture.h"
+#include "GLCounters.h"
+#include "GpuTimer.h"
+#include "Profiler.h"
+#include "PointShadowAtlas.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+// @dev the scene a benchmark run generates and how long it measures it
+typedef struct SceneBenchmarkOptions {
+	int cubes = 100;
+	// point lights, the first is the scene's own point light
+	int lights = 1;
+	// blinn or phong
+	std::string shading = "blinn";
+	// off, sun or all
+	std::string shadows = "all";
+	// frames drawn before the measured ones, they are not recorded
+	int warmup = 30;
+	int frames = 200;
+	int width = 1280;
+	int height = 720;
+	// draw without a window through HeadlessRenderer
+	bool headless = false;
+	std::string output = "benchmark.json";
+	// Chrome trace of the CPU zones and the GPU passes of the measured frames, none if empty
+	std::string trace;
+	// GL calls of the measured frames for GLReplay, none if empty
+	std::string capture;
+	// threaded or inline to draw through RenderThread like the main loop, empty to draw directly
+	std::string pipeline;
+}SceneBenchmarkOptions;
+
+// @dev what one measured frame cost
+typedef struct BenchmarkFrame {
+	// milliseconds the main thread spent building and recording the frame
+	double cpuTime = 0.0;
+	// milliseconds until the GPU finished the frame, through the pipeline the wall clock time between
+	// the starts of two frames
+	double frameTime = 0.0;
+	// milliseconds the render thread spent drawing the frame, through the pipeline only
+	double submitTime = 0.0;
+	// milliseconds on the GPU of every pass, indexed like GpuTimer::passes
+	std::vector<double> passTimes;
+	GLCounts counts;
+}BenchmarkFrame;
+
+// @dev Reproducible measurement of the 3D scene, run with
+//   CubeHappyLand --bench-scene [--cubes n] [--lights 0-4] [--shading blinn|phong] [--shadows off|sun|all]
+//                               [--warmup n] [--frames n] [--size WxH] [--headless] [--output file.json]
+//                               [--trace file.json] [--capture file.glcap] [--pipeline threaded|inline]
+// The cubes stand in a grid on the floor, the lights circle above them and the camera flies once
+// around the scene during the measured frames, so two runs with the same options draw the same
+// frames. Every frame ends with glFinish. The results are written as JSON: percentiles of the CPU
+// and frame times, the GPU time of every pass GpuTimer measured, GL calls counted by GLCounters, the
+// GL objects still alive once the scene is released and the peak resident memory of the process.
+// report is called after the release, with the context still current. The GPU passes and the
+// profiler's CPU zones can also be written as a Chrome trace, and the GL calls of the measured
+// frames captured for GLReplay.
+// With --pipeline the frames are built into RenderThread packets like the main loop's, without a UI,
+// and drawn on the render thread or inline. Frame times are then the wall clock between the starts
+// of consecutive frames, set against the build and submit times of the packets, so both modes can be
+// compared on the same scene. GPU passes and GL calls are not recorded in this mode.
+class SceneBenchmark
+{
+public:
+	SceneBenchmarkOptions options;
+	std::vector<BenchmarkFrame> frames;
+
+	SceneBenchmark() {}
+	~SceneBenchmark() {}
+
+	// @dev read the options following --bench-scene
+	// @param first Index of the first option in argv
+	// @return false after printing the usage if an option is unknown or its value malformed
+	static bool parse(int argc, char** argv, int first, SceneBenchmarkOptions& options) {
+		for (int i = first; i < argc; i++) {
+			const char* name = argv[i];
+			if (strcmp(name, "--headless") == 0) {
+				options.headless = true;
+				continue;
+			}
+			const char* value = i + 1 < argc ? argv[++i] : NULL;
+			bool valid = true;
+			if (value == NULL) {
+				valid = false;
+			}
+			else if (strcmp(name, "--cubes") == 0) {
+				options.cubes = atoi(value);
+				valid = options.cubes >= 0;
+			}
+			else if (strcmp(name, "--lights") == 0) {
+				options.lights = atoi(value);
+				valid = options.lights >= 0 && options.lights <= PointShadowAtlas::MAX_LIGHTS;
+			}
+			else if (strcmp(name, "--shading") == 0) {
+				options.shading = value;
+				valid = options.shading == "blinn" || options.shading == "phong";
+			}
+			else if (strcmp(name, "--shadows") == 0) {
+				options.shadows = value;
+				valid = options.shadows == "off" || options.shadows == "sun" || options.shadows == "all";
+			}
+			else if (strcmp(name, "--warmup") == 0) {
+				options.warmup = atoi(value);
+				valid = options.warmup >= 0;
+			}
+			else if (strcmp(name, "--frames") == 0) {
+				options.frames = atoi(value);
+				valid = options.frames > 0;
+			}
+			else if (strcmp(name, "--size") == 0) {
+				valid = sscanf(value, "%dx%d", &options.width, &options.height) == 2 && options.width > 0 && options.height > 0 && options.width <= 16384 && options.height <= 16384;
+			}
+			else if (strcmp(name, "--output") == 0) {
+				options.output = value;
+			}
+			else if (strcmp(name, "--trace") == 0) {
+#ifdef PROFILER_ENABLED
+				options.trace = value;
+#else
+				std::cout << "Traces need the profiler, this build defines PROFILER_DISABLED" << std::endl;
+				valid = false;
+#endif
+			}
+			else if (strcmp(name, "--capture") == 0) {
+				options.capture = value;
+			}
+			else if (strcmp(name, "--pipeline") == 0) {
+				options.pipeline = value;
+				valid = options.pipeline == "threaded" || options.pipeline == "inline";
+			}
+			else {
+				valid = false;
+			}
+			if (!valid) {
+				std::cout << "Invalid benchmark option " << name << (value != NULL ? " " : "") << (value != NULL ? value : "") << std::endl;
+				std::cout << "usage: CubeHappyLand --bench-scene [--cubes n] [--lights 0-" << PointShadowAtlas::MAX_LIGHTS << "] [--shading blinn|phong] [--shadows off|sun|all]" << std::endl;
+				std::cout << "                       [--warmup n] [--frames n] [--size WxH] [--headless] [--output file.json]" << std::endl;
+				std::cout << "                       [--trace file.json] [--capture file.glcap] [--pipeline threaded|inline]" << std::endl;
+				return false;
+			}
+		}
+		// the render thread needs a window to swap and records GL calls on its own
+		if (!options.pipeline.empty() && (options.headless || !options.trace.empty() || !options.capture.empty())) {
+			std::cout << "--pipeline needs a window and cannot be combined with --trace or --capture" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// @return Position of a cube in a square grid filling the floor
+	glm::vec3 cubePosition(int i) const {
+		int side = gridSide();
+		float spacing = cubeSpacing();
+		float offset = (side - 1) * 0.5f;
+		return glm::vec3((i % side - offset) * spacing, cubeScale() * 0.5f, (i / side - offset) * spacing);
+	}
+
+	// @return Edge length of the cubes, they get smaller as the grid gets denser
+	float cubeScale() const {
+		return cubeSpacing() * 0.6f;
+	}
+
+	// @return Position of a point light, the lights are spread over a circle above the cubes
+	glm::vec3 lightPosition(int i) const {
+		float angle = i * 2.0f * 3.14159265f / std::max(options.lights, 1);
+		return glm::vec3(3.0f * cos(angle), 2.5f, 3.0f * sin(angle));
+	}
+
+	// @return Eye of a measured frame, one turn around the scene rising and falling twice, looking at the origin
+	glm::vec3 eye(int frame) const {
+		float angle = frame * 2.0f * 3.14159265f / options.frames;
+		return glm::vec3(9.0f * cos(angle), 4.0f + 1.5f * sin(2.0f * angle), 9.0f * sin(angle));
+	}
+
+	// @dev start timing GPU passes, GL calls are counted once GLCounters is installed
+	void initialize() {
+		GpuTimer::getInstance()->initialize();
+	}
+
+	// @dev start timing a frame, calls made before are not counted in it
+	void beginFrame() {
+		GLCounters::getInstance()->take();
+		GLCapture::getInstance()->beginFrame();
+		start = std::chrono::steady_clock::now();
+		GpuTimer::getInstance()->beginFrame();
+		frameScope = GpuTimer::getInstance()->begin("Frame");
+	}
+
+	// @dev the main thread has recorded every command of the frame
+	void endRecording() {
+		recorded = std::chrono::steady_clock::now();
+	}
+
+	// @dev wait for the GPU and keep the frame's costs if it is measured
+	void endFrame(bool measured) {
+		GpuTimer* gpuTimer = GpuTimer::getInstance();
+		gpuTimer->end(frameScope);
+		gpuTimer->endFrame();
+		glFinish();
+		std::chrono::steady_clock::time_point finished = std::chrono::steady_clock::now();
+		// the frame is finished, collecting it does not wait
+		gpuTimer->collect();
+		BenchmarkFrame frame;
+		frame.counts = GLCounters::getInstance()->take();
+		GLCapture::getInstance()->endFrame();
+		if (!measured) {
+			return;
+		}
+		frame.cpuTime = std::chrono::duration<double, std::milli>(recorded - start).count();
+		frame.frameTime = std::chrono::duration<double, std::milli>(finished - start).count();
+		GpuFrame gpuFrame = gpuTimer->latest();
+		for (const GpuScope& scope : gpuFrame.scopes) {
+			if (scope.pass >= (int)frame.passTimes.size()) {
+				frame.passTimes.resize(scope.pass + 1, 0.0);
+			}
+			frame.passTimes[scope.pass] += scope.duration;
+		}
+		frames.push_back(frame);
+		if (!options.trace.empty()) {
+			traced.push_back(gpuFrame);
+		}
+	}
+
+	// @dev a frame of a pipeline run starts, the previous one is kept if it was measured
+	// @param buildTime, submitTime Seconds of the packet that came back last, see RenderThread
+	void beginPacket(bool measured, double buildTime, double submitTime) {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (packetMeasured) {
+			BenchmarkFrame frame;
+			frame.cpuTime = buildTime * 1000.0;
+			frame.submitTime = submitTime * 1000.0;
+			frame.frameTime = std::chrono::duration<double, std::milli>(now - start).count();
+			frames.push_back(frame);
+		}
+		start = now;
+		packetMeasured = measured;
+	}
+
+	// @dev write the results and print a summary
+	// @return 0, or -1 if the file could not be written
+	int report() {
+		std::vector<std::string> passes = GpuTimer::getInstance()->passes();
+		std::vector<double> cpu, frame, submit, draws, uniforms, bufferBytes, textureBytes;
+		std::vector<double> calls(GL_ENTRY_POINTS, 0.0);
+		std::vector<std::vector<double>> passTimes(passes.size());
+		for (const BenchmarkFrame& f : frames) {
+			cpu.push_back(f.cpuTime);
+			frame.push_back(f.frameTime);
+			submit.push_back(f.submitTime);
+			for (int i = 0; i < (int)passes.size(); i++) {
+				passTimes[i].push_back(i < (int)f.passTimes.size() ? f.passTimes[i] : 0.0);
+			}
+			draws.push_back((double)f.counts.drawCalls);
+			uniforms.push_back((double)f.counts.uniformUploads);
+			bufferBytes.push_back((double)f.counts.bufferBytes);
+			textureBytes.push_back((double)f.counts.textureBytes);
+			for (int entry = 0; entry < GL_ENTRY_POINTS; entry++) {
+				calls[entry] += (double)f.counts.calls[entry] / frames.size();
+			}
+		}
+		std::vector<double> gpuFrame;
+		for (int i = 0; i < (int)passes.size(); i++) {
+			if (passes[i] == "Frame") {
+				gpuFrame = passTimes[i];
+			}
+		}
+		long long peakBytes = peakResidentBytes();
+		GLCounters* counters = GLCounters::getInstance();
+		counters->reportLeaks();
+		std::cout << frames.size() << " frames of " << options.cubes << " cubes and " << options.lights << " lights at " << options.width << "x" << options.height
+			<< ": cpu p50 " << percentile(cpu, 50.0) << " ms, frame p50 " << percentile(frame, 50.0) << " p99 " << percentile(frame, 99.0)
+			<< " ms, gpu p50 " << percentile(gpuFrame, 50.0) << " ms, " << mean(draws) << " draws per frame" << std::endl;
+		if (!options.pipeline.empty()) {
+			std::cout << options.pipeline << " pipeline: build p50 " << percentile(cpu, 50.0) << " ms, submit p50 " << percentile(submit, 50.0)
+				<< " ms, frame p50 " << percentile(frame, 50.0) << " ms" << std::endl;
+		}
+
+		FILE* out = fopen(options.output.c_str(), "w");
+		if (out == NULL) {
+			std::cout << "Failed to write " << options.output << std::endl;
+			return -1;
+		}
+		fprintf(out, "{\n");
+		fprintf(out, "  \"renderer\": \"%s\",\n", escape((const char*)glGetString(GL_RENDERER)).c_str());
+		fprintf(out, "  \"version\": \"%s\",\n", escape((const char*)glGetString(GL_VERSION)).c_str());
+		fprintf(out, "  \"scene\": {\"cubes\": %d, \"lights\": %d, \"shading\": \"%s\", \"shadows\": \"%s\", \"width\": %d, \"height\": %d, \"headless\": %s, \"pipeline\": \"%s\"},\n",
+			options.cubes, options.lights, options.shading.c_str(), options.shadows.c_str(), options.width, options.height, options.headless ? "true" : "false",
+			options.pipeline.c_str());
+		fprintf(out, "  \"warmupFrames\": %d,\n", options.warmup);
+		fprintf(out, "  \"frames\": %d,\n", (int)frames.size());
+		writeStats(out, "cpuFrameTimeMs", cpu);
+		writeStats(out, "frameTimeMs", frame);
+		if (!options.pipeline.empty()) {
+			writeStats(out, "submitTimeMs", submit);
+		}
+		fprintf(out, "  \"gpuPassTimeMs\": {\n");
+		for (int i = 0; i < (int)passes.size(); i++) {
+			writeStats(out, escape(passes[i].c_str()).c_str(), passTimes[i], "    ", i + 1 == (int)passes.size());
+		}
+		fprintf(out, "  },\n");
+		writeStats(out, "drawCalls", draws);
+		writeStats(out, "uniformUploads", uniforms);
+		writeStats(out, "bufferBytesUploaded", bufferBytes);
+		writeStats(out, "textureBytesUploaded", textureBytes);
+		// mean calls per frame of every entry point called
+		fprintf(out, "  \"glCallsPerFrame\": {");
+		const char* separator = "";
+		for (int entry = 0; entry < GL_ENTRY_POINTS; entry++) {
+			if (calls[entry] > 0.0) {
+				fprintf(out, "%s\n    \"%s\": %.3f", separator, GLCounters::entryName(entry), calls[entry]);
+				separator = ",";
+			}
+		}
+		fprintf(out, "\n  },\n");
+		fprintf(out, "  \"leakedObjects\": {");
+		for (int type = 0; type < GL_OBJECT_TYPES; type++) {
+			fprintf(out, "%s\"%s\": %lld", type > 0 ? ", " : "", GLCounters::objectName(type), counters->liveObjects(type));
+		}
+		fprintf(out, "},\n");
+		fprintf(out, "  \"peakRssBytes\": %lld\n", peakBytes);
+		fprintf(out, "}\n");
+		fclose(out);
+#ifdef PROFILER_ENABLED
+		if (!options.trace.empty() && !Profiler::getInstance()->writeTrace(options.trace, traced, passes)) {
+			return -1;
+		}
+#endif
+		return 0;
+	}
+
+	// @return Value below which the given percent of the samples lie, nearest rank
+	static double percentile(std::vector<double> values, double percent) {
+		if (values.empty()) {
+			return 0.0;
+		}
+		std::sort(values.begin(), values.end());
+		int rank = (int)ceil(percent / 100.0 * values.size()) - 1;
+		return values[std::min(std::max(rank, 0), (int)values.size() - 1)];
+	}
+
+	static double mean(const std::vector<double>& values) {
+		double sum = 0.0;
+		for (double value : values) {
+			sum += value;
+		}
+		return values.empty() ? 0.0 : sum / values.size();
+	}
+
+	// @return Most memory the process has had resident so far in bytes
+	static long long peakResidentBytes() {
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+			return (long long)counters.PeakWorkingSetSize;
+		}
+		return 0;
+#else
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+		return (long long)usage.ru_maxrss;
+#else
+		// kilobytes on Linux
+		return (long long)usage.ru_maxrss * 1024;
+#endif
+#endif
+	}
+
+	// @dev one entry of mean, percentiles and maximum
+	static void writeStats(FILE* out, const char* name, const std::vector<double>& values, const char* indent = "  ", bool last = false) {
+		fprintf(out, "%s\"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}%s\n", indent, name,
+			mean(values), percentile(values, 50.0), percentile(values, 90.0), percentile(values, 95.0), percentile(values, 99.0), percentile(values, 100.0), last ? "" : ",");
+	}
+
+	static std::string escape(const char* text) {
+		std::string escaped;
+		for (const char* c = text != NULL ? text : ""; *c != '\0'; c++) {
+			if (*c == '"' || *c == '\\') {
+				escaped += '\\';
+			}
+			escaped += *c;
+		}
+		return escaped;
+	}
+
+private:
+	int frameScope = -1;
+	// GPU passes of the measured frames for the trace
+	std::vector<GpuFrame> traced;
+	std::chrono::steady_clock::time_point start;
+	std::chrono::steady_clock::time_point recorded;
+	// whether the pipeline frame started last is measured
+	bool packetMeasured = false;
+
+	int gridSide() const {
+		return std::max((int)ceil(sqrt((double)options.cubes)), 1);
+	}
+
+	// the grid stays on the 10 x 10 floor
+	float cubeSpacing() const {
+		return std::min(1.5f, 9.0f / gridSide());
+	}
+};
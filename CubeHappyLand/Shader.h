@@ -8,6 +8,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include "Profiler.h"
 
 class Shader
 {
@@ -19,6 +20,7 @@ public:
 	Shader(){}
 	Shader(const char* vShaderCode, const char* fShaderCode, const char* gShaderCode = nullptr)
 	{
+		PROFILE_ZONE("Shader compile");
 		// compile shader
 		unsigned int vertex, fragment;
 		// vertex shader
@@ -56,6 +58,7 @@ public:
 	}
 	// initialize with given code
 	void initialize(const char* vShaderCode, const char* fShaderCode, const char* gShaderCode = nullptr) {
+		PROFILE_ZONE("Shader compile");
 		// compile shader
 		unsigned int vertex, fragment;
 		// vertex shader
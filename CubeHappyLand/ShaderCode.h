@@ -1,5 +1,15 @@
 #pragma once
 
+// per object matrices computed on the CPU, see ObjectBuffer.h
+// the normal matrix is stored as a mat4 to keep the std140 layout simple
+// materialLayers holds the layers of the object's diffuse (x) and specular (y) map in the material array
+#define OBJECT_BLOCK "layout(std140) uniform Object {\n" \
+"	mat4 model;\n" \
+"	mat4 mvp;\n" \
+"	mat4 normalMatrix;\n" \
+"	vec4 materialLayers;\n" \
+"};\n"
+
 // color and position
 const char* vertexShaderSource = "#version 330 core\n"
 "layout(location = 0) in vec3 aPos;\n"
@@ -52,9 +62,8 @@ const char* gouraud_vertex_shader = "#version 330 core\n"
 "out vec3 Ambient;\n"
 "out vec3 Diffuse;\n"
 "out vec3 Specular;\n"
-"uniform mat4 model;\n"
-"uniform mat4 view;\n"
-"uniform mat4 projection;\n"
+OBJECT_BLOCK
+"uniform mat4 lightSpaceMatrix;\n"
 "uniform vec3 viewPos;\n"
 "struct Light {\n"
 "	vec3 color;\n"
@@ -67,6 +76,8 @@ const char* gouraud_vertex_shader = "#version 330 core\n"
 "	float quadratic;\n"
 "};\n"
 "struct Material {\n"
+"	sampler2D diffuse;\n"
+"	sampler2D specular;\n"
 "	float shininess;\n"
 "};\n"
 "uniform float ambientFactor;\n"
@@ -76,9 +87,10 @@ const char* gouraud_vertex_shader = "#version 330 core\n"
 "uniform Material material;\n"
 "void main() {\n"
 "	vs_out.FragPos = vec3(model * vec4(aPos, 1.0f));\n"
-"	gl_Position = projection * view * vec4(vs_out.FragPos, 1.0f);\n"
-"	vec3 Normal = mat3(transpose(inverse(model))) * aNormal;\n"
+"	gl_Position = mvp * vec4(aPos, 1.0f);\n"
+"	vec3 Normal = mat3(normalMatrix) * aNormal;\n"
 "	vs_out.TexCoords = aTexCoords;\n"
+"	vs_out.FragPosLightSpace = lightSpaceMatrix * vec4(vs_out.FragPos, 1.0);\n"
 // calculate ambient with diffuse texture (surely you can also use an ambient texture)
 "	Ambient = light.ambient * light.color;\n"
 // calculate normal and light direction
@@ -113,6 +125,7 @@ const char* gouraud_fragment_shader = "#version 330 core\n"
 "struct Material {\n"
 "	sampler2D diffuse;\n"
 "	sampler2D specular;\n"
+"	float shininess;\n"
 "};\n"
 "uniform sampler2D shadowMap;\n"
 "uniform Material material;\n"
@@ -150,15 +163,13 @@ const char* phong_vertex_shader = "#version 330 core\n"
 "	vec2 TexCoords;\n"
 "	vec4 FragPosLightSpace;\n"
 "}vs_out;\n"
-"uniform mat4 model;\n"
-"uniform mat4 view;\n"
-"uniform mat4 projection;\n"
+OBJECT_BLOCK
 "uniform mat4 lightSpaceMatrix;\n"
 "void main()\n"
 "{\n"
 "	vs_out.FragPos = vec3(model * vec4(aPos, 1.0f));\n"
-"	gl_Position = projection * view * vec4(vs_out.FragPos, 1.0f);\n"
-"	vs_out.Normal = mat3(transpose(inverse(model))) * aNormal;\n"
+"	gl_Position = mvp * vec4(aPos, 1.0f);\n"
+"	vs_out.Normal = mat3(normalMatrix) * aNormal;\n"
 "	vs_out.TexCoords = aTexCoords;\n"
 // transformation from world space into light space
 "	vs_out.FragPosLightSpace = lightSpaceMatrix * vec4(vs_out.FragPos, 1.0);\n"
@@ -244,20 +255,22 @@ const char* blinn_vertex_shader = "#version 330 core\n"
 "	vec3 Normal;\n"
 "	vec2 TexCoords;\n"
 "	vec4 FragPosLightSpace;\n"
+"	flat vec2 Layers;\n"
 "}vs_out;\n"
 // 
-"uniform mat4 model;\n"
-"uniform mat4 view;\n"
-"uniform mat4 projection;\n"
+OBJECT_BLOCK
 "uniform mat4 lightSpaceMatrix;\n"
+// must match the depth prepass exactly so GL_EQUAL passes
+"invariant gl_Position;\n"
 "void main()\n"
 "{\n"
 "	vs_out.FragPos = vec3(model * vec4(aPos, 1.0f));\n"
-"	gl_Position = projection * view * model * vec4(aPos, 1.0f);\n"
-"	vs_out.Normal = mat3(transpose(inverse(model))) * aNormal;\n"
+"	gl_Position = mvp * vec4(aPos, 1.0f);\n"
+"	vs_out.Normal = mat3(normalMatrix) * aNormal;\n"
 "	vs_out.TexCoords = aTexCoords;\n"
 // transformation from world space into light space
 "	vs_out.FragPosLightSpace = lightSpaceMatrix * vec4(vs_out.FragPos, 1.0);\n"
+"	vs_out.Layers = materialLayers.xy;\n"
 "}\n";
 // with attenuation and Gamma correction
 const char* blinn_fragment_shader = "#version 330 core\n"
@@ -266,6 +279,7 @@ const char* blinn_fragment_shader = "#version 330 core\n"
 "	vec3 Normal;\n"
 "	vec2 TexCoords;\n"
 "	vec4 FragPosLightSpace;\n"
+"	flat vec2 Layers;\n"
 "}fs_in;\n"
 "out vec4 FragColor;\n"
 "uniform vec3 viewPos;\n"
@@ -279,14 +293,63 @@ const char* blinn_fragment_shader = "#version 330 core\n"
 "	float linear;\n"
 "	float quadratic;\n"
 "};\n"
+// every material map is a layer of one array, the object picks its layers, maps only used as
+// specular maps are in a second array whose layers follow the first's
 "struct Material {\n"
-"	sampler2D diffuse;\n"
-"	sampler2D specular;\n"
+"	sampler2DArray maps;\n"
+"	sampler2DArray specularMaps;\n"
+"	float colorLayers;\n"
 "	float shininess;\n"
 "};\n"
 "uniform sampler2D shadowMap;\n"
 "uniform Light light;\n"
 "uniform Material material;\n"
+"struct PointLight {\n"
+"	vec3 color;\n"
+"	vec3 position;\n"
+"	int shadowLayer;\n"
+"};\n"
+// keep the size in sync with PointShadowAtlas::MAX_LIGHTS
+"uniform PointLight pointLights[4];\n"
+"uniform int pointLightCount;\n"
+"uniform sampler2DArrayShadow pointShadowMap;\n"
+"uniform float pointShadowNear;\n"
+"uniform float pointShadowFar;\n"
+// 0 for Blinn-Phong, 1 for Phong
+"uniform int shadingModel;\n"
+// specular term of a light, around the halfway vector or around the reflected light direction
+"float SpecularStrength(vec3 normal, vec3 lightDirection, vec3 viewDirection) {\n"
+"	if (shadingModel == 1)\n"
+"		return pow(max(dot(viewDirection, reflect(-lightDirection, normal)), 0.0f), material.shininess);\n"
+"	return pow(max(dot(normal, normalize(lightDirection + viewDirection)), 0.0f), material.shininess);\n"
+"}\n"
+// look up the omnidirectional shadow of a point light, faces follow the cube map convention
+"float PointShadowCalculation(PointLight pointLight) {\n"
+"	if (pointLight.shadowLayer < 0)\n"
+"		return 0.0;\n"
+"	vec3 d = fs_in.FragPos - pointLight.position;\n"
+"	vec3 a = abs(d);\n"
+"	float ma;\n"
+"	int face;\n"
+"	vec2 sc;\n"
+"	if (a.x >= a.y && a.x >= a.z) {\n"
+"		ma = a.x; face = d.x > 0.0 ? 0 : 1; sc = vec2(d.x > 0.0 ? -d.z : d.z, -d.y);\n"
+"	}\n"
+"	else if (a.y >= a.z) {\n"
+"		ma = a.y; face = d.y > 0.0 ? 2 : 3; sc = vec2(d.x, d.y > 0.0 ? d.z : -d.z);\n"
+"	}\n"
+"	else {\n"
+"		ma = a.z; face = d.z > 0.0 ? 4 : 5; sc = vec2(d.z > 0.0 ? d.x : -d.x, -d.y);\n"
+"	}\n"
+"	vec2 uv = sc / ma * 0.5 + 0.5;\n"
+// depth written by the face's perspective projection at a view distance of ma
+"	float n = pointShadowNear;\n"
+"	float f = pointShadowFar;\n"
+"	float currentDepth = ((f + n) / (f - n) - 2.0 * f * n / ((f - n) * ma)) * 0.5 + 0.5;\n"
+"	if (currentDepth > 1.0)\n"
+"		return 0.0;\n"
+"	return 1.0 - texture(pointShadowMap, vec4(uv, float(pointLight.shadowLayer + face), currentDepth));\n"
+"}\n"
 // calculate shadow
 "float ShadowCalculation(vec4 fragPosLightSpace) {\n"
 "	vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;\n"
@@ -295,9 +358,7 @@ const char* blinn_fragment_shader = "#version 330 core\n"
 "	float closetDepth = texture(shadowMap, projCoords.xy).r;\n"
 // current depth
 "	float currentDepth = projCoords.z;\n"
-"	vec3 normal = normalize(fs_in.Normal);\n"
-"	vec3 lightDir = normalize(light.position - fs_in.FragPos);\n"
-"	float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);\n"
+// acne is handled by the slope scaled polygon offset of the depth pass
 // set shadow factor to be 
 "	float shadow = 0.0;\n"
 "	vec2 texelSize = 1.0 / textureSize(shadowMap, 0);\n"
@@ -306,7 +367,7 @@ const char* blinn_fragment_shader = "#version 330 core\n"
 "		for (int y = -1; y <= 1; ++y)\n"
 "		{\n"
 "			float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r;\n"
-"			shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;\n"
+"			shadow += currentDepth > pcfDepth ? 1.0 : 0.0;\n"
 "		}\n"
 "	}\n"
 "	shadow /= 9.0;\n"
@@ -317,23 +378,38 @@ const char* blinn_fragment_shader = "#version 330 core\n"
 "}\n"
 "void main()\n"
 "{\n"
+"	vec3 diffuseColor = texture(material.maps, vec3(fs_in.TexCoords, fs_in.Layers.x)).rgb;\n"
+"	vec3 specularColor;\n"
+"	if (fs_in.Layers.y < material.colorLayers)\n"
+"		specularColor = texture(material.maps, vec3(fs_in.TexCoords, fs_in.Layers.y)).rgb;\n"
+"	else\n"
+"		specularColor = texture(material.specularMaps, vec3(fs_in.TexCoords, fs_in.Layers.y - material.colorLayers)).rgb;\n"
 // calculate ambient with diffuse texture (surely you can also use an ambient texture)
-"	vec3 ambient = light.ambient * light.color * texture(material.diffuse, fs_in.TexCoords).rgb;\n"
+"	vec3 ambient = light.ambient * light.color * diffuseColor;\n"
 // calculate normal and light direction
 "	vec3 normal = normalize(fs_in.Normal);\n"
 "	vec3 lightDirection = normalize(light.position - fs_in.FragPos);\n"
 // calculate diffuse component with diffuse texture
 "	float diffuseStrength = max(dot(normal, lightDirection), 0.0f);\n"
-"	vec3 diffuse = light.diffuse * (diffuseStrength * light.color * texture(material.diffuse, fs_in.TexCoords).rgb);\n"
+"	vec3 diffuse = light.diffuse * (diffuseStrength * light.color * diffuseColor);\n"
 // calculate specular component with specular texture
 "	vec3 viewDirection = normalize(viewPos - fs_in.FragPos);\n"
-"	vec3 halfwayDirection = normalize(lightDirection + viewDirection);\n"
-"	float specularStrength = pow(max(dot(normal, halfwayDirection), 0.0f), material.shininess);\n"
-"	vec3 specular = light.specular * (specularStrength * texture(material.specular, fs_in.TexCoords).rgb * light.color);\n"
+"	float specularStrength = SpecularStrength(normal, lightDirection, viewDirection);\n"
+"	vec3 specular = light.specular * (specularStrength * specularColor * light.color);\n"
 // calculate shadow
 "	float shadow = ShadowCalculation(fs_in.FragPosLightSpace);\n"
 // final fragment's color
 "	vec3 result =  ambient + (1.0f - shadow) * (diffuse + specular);\n"
+// add point lights with their omnidirectional shadows
+"	for (int i = 0; i < pointLightCount; ++i) {\n"
+"		vec3 pointDirection = normalize(pointLights[i].position - fs_in.FragPos);\n"
+"		float pointDiffuse = max(dot(normal, pointDirection), 0.0f);\n"
+"		float pointSpecular = SpecularStrength(normal, pointDirection, viewDirection);\n"
+"		float pointDistance = length(pointLights[i].position - fs_in.FragPos);\n"
+"		float pointAttenuation = 1.0 / (light.constant + light.linear * pointDistance + light.quadratic * (pointDistance * pointDistance));\n"
+"		vec3 pointColor = light.diffuse * pointDiffuse * diffuseColor + light.specular * pointSpecular * specularColor;\n"
+"		result += (1.0f - PointShadowCalculation(pointLights[i])) * pointAttenuation * pointLights[i].color * pointColor;\n"
+"	}\n"
 "	FragColor = vec4(result, 1.0f);\n"
 "}\n";
 
@@ -341,13 +417,203 @@ const char* blinn_fragment_shader = "#version 330 core\n"
 const char* depth_vertex = "#version 330 core\n"
 "layout (location = 0) in vec3 position;\n"
 "uniform mat4 lightSpaceMatrix;\n"
-"uniform mat4 model;\n"
+OBJECT_BLOCK
 "void main() {\n"
 "	gl_Position = lightSpaceMatrix * model * vec4(position, 1.0f);\n"
 "}\n";
 // empty fragment shader
+// depth is written by the rasterizer, writing gl_FragDepth would turn off early and hierarchical z
 const char* depth_fragment = "#version 330 core\n"
 "void main() {\n"
-// 'cause will be automatically set as defualt
-"	gl_FragDepth = gl_FragCoord.z;\n"
-"}\n";
\ No newline at end of file
+"}\n";
+
+// depth prepass from the camera's perspective, positions are computed exactly like in the lit pass
+const char* prepass_vertex = "#version 330 core\n"
+"layout (location = 0) in vec3 aPos;\n"
+OBJECT_BLOCK
+"invariant gl_Position;\n"
+"void main() {\n"
+"	gl_Position = mvp * vec4(aPos, 1.0f);\n"
+"}\n";
+
+// layered depth shader for point light shadows
+// pass world space positions through, the geometry shader projects them for every face
+const char* point_shadow_vertex = "#version 330 core\n"
+"layout (location = 0) in vec3 position;\n"
+OBJECT_BLOCK
+"void main() {\n"
+"	gl_Position = model * vec4(position, 1.0f);\n"
+"}\n";
+// route each triangle to the cube faces it touches
+const char* point_shadow_geometry = "#version 330 core\n"
+"layout (triangles) in;\n"
+"layout (triangle_strip, max_vertices = 18) out;\n"
+"uniform mat4 faceMatrices[6];\n"
+// faces left after culling the object on the CPU
+"uniform int faceMask;\n"
+// first layer of the light in the texture array
+"uniform int layerBase;\n"
+"void main() {\n"
+"	for (int face = 0; face < 6; ++face) {\n"
+"		if ((faceMask & (1 << face)) == 0)\n"
+"			continue;\n"
+"		vec4 clip[3];\n"
+"		for (int i = 0; i < 3; ++i)\n"
+"			clip[i] = faceMatrices[face] * gl_in[i].gl_Position;\n"
+// skip the face if all three vertices lie outside the same side of its frustum
+"		vec3 w = vec3(clip[0].w, clip[1].w, clip[2].w);\n"
+"		vec3 x = vec3(clip[0].x, clip[1].x, clip[2].x);\n"
+"		vec3 y = vec3(clip[0].y, clip[1].y, clip[2].y);\n"
+"		vec3 z = vec3(clip[0].z, clip[1].z, clip[2].z);\n"
+"		if (all(lessThan(x, -w)) || all(greaterThan(x, w)) || all(lessThan(y, -w)) || all(greaterThan(y, w)) || all(lessThan(z, -w)) || all(greaterThan(z, w)))\n"
+"			continue;\n"
+"		for (int i = 0; i < 3; ++i) {\n"
+"			gl_Layer = layerBase + face;\n"
+"			gl_Position = clip[i];\n"
+"			EmitVertex();\n"
+"		}\n"
+"		EndPrimitive();\n"
+"	}\n"
+"}\n";
+// depth is written by the rasterizer
+const char* point_shadow_fragment = "#version 330 core\n"
+"void main() {\n"
+"}\n";
+// CPU framebuffer of the 2D tools drawn as one textured quad, corners come from the vertex id
+const char* raster_vertex = "#version 330 core\n"
+// left, bottom, right and top of the quad in normalized device coordinates
+"uniform vec4 rect;\n"
+"out vec2 TexCoord;\n"
+"void main() {\n"
+"	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+"	TexCoord = corner;\n"
+"	gl_Position = vec4(mix(rect.xy, rect.zw, corner), 0.0f, 1.0f);\n"
+"}\n";
+// pixels never drawn are transparent
+const char* raster_fragment = "#version 330 core\n"
+"in vec2 TexCoord;\n"
+"out vec4 FragColor;\n"
+"uniform sampler2D raster;\n"
+"void main() {\n"
+"	vec4 color = texture(raster, TexCoord);\n"
+"	if (color.a == 0.0f)\n"
+"		discard;\n"
+"	FragColor = color;\n"
+"}\n";
+// 2D circles and rounded points, a unit quad per instance grown to the shape plus a pixel for the
+// anti-aliased edge, sizes along x are turned into pixels so circles stay round on any window
+const char* shape_round_vertex = "#version 330 core\n"
+"layout(location = 0) in vec2 corner;\n"
+// center, radius and stroke width
+"layout(location = 1) in vec4 shape;\n"
+"layout(location = 2) in vec4 color;\n"
+"layout(location = 3) in float cornerRadius;\n"
+"uniform vec2 viewport;\n"
+"out vec2 Local;\n"
+"out vec4 Color;\n"
+"flat out vec3 Size;\n"
+"void main() {\n"
+"	float radius = shape.z * viewport.x * 0.5f;\n"
+"	Local = corner * (radius + shape.w * 0.5f + 1.0f);\n"
+"	Color = color;\n"
+"	Size = vec3(radius, shape.w, cornerRadius);\n"
+"	gl_Position = vec4(shape.xy + Local * 2.0f / viewport, 0.0f, 1.0f);\n"
+"}\n";
+// signed distance to the circle or the rounded square in pixels, coverage falls off over one pixel
+const char* shape_round_fragment = "#version 330 core\n"
+"in vec2 Local;\n"
+"in vec4 Color;\n"
+// radius, stroke width and corner radius, a negative corner radius marks a circle
+"flat in vec3 Size;\n"
+"out vec4 FragColor;\n"
+"void main() {\n"
+"	float d;\n"
+"	if (Size.z < 0.0f) {\n"
+"		d = length(Local) - Size.x;\n"
+"	}\n"
+"	else {\n"
+"		float corner = min(Size.z, Size.x);\n"
+"		vec2 q = abs(Local) - vec2(Size.x - corner);\n"
+"		d = length(max(q, 0.0f)) + min(max(q.x, q.y), 0.0f) - corner;\n"
+"	}\n"
+"	if (Size.y > 0.0f)\n"
+"		d = abs(d) - Size.y * 0.5f;\n"
+"	float alpha = clamp(0.5f - d, 0.0f, 1.0f);\n"
+"	if (alpha <= 0.0f)\n"
+"		discard;\n"
+"	FragColor = vec4(Color.rgb, Color.a * alpha);\n"
+"}\n";
+// 2D triangles, the unit triangle's barycentric weights pick the instance's corners. Every corner is
+// pushed a pixel out along both of its edges for the anti-aliased edge, its weights are recomputed
+// against the original triangle and turn negative outside it
+const char* shape_triangle_vertex = "#version 330 core\n"
+"layout(location = 0) in vec3 weights;\n"
+// first and second corner
+"layout(location = 1) in vec4 first;\n"
+"layout(location = 2) in vec2 third;\n"
+"layout(location = 3) in vec4 color;\n"
+"layout(location = 4) in float stroke;\n"
+"uniform vec2 viewport;\n"
+"out vec3 Weights;\n"
+"out vec4 Color;\n"
+"flat out float Stroke;\n"
+"float cross2(vec2 a, vec2 b) {\n"
+"	return a.x * b.y - a.y * b.x;\n"
+"}\n"
+"void main() {\n"
+"	Color = color;\n"
+"	Stroke = stroke;\n"
+"	vec2 p[3] = vec2[3](first.xy, first.zw, third);\n"
+"	for (int k = 0; k < 3; ++k)\n"
+"		p[k] = (p[k] + 1.0f) * 0.5f * viewport;\n"
+"	float area = cross2(p[1] - p[0], p[2] - p[0]);\n"
+"	if (abs(area) < 1e-6f) {\n"
+"		Weights = vec3(0.0f);\n"
+"		gl_Position = vec4(2.0f, 2.0f, 2.0f, 1.0f);\n"
+"		return;\n"
+"	}\n"
+"	int i = weights.y > 0.5f ? 1 : (weights.z > 0.5f ? 2 : 0);\n"
+"	vec2 corner = p[i];\n"
+"	vec2 next = normalize(p[(i + 1) % 3] - corner) * sign(area);\n"
+"	vec2 previous = normalize(corner - p[(i + 2) % 3]) * sign(area);\n"
+// outward normals of the two edges, the corner moves to where both offset edges meet
+"	vec2 n1 = vec2(next.y, -next.x), n2 = vec2(previous.y, -previous.x);\n"
+"	vec2 position = corner + (n1 + n2) / max(1.0f + dot(n1, n2), 0.1f);\n"
+"	Weights = vec3(cross2(p[1] - position, p[2] - position), cross2(p[2] - position, p[0] - position), cross2(p[0] - position, p[1] - position)) / area;\n"
+"	gl_Position = vec4(position * 2.0f / viewport - 1.0f, 0.0f, 1.0f);\n"
+"}\n";
+// a weight over its screen space derivative is the distance to the opposite edge in pixels
+const char* shape_triangle_fragment = "#version 330 core\n"
+"in vec3 Weights;\n"
+"in vec4 Color;\n"
+"flat in float Stroke;\n"
+"out vec4 FragColor;\n"
+"void main() {\n"
+"	vec3 edges = Weights / max(fwidth(Weights), vec3(1e-6f));\n"
+"	float d = min(edges.x, min(edges.y, edges.z));\n"
+"	float alpha = clamp(d + 0.5f, 0.0f, 1.0f);\n"
+"	if (Stroke > 0.0f)\n"
+"		alpha *= clamp(Stroke - d + 0.5f, 0.0f, 1.0f);\n"
+"	if (alpha <= 0.0f)\n"
+"		discard;\n"
+"	FragColor = vec4(Color.rgb, Color.a * alpha);\n"
+"}\n";
+// tiles of the 2D canvas, quads in normalized device coordinates sampling the tile atlas
+const char* canvas_vertex = "#version 330 core\n"
+"layout(location = 0) in vec2 position;\n"
+"layout(location = 1) in vec2 texCoord;\n"
+"out vec2 TexCoord;\n"
+"void main() {\n"
+"	TexCoord = texCoord;\n"
+"	gl_Position = vec4(position, 0.0f, 1.0f);\n"
+"}\n";
+const char* canvas_fragment = "#version 330 core\n"
+"in vec2 TexCoord;\n"
+"out vec4 FragColor;\n"
+"uniform sampler2D atlas;\n"
+"void main() {\n"
+"	vec4 color = texture(atlas, TexCoord);\n"
+"	if (color.a == 0.0f)\n"
+"		discard;\n"
+"	FragColor = color;\n"
+"}\n";
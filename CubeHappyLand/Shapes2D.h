@@ -0,0 +1,241 @@
+#pragma once
+#include <glad/glad.h>
+#include <utility>
+#include <vector>
+#include "Shader.h"
+#include "ShaderCode.h"
+
+// @dev instance of a circle or a rounded square
+typedef struct RoundInstance {
+	// center in normalized device coordinates
+	float x, y;
+	// radius of the circle or half the edge of the square, in normalized device units along x
+	float radius;
+	// width of the outline in pixels, 0 fills the shape
+	float stroke;
+	float r, g, b, a;
+	// corner radius of a square in pixels, negative for a circle
+	float corner;
+}RoundInstance;
+
+// @dev instance of a triangle
+typedef struct TriangleInstance {
+	// corners in normalized device coordinates
+	float x0, y0, x1, y1, x2, y2;
+	float r, g, b, a;
+	// width of the outline in pixels, 0 fills the shape
+	float stroke;
+}TriangleInstance;
+
+// @dev shapes of a frame collected on one thread and drawn on the thread owning the context
+typedef struct Shapes2DFrame {
+	std::vector<RoundInstance> rounds;
+	std::vector<TriangleInstance> triangles;
+}Shapes2DFrame;
+
+// @dev Renderer for the anti-aliased 2D shapes of the tools. Two unit meshes are built once, a quad
+// for circles and rounded points and a triangle whose corners are picked by barycentric weights.
+// Every shape is an instance of one of them, the per-instance stream holds its position, size,
+// color and stroke, and the fragment shaders shade the edges analytically from signed distances.
+// Each mesh is drawn with one instanced call per frame, the instance arrays keep their capacity so
+// a frame allocates nothing once the largest frame has been seen. Collecting needs no context, a
+// frame taken with takeFrame can be drawn on another thread with drawFrame.
+class Shapes2D
+{
+private:
+	Shapes2D() {
+		frame.rounds.reserve(1024);
+		frame.triangles.reserve(256);
+	}
+	~Shapes2D() {
+		destroy();
+		delete instance;
+	}
+	Shader* roundProgram = nullptr;
+	Shader* triangleProgram = nullptr;
+	// unit meshes and their instance buffers
+	unsigned int roundVAO = 0, quadVBO = 0, roundInstanceVBO = 0;
+	unsigned int triangleVAO = 0, cornerVBO = 0, triangleInstanceVBO = 0;
+	// instance buffer sizes in instances
+	int roundCapacity = 0;
+	int triangleCapacity = 0;
+	// shapes collected for the frame
+	Shapes2DFrame frame;
+public:
+	// statistics of the last frame
+	int drawCalls = 0;
+	int instances = 0;
+
+	// @dev append a circle
+	// @param center Center in normalized device coordinates
+	// @param radius Radius in normalized device units along x
+	// @param stroke Width of the outline in pixels, 0 fills the circle
+	void circle(const float* center, float radius, const float* color, float stroke = 0.0f) {
+		RoundInstance shape = { center[0], center[1], radius, stroke, color[0], color[1], color[2], 1.0f, -1.0f };
+		frame.rounds.push_back(shape);
+	}
+
+	// @dev append a filled square with rounded corners, meant for points
+	// @param half Half the edge in normalized device units along x
+	// @param corner Corner radius in pixels
+	void point(float x, float y, float half, const float* color, float corner = 1.0f) {
+		RoundInstance shape = { x, y, half, 0.0f, color[0], color[1], color[2], 1.0f, corner };
+		frame.rounds.push_back(shape);
+	}
+
+	// @dev append a triangle
+	// @param stroke Width of the outline in pixels, 0 fills the triangle
+	void triangle(const float* v1, const float* v2, const float* v3, const float* color, float stroke = 0.0f) {
+		TriangleInstance shape = { v1[0], v1[1], v2[0], v2[1], v3[0], v3[1], color[0], color[1], color[2], 1.0f, stroke };
+		frame.triangles.push_back(shape);
+	}
+
+	// @dev draw the shapes of the frame on top of what is there, called once per frame
+	void endFrame() {
+		drawFrame(frame);
+		frame.rounds.clear();
+		frame.triangles.clear();
+	}
+
+	// @dev swap the collected shapes out, the frame given in is cleared and collects the next one
+	void takeFrame(Shapes2DFrame& taken) {
+		std::swap(frame, taken);
+		frame.rounds.clear();
+		frame.triangles.clear();
+	}
+
+	// @dev draw shapes collected before on top of what is there, needs the context
+	void drawFrame(const Shapes2DFrame& shapes) {
+		const std::vector<RoundInstance>& rounds = shapes.rounds;
+		const std::vector<TriangleInstance>& triangles = shapes.triangles;
+		drawCalls = 0;
+		instances = (int)(rounds.size() + triangles.size());
+		if (instances == 0) {
+			return;
+		}
+		if (roundProgram == nullptr) {
+			create();
+		}
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+		GLboolean blend = glIsEnabled(GL_BLEND);
+		glDisable(GL_DEPTH_TEST);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		if (!triangles.empty()) {
+			upload(triangleInstanceVBO, triangleCapacity, triangles.data(), (int)triangles.size(), sizeof(TriangleInstance));
+			triangleProgram->use();
+			triangleProgram->setVec2("viewport", (float)viewport[2], (float)viewport[3]);
+			glBindVertexArray(triangleVAO);
+			glDrawArraysInstanced(GL_TRIANGLES, 0, 3, (GLsizei)triangles.size());
+			drawCalls++;
+		}
+		if (!rounds.empty()) {
+			upload(roundInstanceVBO, roundCapacity, rounds.data(), (int)rounds.size(), sizeof(RoundInstance));
+			roundProgram->use();
+			roundProgram->setVec2("viewport", (float)viewport[2], (float)viewport[3]);
+			glBindVertexArray(roundVAO);
+			glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)rounds.size());
+			drawCalls++;
+		}
+		glBindVertexArray(0);
+		if (!blend) {
+			glDisable(GL_BLEND);
+		}
+		if (depthTest) {
+			glEnable(GL_DEPTH_TEST);
+		}
+	}
+
+	// @dev release the meshes and programs
+	void destroy() {
+		if (roundProgram != nullptr) {
+			unsigned int buffers[4] = { quadVBO, roundInstanceVBO, cornerVBO, triangleInstanceVBO };
+			unsigned int arrays[2] = { roundVAO, triangleVAO };
+			glDeleteBuffers(4, buffers);
+			glDeleteVertexArrays(2, arrays);
+			glDeleteProgram(roundProgram->ID);
+			glDeleteProgram(triangleProgram->ID);
+			delete roundProgram;
+			delete triangleProgram;
+		}
+		roundProgram = nullptr;
+		triangleProgram = nullptr;
+		roundCapacity = 0;
+		triangleCapacity = 0;
+		frame.rounds.clear();
+		frame.triangles.clear();
+	}
+
+	// makes Shapes2D an instance
+	static Shapes2D* getInstance() {
+		if (instance == NULL) {
+			instance = new Shapes2D();
+		}
+		return instance;
+	}
+private:
+	static Shapes2D* instance;
+
+	// @dev build the unit meshes and describe the instance streams
+	void create() {
+		roundProgram = new Shader(shape_round_vertex, shape_round_fragment);
+		triangleProgram = new Shader(shape_triangle_vertex, shape_triangle_fragment);
+
+		// quad corners from -1 to 1 as a strip
+		const float quad[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+		glGenVertexArrays(1, &roundVAO);
+		glGenBuffers(1, &quadVBO);
+		glGenBuffers(1, &roundInstanceVBO);
+		glBindVertexArray(roundVAO);
+		glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, roundInstanceVBO);
+		// center, radius and stroke, color, corner
+		instanceAttribute(1, 4, sizeof(RoundInstance), 0);
+		instanceAttribute(2, 4, sizeof(RoundInstance), 4 * sizeof(float));
+		instanceAttribute(3, 1, sizeof(RoundInstance), 8 * sizeof(float));
+
+		// barycentric weights of the corners
+		const float corners[] = { 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+		glGenVertexArrays(1, &triangleVAO);
+		glGenBuffers(1, &cornerVBO);
+		glGenBuffers(1, &triangleInstanceVBO);
+		glBindVertexArray(triangleVAO);
+		glBindBuffer(GL_ARRAY_BUFFER, cornerVBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, triangleInstanceVBO);
+		// first two corners, third corner, color, stroke
+		instanceAttribute(1, 4, sizeof(TriangleInstance), 0);
+		instanceAttribute(2, 2, sizeof(TriangleInstance), 4 * sizeof(float));
+		instanceAttribute(3, 4, sizeof(TriangleInstance), 6 * sizeof(float));
+		instanceAttribute(4, 1, sizeof(TriangleInstance), 10 * sizeof(float));
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	static void instanceAttribute(unsigned int location, int size, int stride, size_t offset) {
+		glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+		glEnableVertexAttribArray(location);
+		glVertexAttribDivisor(location, 1);
+	}
+
+	// @dev fill an instance buffer, its storage is orphaned every frame and only grows
+	static void upload(unsigned int buffer, int& capacity, const void* data, int count, size_t stride) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		if (count > capacity) {
+			capacity = count * 2;
+		}
+		glBufferData(GL_ARRAY_BUFFER, capacity * stride, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, count * stride, data);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+};
+
+Shapes2D* Shapes2D::instance = NULL;
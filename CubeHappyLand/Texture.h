@@ -1,13 +1,37 @@
 #pragma once
+#include <glad/glad.h>
+#include <string>
 
 class Texture
 {
 public:
-	unsigned int textureId;
+	unsigned int textureId = 0;
+	// GL_TEXTURE_2D, or GL_TEXTURE_2D_ARRAY for textures made of layers
+	unsigned int target = GL_TEXTURE_2D;
+	// canonical path and load parameters the texture was created from
+	std::string key;
+	// video memory taken by the texture including mipmaps
+	size_t bytes = 0;
+	// video memory saved against storing the image as RGB8, negative for images that needed more
+	long long savedBytes = 0;
+	// internal format and size of level 0, the placeholder until the image has arrived
+	unsigned int format = 0;
+	int width = 0;
+	int height = 0;
+	int layers = 1;
+	// number of holders, only unreferenced textures may be evicted
+	int refCount = 0;
+	// last time the texture was requested or released
+	unsigned long lastUsed = 0;
+	// whether a mipmap chain is generated once the image has arrived
+	bool mipmaps = true;
+	// whether the image is still being decoded or uploaded
+	bool loading = false;
+	// whether the texture was uploaded from a block compressed container
+	bool compressed = false;
 	Texture() {}
 	Texture(unsigned int id) {
 		this->textureId = id;
 	}
 	~Texture() {}
 };
-
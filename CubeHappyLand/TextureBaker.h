@@ -0,0 +1,246 @@
+#pragma once
+#include <stb_image.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "BlockCompressor.h"
+#include "KtxFile.h"
+#include "ThreadPool.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <dirent.h>
+#endif
+
+// @dev Offline converter from images to block compressed KTX files with a full mip chain, run with
+//   CubeHappyLand --bake Resources/Materials/Textures
+// Every image is written next to its source with .ktx appended to its name, TextureManager
+// picks those files up instead of decoding the image. The format is chosen from the content:
+//   - BC4 for grey images, sampled with the red channel swizzled to every channel
+//   - BC3 for images with transparent texels
+//   - BC1 for everything else
+// Block rows are spread over a worker pool.
+class TextureBaker
+{
+public:
+	// statistics over every baked image
+	size_t sourceBytes = 0;
+	size_t bakedBytes = 0;
+
+	TextureBaker() {}
+	~TextureBaker() {}
+
+	// @dev bake every jpg and png in a directory
+	// @return Number of images that failed
+	int bakeDirectory(const char* directory) {
+		int failed = 0;
+		std::vector<std::string> files = listImages(directory);
+		for (const std::string& file : files) {
+			if (!bake(file.c_str())) {
+				failed++;
+			}
+		}
+		std::cout << files.size() - failed << " textures baked, " << sourceBytes / 1024 << " KB -> " << bakedBytes / 1024 << " KB" << std::endl;
+		return failed;
+	}
+
+	// @dev bake one image
+	// @return False if the image cannot be read or the container cannot be written
+	bool bake(const char* path) {
+		auto start = std::chrono::steady_clock::now();
+		int width, height, nrChannels;
+		// rows are flipped by hand, TextureManager loads images upside down by default
+		stbi_set_flip_vertically_on_load(false);
+		unsigned char* pixels = stbi_load(path, &width, &height, &nrChannels, 4);
+		if (pixels == nullptr) {
+			std::cout << "Failed to load texture " << path << std::endl;
+			return false;
+		}
+		std::vector<unsigned char> level((size_t)width * height * 4);
+		for (int y = 0; y < height; y++) {
+			memcpy(&level[(size_t)y * width * 4], pixels + (size_t)(height - 1 - y) * width * 4, (size_t)width * 4);
+		}
+		stbi_image_free(pixels);
+
+		GLenum internalFormat, baseFormat;
+		chooseFormat(level, internalFormat, baseFormat);
+		std::vector<std::vector<unsigned char>> levels;
+		int levelWidth = width, levelHeight = height;
+		for (;;) {
+			levels.push_back(encode(level, levelWidth, levelHeight, internalFormat));
+			if (levelWidth == 1 && levelHeight == 1) {
+				break;
+			}
+			level = downsample(level, levelWidth, levelHeight);
+			levelWidth = std::max(levelWidth / 2, 1);
+			levelHeight = std::max(levelHeight / 2, 1);
+		}
+
+		std::string output = bakedPath(path);
+		if (!KtxFile::write(output.c_str(), internalFormat, baseFormat, width, height, levels)) {
+			std::cout << "Failed to write " << output << std::endl;
+			return false;
+		}
+		size_t raw = (size_t)width * height * 3 * 4 / 3;
+		size_t baked = 0;
+		for (const std::vector<unsigned char>& data : levels) {
+			baked += data.size();
+		}
+		sourceBytes += raw;
+		bakedBytes += baked;
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::cout << output << ": " << formatName(internalFormat) << ", " << width << "x" << height << ", "
+			<< levels.size() << " levels, " << raw / 1024 << " KB -> " << baked / 1024 << " KB, " << ms << " ms" << std::endl;
+		return true;
+	}
+
+	// @dev path of the container baked from an image, the extension is kept so that images which
+	// only differ in it do not share a container
+	static std::string bakedPath(const char* path) {
+		return std::string(path) + ".ktx";
+	}
+
+private:
+	ThreadPool pool;
+
+	// @dev pick the smallest format that keeps the image's channels
+	static void chooseFormat(const std::vector<unsigned char>& rgba, GLenum& internalFormat, GLenum& baseFormat) {
+		bool grey = true, opaque = true;
+		for (size_t i = 0; i < rgba.size(); i += 4) {
+			// jpeg chroma rounding leaves grey images off by a little
+			grey = grey && abs(rgba[i] - rgba[i + 1]) <= 2 && abs(rgba[i] - rgba[i + 2]) <= 2;
+			opaque = opaque && rgba[i + 3] == 255;
+		}
+		if (!opaque) {
+			internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			baseFormat = GL_RGBA;
+		}
+		else if (grey) {
+			internalFormat = GL_COMPRESSED_RED_RGTC1;
+			baseFormat = GL_RED;
+		}
+		else {
+			internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+			baseFormat = GL_RGB;
+		}
+	}
+
+	static const char* formatName(GLenum internalFormat) {
+		switch (internalFormat) {
+		case GL_COMPRESSED_RED_RGTC1:
+			return "BC4";
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+			return "BC3";
+		default:
+			return "BC1";
+		}
+	}
+
+	// @dev encode one mip level, bands of block rows run on the pool
+	std::vector<unsigned char> encode(const std::vector<unsigned char>& rgba, int width, int height, GLenum internalFormat) {
+		int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		int blockBytes = internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? 16 : 8;
+		std::vector<unsigned char> out((size_t)blocksX * blocksY * blockBytes);
+		const int BAND = 8;
+		pool.start();
+		for (int first = 0; first < blocksY; first += BAND) {
+			int last = std::min(first + BAND, blocksY);
+			pool.submit([&rgba, &out, width, height, blocksX, blockBytes, internalFormat, first, last]() {
+				unsigned char block[64];
+				for (int by = first; by < last; by++) {
+					for (int bx = 0; bx < blocksX; bx++) {
+						// texels beyond the edge repeat the last row and column
+						for (int y = 0; y < 4; y++) {
+							int sy = std::min(by * 4 + y, height - 1);
+							for (int x = 0; x < 4; x++) {
+								int sx = std::min(bx * 4 + x, width - 1);
+								memcpy(block + (y * 4 + x) * 4, &rgba[((size_t)sy * width + sx) * 4], 4);
+							}
+						}
+						unsigned char* target = &out[((size_t)by * blocksX + bx) * blockBytes];
+						if (internalFormat == GL_COMPRESSED_RED_RGTC1) {
+							BlockCompressor::encodeBC4(block, 4, target);
+						}
+						else if (internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) {
+							BlockCompressor::encodeBC3(block, target);
+						}
+						else {
+							BlockCompressor::encodeBC1(block, target);
+						}
+					}
+				}
+			});
+		}
+		pool.wait();
+		return out;
+	}
+
+	// @dev next mip level with a 2x2 box filter
+	static std::vector<unsigned char> downsample(const std::vector<unsigned char>& rgba, int width, int height) {
+		int nextWidth = std::max(width / 2, 1), nextHeight = std::max(height / 2, 1);
+		std::vector<unsigned char> next((size_t)nextWidth * nextHeight * 4);
+		for (int y = 0; y < nextHeight; y++) {
+			int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+			for (int x = 0; x < nextWidth; x++) {
+				int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+				for (int c = 0; c < 4; c++) {
+					int sum = rgba[((size_t)y0 * width + x0) * 4 + c] + rgba[((size_t)y0 * width + x1) * 4 + c]
+						+ rgba[((size_t)y1 * width + x0) * 4 + c] + rgba[((size_t)y1 * width + x1) * 4 + c];
+					next[((size_t)y * nextWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+		return next;
+	}
+
+	// @dev jpg and png files of a directory
+	static std::vector<std::string> listImages(const char* directory) {
+		std::vector<std::string> files;
+		std::string root = directory;
+		if (!root.empty() && root.back() != '/' && root.back() != '\\') {
+			root += "/";
+		}
+#ifdef _WIN32
+		_finddata_t entry;
+		intptr_t search = _findfirst((root + "*").c_str(), &entry);
+		if (search != -1) {
+			do {
+				if (isImage(entry.name)) {
+					files.push_back(root + entry.name);
+				}
+			} while (_findnext(search, &entry) == 0);
+			_findclose(search);
+		}
+#else
+		DIR* dir = opendir(directory);
+		if (dir != NULL) {
+			for (dirent* entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+				if (isImage(entry->d_name)) {
+					files.push_back(root + entry->d_name);
+				}
+			}
+			closedir(dir);
+		}
+#endif
+		std::sort(files.begin(), files.end());
+		return files;
+	}
+
+	static bool isImage(const std::string& name) {
+		size_t dot = name.find_last_of('.');
+		if (dot == std::string::npos) {
+			return false;
+		}
+		std::string extension = name.substr(dot + 1);
+		for (char& c : extension) {
+			c = (char)tolower((unsigned char)c);
+		}
+		return extension == "jpg" || extension == "jpeg" || extension == "png";
+	}
+};
@@ -1,65 +1,503 @@
 #pragma once
 #include "Texture.h"
 #include "Shader.h"
+#include "ThreadPool.h"
+#include "KtxFile.h"
+#include "TextureBaker.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <stb_image.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
+// @dev parameters a texture is created with, textures loaded from the same file with different
+// parameters are different textures
+typedef struct TextureParams {
+	// wrapping for S direction (x direction) and T direction (y direction)
+	GLint wrapS = GL_MIRRORED_REPEAT;
+	GLint wrapT = GL_MIRRORED_REPEAT;
+	// filtering for minify and magnify
+	GLint minFilter = GL_NEAREST;
+	GLint magFilter = GL_LINEAR;
+	// flip the image on the y-axis while loading
+	bool flip = true;
+	// generate a mipmap chain
+	bool mipmaps = true;
+	// store color in sRGB, grey images are then kept in three channels as there is no single channel sRGB format
+	bool sRGB = false;
+	// keep the mip chain in system memory and stream levels in as the footprint on screen asks for them,
+	// users request their footprint every frame with TextureManager::requestFootprint
+	bool stream = false;
+}TextureParams;
+
+// @dev Texture cache. Textures are keyed by canonical path and load parameters, so loading a file
+// twice hands out the same texture. Every load takes a reference which is given back with release.
+// Unreferenced textures stay resident until the budget is exceeded, then they are evicted least
+// recently used first.
+// Images are decoded on a worker pool. Until its image has arrived a texture holds a single grey
+// texel, so load returns at once and the id stays valid. Decoded images are copied into a pixel
+// buffer object a few hundred kilobytes per frame by update, the texture is respecified from the
+// buffer once it is complete.
+// Every image is stored with as few channels as it needs, grey maps take a single channel and are
+// sampled as grey. Single channel maps can also be packed into the channels of one texture, and
+// images can be stacked into the layers of an array texture so objects with different materials
+// are drawn without rebinding.
+// Streamed textures start with their coarse mip levels only. Every frame the finest level any user
+// needs is requested from its footprint on screen, finer levels are streamed in and unneeded ones
+// dropped under a memory budget, BASE_LEVEL clamps sampling to the levels present.
+// If the image has been baked into a block compressed container (see TextureBaker) and the driver
+// takes its format, the container is mapped and its mip chain uploaded directly instead.
 class TextureManager
 {
 private:
 	TextureManager() {}
 	~TextureManager() {
 		// deallocate textures
-		for (int i = 0; i < size; i++) {
-			glDeleteTextures(1, &textures[i].textureId);
+		for (auto& entry : textures) {
+			glDeleteTextures(1, &entry.second.textureId);
 		}
 		delete instance;
 	}
-	// textures
-	Texture textures[10];
-	int size = 0;
+	// textures by key
+	std::unordered_map<std::string, Texture> textures;
+	// keys by texture id
+	std::unordered_map<unsigned int, std::string> keys;
+	// logical time for the LRU order
+	unsigned long clock = 0;
+
+	// image decoded by a worker
+	typedef struct Decoded {
+		std::string key;
+		unsigned char* pixels;
+		int width;
+		int height;
+		int channels;
+		// number of stacked images of an array texture, 0 for a 2D texture
+		int layers;
+		// every texel holds a single grey value, followed by alpha if there are two channels
+		bool grey;
+		bool sRGB;
+		// every mip level of a streamed texture, the pixels are freed once it is built
+		std::shared_ptr<std::vector<std::vector<unsigned char>>> chain;
+	}Decoded;
+	// texture whose finer mip levels are streamed
+	typedef struct Streamed {
+		// system memory copy of every level, level 0 first, all layers of a level are contiguous
+		std::vector<std::vector<unsigned char>> levels;
+		GLenum target;
+		GLint internalFormat;
+		GLenum format;
+		int width;
+		int height;
+		int layers;
+		int channels;
+		// finest level resident on the GPU, and the level the texture started with which stays resident
+		int baseLevel;
+		int startLevel;
+		// finest level the users asked for
+		int wanted;
+		// finest level requested since the last update, and when it was last requested
+		int requested;
+		unsigned long lastRequested;
+	}Streamed;
+	// image being copied into a pixel buffer object
+	typedef struct Upload {
+		Decoded image;
+		unsigned int PBO;
+		unsigned char* mapped;
+		size_t size;
+		size_t copied;
+	}Upload;
+	// decoding threads
+	ThreadPool decoder;
+	// images handed over by the workers
+	std::mutex decodedMutex;
+	std::vector<Decoded> decoded;
+	// uploads in progress, oldest first
+	std::vector<Upload> uploads;
+	// whether the driver takes S3TC textures, -1 until asked
+	int s3tc = -1;
+	// streamed textures by texture id
+	std::unordered_map<unsigned int, Streamed> streams;
+	// number of stream updates
+	unsigned long streamFrame = 0;
 public:
+	// video memory unreferenced textures may occupy before being evicted
+	size_t budgetBytes = 256 * 1024 * 1024;
+	// statistics
+	size_t residentBytes = 0;
+	unsigned long hits = 0;
+	unsigned long misses = 0;
+	unsigned long evictions = 0;
+	// textures still showing the placeholder
+	int loading = 0;
+	// resident textures uploaded from baked containers
+	int baked = 0;
+	// bytes copied into pixel buffers per frame
+	size_t uploadBudget = 512 * 1024;
+	// video memory the mip levels of streamed textures may occupy
+	size_t streamBudgetBytes = 64 * 1024 * 1024;
+	// largest level streamed textures start with
+	int streamStartSize = 64;
+	// statistics of streamed textures
+	size_t streamedBytes = 0;
+	int pendingLevels = 0;
 
-	unsigned int load(const char* path) {
+	// @dev get a texture from the cache or load it from disk, takes a reference
+	// @param path Path of the image
+	// @param params Parameters the texture is created with
+	// @return Id of the texture
+	unsigned int load(const char* path, const TextureParams& params = TextureParams()) {
+		PROFILE_ZONE("TextureManager::load");
+		std::string key = canonicalPath(path) + paramsKey(params);
+		unsigned int texture = lookup(key);
+		if (texture != 0) {
+			return texture;
+		}
+		texture = create(params, GL_TEXTURE_2D);
 
-		unsigned int texture;
-		// create texture
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
+		// containers are baked upside down like the default load
+		size_t bytes = 0;
+		Texture entry(texture);
+		if (params.flip && loadBaked(path, params, entry, bytes)) {
+			entry.key = key;
+			entry.mipmaps = params.mipmaps;
+			entry.bytes = bytes;
+			entry.refCount = 1;
+			entry.lastUsed = clock;
+			entry.compressed = true;
+			textures[key] = entry;
+			keys[texture] = key;
+			residentBytes += bytes;
+			baked++;
+			evict();
+			return texture;
+		}
+		beginLoading(texture, key, params, GL_TEXTURE_2D);
 
-		// set texture wrapping parameters
-		// for S direction (x direction)
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-		// for T direction (y direction)
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		// for minify
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-		// load image
-		int width, height, nrChannels;
-		// tell stb_image.h to flip the loaded texture's on the y-axis
-		stbi_set_flip_vertically_on_load(true);
-		unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 0);
-		if (data) {
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-			glGenerateMipmap(GL_TEXTURE_2D);
+		// decode on a worker, the global flip setting of stb_image is not thread safe so we flip ourselves
+		std::string file = path;
+		bool flip = params.flip, sRGB = params.sRGB, stream = params.stream && params.mipmaps;
+		decoder.submit([this, file, key, flip, sRGB, stream]() {
+			PROFILE_ZONE("Decode image");
+			Decoded image = { key, nullptr, 0, 0, 0, 0, false, sRGB, nullptr };
+			image.pixels = stbi_load(file.c_str(), &image.width, &image.height, &image.channels, 0);
+			if (image.pixels != nullptr && sRGB && image.channels <= 2) {
+				// core GL has no single channel sRGB format, grey is expanded to color to stay sRGB
+				std::cout << "Texture " << file << " is grey but loaded as sRGB, it is expanded to color" << std::endl;
+				stbi_image_free(image.pixels);
+				int channels = image.channels + 2;
+				image.pixels = stbi_load(file.c_str(), &image.width, &image.height, &image.channels, channels);
+				image.channels = channels;
+			}
+			if (image.pixels != nullptr) {
+				image.grey = image.channels <= 2;
+				if (!sRGB) {
+					reduceGrey(image);
+				}
+				if (flip) {
+					flipRows(image);
+				}
+			}
+			deliver(image, stream);
+		});
+
+		return texture;
+	}
+
+	// @dev pack the luminance of up to four images into the channels of one texture, e.g. a specular
+	// map in red and a mask in green, takes a reference
+	// @param paths Images of the same size, the first goes into red
+	// @param params Parameters the texture is created with, sRGB is ignored
+	// @return Id of the texture, 0 if there are more than four images
+	unsigned int loadPacked(const std::vector<std::string>& paths, const TextureParams& params = TextureParams()) {
+		if (paths.empty() || paths.size() > 4) {
+			std::cout << "Packed textures take one to four images, not " << paths.size() << std::endl;
+			return 0;
 		}
-		else {
-			std::cout << "Failed to load texture!" << std::endl;
+		if (params.sRGB) {
+			std::cout << "Packed textures hold linear data, sRGB is ignored for " << paths[0] << std::endl;
+		}
+		std::string key;
+		for (const std::string& path : paths) {
+			key += (key.empty() ? "" : "+") + canonicalPath(path.c_str());
+		}
+		key += paramsKey(params) + ",packed";
+		unsigned int texture = lookup(key);
+		if (texture != 0) {
+			return texture;
 		}
-		stbi_image_free(data);
-		
-		this->textures[size] = Texture(texture);
-		size++;
+		texture = create(params, GL_TEXTURE_2D);
+		beginLoading(texture, key, params, GL_TEXTURE_2D);
+
+		std::vector<std::string> files = paths;
+		bool flip = params.flip, stream = params.stream && params.mipmaps;
+		decoder.submit([this, files, key, flip, stream]() {
+			Decoded image = { key, nullptr, 0, 0, (int)files.size(), 0, false, false, nullptr };
+			for (int i = 0; i < image.channels; i++) {
+				int width, height, nrChannels;
+				unsigned char* grey = stbi_load(files[i].c_str(), &width, &height, &nrChannels, 1);
+				if (grey == nullptr || (image.pixels != nullptr && (width != image.width || height != image.height))) {
+					std::cout << "Failed to pack texture " << files[i] << std::endl;
+					stbi_image_free(grey);
+					free(image.pixels);
+					image.pixels = nullptr;
+					break;
+				}
+				// stb_image allocates with malloc, so the packed image is freed like a decoded one
+				if (image.pixels == nullptr) {
+					image.width = width;
+					image.height = height;
+					image.pixels = (unsigned char*)malloc((size_t)width * height * image.channels);
+				}
+				for (size_t texel = 0; texel < (size_t)width * height; texel++) {
+					image.pixels[texel * image.channels + i] = grey[texel];
+				}
+				stbi_image_free(grey);
+			}
+			if (image.pixels != nullptr && flip) {
+				flipRows(image);
+			}
+			deliver(image, stream);
+		});
 
 		return texture;
 	}
 
+	// @dev stack images into the layers of an array texture, takes a reference
+	// @param paths Images in layer order, decoded with the channels of the widest one and resized to
+	// the size of the first
+	// @param params Parameters the texture is created with
+	// @return Id of a GL_TEXTURE_2D_ARRAY texture
+	unsigned int loadArray(const std::vector<std::string>& paths, const TextureParams& params = TextureParams()) {
+		std::string key;
+		for (const std::string& path : paths) {
+			key += (key.empty() ? "" : "+") + canonicalPath(path.c_str());
+		}
+		key += paramsKey(params) + ",array";
+		unsigned int texture = lookup(key);
+		if (texture != 0) {
+			return texture;
+		}
+		texture = create(params, GL_TEXTURE_2D_ARRAY);
+		beginLoading(texture, key, params, GL_TEXTURE_2D_ARRAY);
+
+		std::vector<std::string> files = paths;
+		bool flip = params.flip, sRGB = params.sRGB, stream = params.stream && params.mipmaps;
+		decoder.submit([this, files, key, flip, sRGB, stream]() {
+			// layers share the format of the widest one, an array of grey maps keeps a single channel
+			Decoded image = { key, nullptr, 0, 0, sRGB ? 3 : 1, (int)files.size(), false, sRGB, nullptr };
+			std::vector<Decoded> decodedLayers;
+			for (const std::string& file : files) {
+				Decoded layer = { file, nullptr, 0, 0, 0, 0, false, sRGB, nullptr };
+				layer.pixels = stbi_load(file.c_str(), &layer.width, &layer.height, &layer.channels, 0);
+				if (layer.pixels == nullptr) {
+					std::cout << "Failed to load texture " << file << std::endl;
+					break;
+				}
+				if (!sRGB) {
+					reduceGrey(layer);
+				}
+				image.channels = std::max(image.channels, layer.channels);
+				decodedLayers.push_back(layer);
+			}
+			image.grey = image.channels <= 2;
+			for (int i = 0; i < (int)decodedLayers.size() && decodedLayers.size() == files.size(); i++) {
+				Decoded& layer = decodedLayers[i];
+				// stb_image converts layers with fewer channels
+				if (layer.channels != image.channels) {
+					stbi_image_free(layer.pixels);
+					int channels;
+					layer.pixels = stbi_load(files[i].c_str(), &layer.width, &layer.height, &channels, image.channels);
+					if (layer.pixels == nullptr) {
+						std::cout << "Failed to load texture " << files[i] << std::endl;
+						free(image.pixels);
+						image.pixels = nullptr;
+						break;
+					}
+				}
+				// stb_image allocates with malloc, so the stacked image is freed like a decoded one
+				if (image.pixels == nullptr) {
+					image.width = layer.width;
+					image.height = layer.height;
+					image.pixels = (unsigned char*)malloc((size_t)image.width * image.height * image.channels * image.layers);
+				}
+				unsigned char* target = image.pixels + (size_t)image.width * image.height * image.channels * i;
+				if (layer.width == image.width && layer.height == image.height) {
+					memcpy(target, layer.pixels, (size_t)layer.width * layer.height * image.channels);
+				}
+				else {
+					resize(layer.pixels, layer.width, layer.height, target, image.width, image.height, image.channels);
+				}
+			}
+			for (Decoded& layer : decodedLayers) {
+				stbi_image_free(layer.pixels);
+			}
+			if (image.pixels != nullptr && flip) {
+				flipRows(image);
+			}
+			deliver(image, stream);
+		});
+
+		return texture;
+	}
+
+	// @dev give back a reference taken by load, the texture stays cached until it has to be evicted
+	// @param textureId Id returned by load
+	void release(unsigned int textureId) {
+		auto found = keys.find(textureId);
+		if (found == keys.end()) {
+			return;
+		}
+		Texture& texture = textures[found->second];
+		if (texture.refCount > 0) {
+			texture.refCount--;
+		}
+		texture.lastUsed = ++clock;
+		evict();
+	}
+
+	// @dev pick up decoded images, continue uploads and stream mip levels, called once per frame on
+	// the render thread
+	void update() {
+		upload(uploadBudget);
+		stream(uploadBudget);
+	}
+
+	// @dev ask for the mip level a user of a streamed texture needs, from how many texels of it fall on
+	// a pixel at the closest point of the user
+	// @param uvDensity Texture repeats per world unit across the surface
+	// @param distance Distance from the eye to the closest point of the user
+	// @param pixelsPerUnit Pixels a world unit covers at a distance of one
+	void requestFootprint(unsigned int textureId, float uvDensity, float distance, float pixelsPerUnit) {
+		auto found = streams.find(textureId);
+		if (found == streams.end()) {
+			return;
+		}
+		Streamed& streamed = found->second;
+		float texels = uvDensity * (float)(streamed.width > streamed.height ? streamed.width : streamed.height);
+		float pixels = pixelsPerUnit / (distance > 0.001f ? distance : 0.001f);
+		// the finer level of the two the ratio falls between, degenerate users are clamped to a coarse level
+		float ratio = texels / pixels < 65536.0f ? texels / pixels : 65536.0f;
+		int level = ratio > 1.0f ? (int)floorf(log2f(ratio)) : 0;
+		if (streamed.lastRequested != streamFrame || level < streamed.requested) {
+			streamed.requested = level;
+		}
+		streamed.lastRequested = streamFrame;
+	}
+
+	// @dev block until every requested texture is uploaded
+	void finish() {
+		while (loading > 0) {
+			decoder.wait();
+			upload((size_t)-1);
+		}
+	}
+
+	// @dev stop decoding, drop unfinished uploads and delete every cached texture, called while the
+	// context is still current
+	void shutdown() {
+		decoder.stop();
+		for (Decoded& image : decoded) {
+			stbi_image_free(image.pixels);
+		}
+		decoded.clear();
+		for (Upload& pending : uploads) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pending.PBO);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glDeleteBuffers(1, &pending.PBO);
+			stbi_image_free(pending.image.pixels);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		uploads.clear();
+		for (auto& entry : textures) {
+			glDeleteTextures(1, &entry.second.textureId);
+		}
+		textures.clear();
+		keys.clear();
+		streams.clear();
+		residentBytes = 0;
+		streamedBytes = 0;
+		pendingLevels = 0;
+		baked = 0;
+	}
+
+	// @dev share of loads served from the cache
+	float hitRate() {
+		unsigned long requests = hits + misses;
+		return requests == 0 ? 0.0f : (float)hits / (float)requests;
+	}
+
+	// @dev number of resident textures
+	int size() {
+		return (int)textures.size();
+	}
+
+	// @dev resident textures, largest first
+	std::vector<const Texture*> list() {
+		std::vector<const Texture*> result;
+		for (auto& entry : textures) {
+			result.push_back(&entry.second);
+		}
+		std::sort(result.begin(), result.end(), [](const Texture* a, const Texture* b) {
+			return a->bytes > b->bytes;
+		});
+		return result;
+	}
+
+	// @dev file names a texture was loaded from
+	static std::string name(const Texture& texture) {
+		std::string paths = texture.key.substr(0, texture.key.find('|'));
+		std::string result;
+		size_t begin = 0;
+		while (begin <= paths.size()) {
+			size_t end = paths.find('+', begin);
+			end = end == std::string::npos ? paths.size() : end;
+			std::string path = paths.substr(begin, end - begin);
+			result += (result.empty() ? "" : "+") + path.substr(path.find_last_of("/\\") + 1);
+			begin = end + 1;
+		}
+		return result;
+	}
+
+	// @dev short name of an internal format
+	static const char* formatName(unsigned int format) {
+		switch (format) {
+		case GL_R8:
+			return "R8";
+		case GL_RG8:
+			return "RG8";
+		case GL_RGB8:
+			return "RGB8";
+		case GL_RGBA8:
+			return "RGBA8";
+		case GL_SRGB8:
+			return "SRGB8";
+		case GL_SRGB8_ALPHA8:
+			return "SRGB8_A8";
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+			return "BC1";
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+			return "BC3";
+		case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+			return "BC1 sRGB";
+		case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+			return "BC3 sRGB";
+		case GL_COMPRESSED_RED_RGTC1:
+			return "BC4";
+		default:
+			return "?";
+		}
+	}
+
 	// makes TextureManager an instance
 	static TextureManager* getInstance() {
 		if (instance == NULL) {
@@ -69,6 +507,589 @@ public:
 	}
 private:
 	static TextureManager* instance;
+
+	// @dev find a cached texture and take a reference
+	// @return Id of the texture, 0 on a miss
+	unsigned int lookup(const std::string& key) {
+		clock++;
+		auto found = textures.find(key);
+		if (found == textures.end()) {
+			misses++;
+			return 0;
+		}
+		hits++;
+		found->second.refCount++;
+		found->second.lastUsed = clock;
+		return found->second.textureId;
+	}
+
+	// @dev create and bind a texture with its sampling parameters
+	// @param target GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+	unsigned int create(const TextureParams& params, GLenum target) {
+		unsigned int texture;
+		// create texture
+		glGenTextures(1, &texture);
+		glBindTexture(target, texture);
+
+		// set texture wrapping parameters
+		glTexParameteri(target, GL_TEXTURE_WRAP_S, params.wrapS);
+		glTexParameteri(target, GL_TEXTURE_WRAP_T, params.wrapT);
+		// set texture filtering parameters
+		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, params.minFilter);
+		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, params.magFilter);
+		return texture;
+	}
+
+	// @dev give the bound texture a placeholder and cache it until its image arrives
+	void beginLoading(unsigned int texture, const std::string& key, const TextureParams& params, GLenum target) {
+		// placeholder until the image is uploaded, every layer of an array reads the single one
+		const unsigned char grey[3] = { 128, 128, 128 };
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		if (target == GL_TEXTURE_2D_ARRAY) {
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB8, 1, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, grey);
+		}
+		else {
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, grey);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		Texture entry(texture);
+		entry.target = target;
+		entry.key = key;
+		entry.mipmaps = params.mipmaps;
+		entry.loading = true;
+		entry.refCount = 1;
+		entry.lastUsed = clock;
+		entry.format = GL_RGB8;
+		entry.width = 1;
+		entry.height = 1;
+		textures[key] = entry;
+		keys[texture] = key;
+		loading++;
+		decoder.start();
+	}
+
+	// @dev evict unreferenced textures, least recently used first, until the budget is met
+	void evict() {
+		while (residentBytes > budgetBytes) {
+			Texture* victim = nullptr;
+			for (auto& entry : textures) {
+				Texture& texture = entry.second;
+				if (texture.refCount == 0 && !texture.loading && (victim == nullptr || texture.lastUsed < victim->lastUsed)) {
+					victim = &texture;
+				}
+			}
+			// everything left is in use
+			if (victim == nullptr) {
+				return;
+			}
+			std::string key = victim->key;
+			auto streamed = streams.find(victim->textureId);
+			if (streamed != streams.end()) {
+				streamedBytes -= victim->bytes;
+				streams.erase(streamed);
+			}
+			glDeleteTextures(1, &victim->textureId);
+			residentBytes -= victim->bytes;
+			baked -= victim->compressed ? 1 : 0;
+			evictions++;
+			keys.erase(victim->textureId);
+			textures.erase(key);
+		}
+	}
+
+	// @dev start uploads of newly decoded images and copy at most budget bytes into pixel buffers
+	void upload(size_t budget) {
+		std::vector<Decoded> arrived;
+		{
+			std::lock_guard<std::mutex> lock(decodedMutex);
+			arrived.swap(decoded);
+		}
+		for (Decoded& image : arrived) {
+			if (image.chain) {
+				beginStream(textures[image.key], image);
+				continue;
+			}
+			if (image.pixels == nullptr) {
+				std::cout << "Failed to load texture!" << std::endl;
+				finishLoading(textures[image.key], 0);
+				continue;
+			}
+			Upload pending = { image, 0, nullptr, (size_t)image.width * image.height * image.channels * (image.layers > 0 ? image.layers : 1), 0 };
+			glGenBuffers(1, &pending.PBO);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pending.PBO);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, pending.size, NULL, GL_STREAM_DRAW);
+			pending.mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, pending.size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			if (pending.mapped == nullptr) {
+				// out of mappable memory, fall back to a plain upload
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				glDeleteBuffers(1, &pending.PBO);
+				finishLoading(textures[image.key], specify(textures[image.key], image, image.pixels));
+				stbi_image_free(image.pixels);
+				continue;
+			}
+			// streamed images of the following iterations are specified from client memory
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			uploads.push_back(pending);
+		}
+
+		while (!uploads.empty() && budget > 0) {
+			Upload& pending = uploads.front();
+			size_t chunk = pending.size - pending.copied < budget ? pending.size - pending.copied : budget;
+			memcpy(pending.mapped + pending.copied, pending.image.pixels + pending.copied, chunk);
+			pending.copied += chunk;
+			budget -= chunk;
+			if (pending.copied < pending.size) {
+				break;
+			}
+			// complete, the driver transfers from the buffer without stalling us
+			Texture& texture = textures[pending.image.key];
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pending.PBO);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			size_t bytes = specify(texture, pending.image, (void*)0);
+			glDeleteBuffers(1, &pending.PBO);
+			stbi_image_free(pending.image.pixels);
+			uploads.erase(uploads.begin());
+			finishLoading(texture, bytes);
+		}
+		// unpacking from a buffer must not leak into other uploads
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	// @dev upload the mip chain of a baked container into the bound texture
+	// @param bytes Receives the video memory taken
+	// @return False if there is no container or its format is not supported, the caller decodes instead
+	bool loadBaked(const char* path, const TextureParams& params, Texture& texture, size_t& bytes) {
+		KtxFile ktx;
+		if (!ktx.open(TextureBaker::bakedPath(path).c_str())) {
+			return false;
+		}
+		// color maps sample the same blocks through the sRGB variant, BC4 has none
+		GLenum internalFormat = ktx.internalFormat;
+		if (params.sRGB) {
+			if (internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) {
+				internalFormat = GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+			}
+			else if (internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) {
+				internalFormat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+			}
+			else {
+				return false;
+			}
+		}
+		if (!supports(internalFormat)) {
+			return false;
+		}
+		int levels = params.mipmaps ? (int)ktx.levels.size() : 1;
+		for (int level = 0; level < levels; level++) {
+			int width = ktx.width >> level, height = ktx.height >> level;
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, width > 0 ? width : 1, height > 0 ? height : 1, 0, ktx.levelSizes[level], ktx.levels[level]);
+			bytes += ktx.levelSizes[level];
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+		size_t rgb = (size_t)ktx.width * ktx.height * 3;
+		rgb += params.mipmaps ? rgb / 3 : 0;
+		texture.format = internalFormat;
+		texture.width = ktx.width;
+		texture.height = ktx.height;
+		texture.savedBytes = (long long)rgb - (long long)bytes;
+		// single channel maps are sampled as grey
+		if (ktx.baseFormat == GL_RED) {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+		}
+		return true;
+	}
+
+	// @dev whether the driver can sample a compressed format
+	bool supports(GLenum internalFormat) {
+		if (internalFormat == GL_COMPRESSED_RED_RGTC1) {
+			return true;
+		}
+		if (s3tc == -1) {
+			s3tc = 0;
+			GLint count = 0;
+			glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+			for (GLint i = 0; i < count; i++) {
+				const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+				if (strcmp(extension, "GL_EXT_texture_compression_s3tc") == 0) {
+					s3tc = 1;
+				}
+			}
+		}
+		return s3tc == 1 && (internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+			|| internalFormat == GL_COMPRESSED_SRGB_S3TC_DXT1_EXT || internalFormat == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT);
+	}
+
+	// @dev replace the placeholder with the decoded image
+	// @param pixels Client memory, or an offset into the bound pixel unpack buffer
+	// @return Video memory taken by the texture
+	size_t specify(Texture& texture, const Decoded& image, const void* pixels) {
+		GLint internalFormat;
+		GLenum format;
+		chooseFormat(image.channels, image.sRGB, internalFormat, format);
+		GLenum target = texture.target;
+		int layers = image.layers > 0 ? image.layers : 1;
+		glBindTexture(target, texture.textureId);
+		// rows are tightly packed, their length decides the alignment they keep
+		glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment(image.width * image.channels));
+		if (target == GL_TEXTURE_2D_ARRAY) {
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, image.width, image.height, layers, 0, format, GL_UNSIGNED_BYTE, pixels);
+		}
+		else {
+			glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, pixels);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		if (image.grey) {
+			swizzleGrey(target, image.channels);
+		}
+		size_t bytes = (size_t)image.width * image.height * image.channels * layers;
+		size_t rgb = (size_t)image.width * image.height * 3 * layers;
+		if (texture.mipmaps) {
+			glGenerateMipmap(target);
+			// the whole chain adds a third
+			bytes += bytes / 3;
+			rgb += rgb / 3;
+		}
+		texture.format = internalFormat;
+		texture.width = image.width;
+		texture.height = image.height;
+		texture.layers = layers;
+		texture.savedBytes = (long long)rgb - (long long)bytes;
+		return bytes;
+	}
+
+	// @dev sample a grey texture as grey, alpha is the second channel
+	static void swizzleGrey(GLenum target, int channels) {
+		glTexParameteri(target, GL_TEXTURE_SWIZZLE_G, GL_RED);
+		glTexParameteri(target, GL_TEXTURE_SWIZZLE_B, GL_RED);
+		glTexParameteri(target, GL_TEXTURE_SWIZZLE_A, channels == 2 ? GL_GREEN : GL_ONE);
+	}
+
+	// @dev hand a decoded image to the render thread, builds the mip chain of streamed textures first
+	void deliver(Decoded& image, bool stream) {
+		if (image.pixels != nullptr && stream) {
+			int layers = image.layers > 0 ? image.layers : 1;
+			image.chain = std::make_shared<std::vector<std::vector<unsigned char>>>();
+			image.chain->push_back(std::vector<unsigned char>(image.pixels, image.pixels + (size_t)image.width * image.height * image.channels * layers));
+			stbi_image_free(image.pixels);
+			image.pixels = nullptr;
+			int width = image.width, height = image.height;
+			while (width > 1 || height > 1) {
+				image.chain->push_back(downsample(image.chain->back(), width, height, image.channels, layers));
+				width = width > 1 ? width / 2 : 1;
+				height = height > 1 ? height / 2 : 1;
+			}
+		}
+		std::lock_guard<std::mutex> lock(decodedMutex);
+		decoded.push_back(image);
+	}
+
+	// @dev next mip level of every layer with a 2x2 box filter
+	static std::vector<unsigned char> downsample(const std::vector<unsigned char>& level, int width, int height, int channels, int layers) {
+		int nextWidth = width > 1 ? width / 2 : 1, nextHeight = height > 1 ? height / 2 : 1;
+		std::vector<unsigned char> next((size_t)nextWidth * nextHeight * channels * layers);
+		for (int layer = 0; layer < layers; layer++) {
+			const unsigned char* source = &level[(size_t)width * height * channels * layer];
+			unsigned char* target = &next[(size_t)nextWidth * nextHeight * channels * layer];
+			for (int y = 0; y < nextHeight; y++) {
+				int y0 = y * 2 < height ? y * 2 : height - 1, y1 = y * 2 + 1 < height ? y * 2 + 1 : height - 1;
+				for (int x = 0; x < nextWidth; x++) {
+					int x0 = x * 2 < width ? x * 2 : width - 1, x1 = x * 2 + 1 < width ? x * 2 + 1 : width - 1;
+					for (int c = 0; c < channels; c++) {
+						int sum = source[((size_t)y0 * width + x0) * channels + c] + source[((size_t)y0 * width + x1) * channels + c]
+							+ source[((size_t)y1 * width + x0) * channels + c] + source[((size_t)y1 * width + x1) * channels + c];
+						target[((size_t)y * nextWidth + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+					}
+				}
+			}
+		}
+		return next;
+	}
+
+	// @dev replace the placeholder of a streamed texture with the coarse end of its mip chain
+	void beginStream(Texture& texture, Decoded& image) {
+		Streamed streamed;
+		streamed.levels.swap(*image.chain);
+		streamed.target = texture.target;
+		chooseFormat(image.channels, image.sRGB, streamed.internalFormat, streamed.format);
+		streamed.width = image.width;
+		streamed.height = image.height;
+		streamed.layers = image.layers > 0 ? image.layers : 1;
+		streamed.channels = image.channels;
+		int coarsest = (int)streamed.levels.size() - 1;
+		streamed.baseLevel = coarsest;
+		while (streamed.baseLevel > 0 && levelSize(streamed, streamed.baseLevel - 1) <= streamStartSize) {
+			streamed.baseLevel--;
+		}
+		streamed.startLevel = streamed.baseLevel;
+		streamed.wanted = streamed.baseLevel;
+		streamed.requested = streamed.baseLevel;
+		streamed.lastRequested = 0;
+
+		glBindTexture(streamed.target, texture.textureId);
+		size_t bytes = 0;
+		for (int level = streamed.baseLevel; level <= coarsest; level++) {
+			specifyLevel(streamed, level, true);
+			bytes += levelBytes(streamed, level);
+		}
+		glTexParameteri(streamed.target, GL_TEXTURE_BASE_LEVEL, streamed.baseLevel);
+		glTexParameteri(streamed.target, GL_TEXTURE_MAX_LEVEL, coarsest);
+		if (image.grey) {
+			swizzleGrey(streamed.target, image.channels);
+		}
+		texture.format = streamed.internalFormat;
+		texture.width = image.width;
+		texture.height = image.height;
+		texture.layers = streamed.layers;
+		texture.bytes = bytes;
+		updateSaved(texture, streamed);
+		streams[texture.textureId] = streamed;
+		streamedBytes += bytes;
+		finishLoading(texture, bytes);
+	}
+
+	// @dev move streamed textures toward the levels their users asked for
+	// @param budget Bytes uploaded per frame, the first level of a frame is uploaded regardless
+	void stream(size_t budget) {
+		// most missing levels first
+		std::vector<std::pair<unsigned int, Streamed*>> pending;
+		pendingLevels = 0;
+		for (auto& entry : streams) {
+			Streamed& streamed = entry.second;
+			// textures nobody drew need no more than their start level
+			int coarsest = (int)streamed.levels.size() - 1;
+			streamed.wanted = streamed.lastRequested != streamFrame ? streamed.startLevel : streamed.requested < coarsest ? streamed.requested : coarsest;
+			if (streamed.wanted < streamed.baseLevel) {
+				pending.push_back(std::make_pair(entry.first, &streamed));
+				pendingLevels += streamed.baseLevel - streamed.wanted;
+			}
+		}
+		std::sort(pending.begin(), pending.end(), [](const std::pair<unsigned int, Streamed*>& a, const std::pair<unsigned int, Streamed*>& b) {
+			return a.second->baseLevel - a.second->wanted > b.second->baseLevel - b.second->wanted;
+		});
+		bool uploaded = false;
+		for (auto& entry : pending) {
+			Streamed& streamed = *entry.second;
+			size_t bytes = levelBytes(streamed, streamed.baseLevel - 1);
+			if (uploaded && bytes > budget) {
+				break;
+			}
+			// make room with levels finer than their users need
+			while (streamedBytes + bytes > streamBudgetBytes && dropLevel(entry.first, true)) {}
+			if (streamedBytes + bytes > streamBudgetBytes) {
+				continue;
+			}
+			glBindTexture(streamed.target, entry.first);
+			streamed.baseLevel--;
+			specifyLevel(streamed, streamed.baseLevel, true);
+			glTexParameteri(streamed.target, GL_TEXTURE_BASE_LEVEL, streamed.baseLevel);
+			accountLevel(entry.first, (long long)bytes);
+			budget = bytes < budget ? budget - bytes : 0;
+			uploaded = true;
+			pendingLevels--;
+		}
+		// the budget may have been lowered, give up wanted levels of the least recently used last
+		while (streamedBytes > streamBudgetBytes && (dropLevel(0, true) || dropLevel(0, false))) {}
+		streamFrame++;
+	}
+
+	// @dev free the finest resident level of a streamed texture, least recently requested first, the
+	// start levels are kept
+	// @param except Texture that must keep its levels
+	// @param surplus Only drop levels finer than the texture's users need
+	// @return False if no level could be dropped
+	bool dropLevel(unsigned int except, bool surplus) {
+		unsigned int victimId = 0;
+		Streamed* victim = nullptr;
+		for (auto& entry : streams) {
+			Streamed& streamed = entry.second;
+			bool droppable = streamed.baseLevel < streamed.startLevel && (!surplus || streamed.baseLevel < streamed.wanted);
+			if (entry.first != except && droppable && (victim == nullptr || streamed.lastRequested < victim->lastRequested)) {
+				victimId = entry.first;
+				victim = &streamed;
+			}
+		}
+		if (victim == nullptr) {
+			return false;
+		}
+		glBindTexture(victim->target, victimId);
+		// a level of size zero releases its storage
+		specifyLevel(*victim, victim->baseLevel, false);
+		size_t bytes = levelBytes(*victim, victim->baseLevel);
+		victim->baseLevel++;
+		glTexParameteri(victim->target, GL_TEXTURE_BASE_LEVEL, victim->baseLevel);
+		accountLevel(victimId, -(long long)bytes);
+		return true;
+	}
+
+	// @dev upload a level of the bound streamed texture, or release it
+	void specifyLevel(const Streamed& streamed, int level, bool resident) {
+		int width = resident ? levelWidth(streamed, level) : 0;
+		int height = resident ? levelHeight(streamed, level) : 0;
+		const void* pixels = resident ? streamed.levels[level].data() : nullptr;
+		glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment(width * streamed.channels));
+		if (streamed.target == GL_TEXTURE_2D_ARRAY) {
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, level, streamed.internalFormat, width, height, resident ? streamed.layers : 0, 0, streamed.format, GL_UNSIGNED_BYTE, pixels);
+		}
+		else {
+			glTexImage2D(GL_TEXTURE_2D, level, streamed.internalFormat, width, height, 0, streamed.format, GL_UNSIGNED_BYTE, pixels);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+
+	// @dev account for levels of a streamed texture coming or going
+	void accountLevel(unsigned int textureId, long long bytes) {
+		Texture& texture = textures[keys[textureId]];
+		texture.bytes = (size_t)((long long)texture.bytes + bytes);
+		residentBytes = (size_t)((long long)residentBytes + bytes);
+		streamedBytes = (size_t)((long long)streamedBytes + bytes);
+		updateSaved(texture, streams[textureId]);
+	}
+
+	// @dev bytes saved against the whole chain in RGB8
+	static void updateSaved(Texture& texture, const Streamed& streamed) {
+		size_t rgb = (size_t)streamed.width * streamed.height * 3 * streamed.layers;
+		texture.savedBytes = (long long)(rgb + rgb / 3) - (long long)texture.bytes;
+	}
+
+	static int levelWidth(const Streamed& streamed, int level) {
+		return streamed.width >> level > 0 ? streamed.width >> level : 1;
+	}
+
+	static int levelHeight(const Streamed& streamed, int level) {
+		return streamed.height >> level > 0 ? streamed.height >> level : 1;
+	}
+
+	// @dev larger side of a level
+	static int levelSize(const Streamed& streamed, int level) {
+		return levelWidth(streamed, level) > levelHeight(streamed, level) ? levelWidth(streamed, level) : levelHeight(streamed, level);
+	}
+
+	static size_t levelBytes(const Streamed& streamed, int level) {
+		return (size_t)levelWidth(streamed, level) * levelHeight(streamed, level) * streamed.channels * streamed.layers;
+	}
+
+	// @dev sized internal format and pixel format for a number of 8 bit channels
+	static void chooseFormat(int channels, bool sRGB, GLint& internalFormat, GLenum& format) {
+		switch (channels) {
+		case 1:
+			internalFormat = GL_R8;
+			format = GL_RED;
+			break;
+		case 2:
+			internalFormat = GL_RG8;
+			format = GL_RG;
+			break;
+		case 3:
+			internalFormat = sRGB ? GL_SRGB8 : GL_RGB8;
+			format = GL_RGB;
+			break;
+		default:
+			internalFormat = sRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+			format = GL_RGBA;
+			break;
+		}
+	}
+
+	// @dev largest unpack alignment a row of the given length in bytes keeps
+	static int unpackAlignment(int stride) {
+		return stride % 8 == 0 ? 8 : stride % 4 == 0 ? 4 : stride % 2 == 0 ? 2 : 1;
+	}
+
+	// @dev keep a single channel, and alpha, of images whose color channels agree
+	static void reduceGrey(Decoded& image) {
+		if (image.channels < 3) {
+			return;
+		}
+		size_t count = (size_t)image.width * image.height;
+		for (size_t i = 0; i < count; i++) {
+			const unsigned char* texel = image.pixels + i * image.channels;
+			// jpeg chroma rounding leaves grey images off by a little
+			if (abs(texel[0] - texel[1]) > 2 || abs(texel[0] - texel[2]) > 2) {
+				return;
+			}
+		}
+		int channels = image.channels == 4 ? 2 : 1;
+		// compact in place, the write position never passes the read position
+		for (size_t i = 0; i < count; i++) {
+			const unsigned char* texel = image.pixels + i * image.channels;
+			unsigned char alpha = texel[image.channels - 1];
+			image.pixels[i * channels] = texel[1];
+			if (channels == 2) {
+				image.pixels[i * 2 + 1] = alpha;
+			}
+		}
+		image.channels = channels;
+		image.grey = true;
+	}
+
+	// @dev account for a texture whose image has arrived
+	void finishLoading(Texture& texture, size_t bytes) {
+		texture.loading = false;
+		texture.bytes = bytes;
+		residentBytes += bytes;
+		loading--;
+		evict();
+	}
+
+	// @dev turn a decoded image upside down, every layer on its own
+	static void flipRows(Decoded& image) {
+		size_t stride = (size_t)image.width * image.channels;
+		std::vector<unsigned char> row(stride);
+		for (int layer = 0; layer < (image.layers > 0 ? image.layers : 1); layer++) {
+			unsigned char* pixels = image.pixels + layer * stride * image.height;
+			for (int y = 0; y < image.height / 2; y++) {
+				unsigned char* top = pixels + y * stride;
+				unsigned char* bottom = pixels + (image.height - 1 - y) * stride;
+				memcpy(row.data(), top, stride);
+				memcpy(top, bottom, stride);
+				memcpy(bottom, row.data(), stride);
+			}
+		}
+	}
+
+	// @dev bilinear resize, texel centers are matched
+	static void resize(const unsigned char* source, int width, int height, unsigned char* target, int targetWidth, int targetHeight, int channels) {
+		for (int y = 0; y < targetHeight; y++) {
+			float sy = glm::clamp((y + 0.5f) * height / targetHeight - 0.5f, 0.0f, (float)(height - 1));
+			int y0 = (int)sy, y1 = y0 + 1 < height ? y0 + 1 : y0;
+			float fy = sy - y0;
+			for (int x = 0; x < targetWidth; x++) {
+				float sx = glm::clamp((x + 0.5f) * width / targetWidth - 0.5f, 0.0f, (float)(width - 1));
+				int x0 = (int)sx, x1 = x0 + 1 < width ? x0 + 1 : x0;
+				float fx = sx - x0;
+				for (int c = 0; c < channels; c++) {
+					float top = source[((size_t)y0 * width + x0) * channels + c] * (1.0f - fx) + source[((size_t)y0 * width + x1) * channels + c] * fx;
+					float bottom = source[((size_t)y1 * width + x0) * channels + c] * (1.0f - fx) + source[((size_t)y1 * width + x1) * channels + c] * fx;
+					target[((size_t)y * targetWidth + x) * channels + c] = (unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+				}
+			}
+		}
+	}
+
+	// @dev absolute path with the case and separators the file system does not tell apart normalized
+	static std::string canonicalPath(const char* path) {
+		char buffer[4096];
+#ifdef _WIN32
+		std::string canonical = _fullpath(buffer, path, sizeof(buffer)) != NULL ? buffer : path;
+		// separators and case do not matter on windows
+		for (char& c : canonical) {
+			c = c == '\\' ? '/' : (char)tolower((unsigned char)c);
+		}
+#else
+		std::string canonical = realpath(path, buffer) != NULL ? buffer : path;
+#endif
+		return canonical;
+	}
+
+	// @dev cache key part made of the load parameters
+	static std::string paramsKey(const TextureParams& params) {
+		return "|" + std::to_string(params.wrapS) + "," + std::to_string(params.wrapT)
+			+ "," + std::to_string(params.minFilter) + "," + std::to_string(params.magFilter)
+			+ "," + std::to_string(params.flip) + "," + std::to_string(params.mipmaps) + "," + std::to_string(params.sRGB)
+			+ "," + std::to_string(params.stream);
+	}
 };
 
-TextureManager* TextureManager::instance = NULL;
\ No newline at end of file
+TextureManager* TextureManager::instance = NULL;
@@ -0,0 +1,104 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// @dev Fixed set of worker threads running queued jobs in order of submission. Jobs must not touch
+// OpenGL, the context belongs to the render thread.
+class ThreadPool
+{
+public:
+	ThreadPool() {}
+	~ThreadPool() {
+		stop();
+	}
+
+	// @dev start the workers, does nothing if they are already running
+	// @param count Number of threads, 0 leaves one hardware thread to the render thread
+	void start(int count = 0) {
+		if (!workers.empty()) {
+			return;
+		}
+		if (count <= 0) {
+			count = (int)std::thread::hardware_concurrency() - 1;
+			count = count < 1 ? 1 : count;
+		}
+		stopping = false;
+		for (int i = 0; i < count; i++) {
+			workers.emplace_back([this]() { run(); });
+		}
+	}
+
+	// @dev queue a job
+	void submit(std::function<void()> job) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push(std::move(job));
+		}
+		wake.notify_one();
+	}
+
+	// @dev block until every submitted job has finished
+	void wait() {
+		std::unique_lock<std::mutex> lock(mutex);
+		idle.wait(lock, [this]() { return jobs.empty() && busy == 0; });
+	}
+
+	// @dev drop queued jobs, let running ones finish and join the workers
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+			std::queue<std::function<void()>>().swap(jobs);
+		}
+		wake.notify_all();
+		idle.notify_all();
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+		workers.clear();
+	}
+
+	// @dev number of workers
+	int size() {
+		return (int)workers.size();
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+	std::mutex mutex;
+	// signals new jobs and shutdown to the workers
+	std::condition_variable wake;
+	// signals finished jobs to wait
+	std::condition_variable idle;
+	// jobs being run
+	int busy = 0;
+	bool stopping = false;
+
+	// @dev worker loop
+	void run() {
+		for (;;) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+				if (stopping) {
+					return;
+				}
+				job = std::move(jobs.front());
+				jobs.pop();
+				busy++;
+			}
+			job();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				busy--;
+			}
+			idle.notify_all();
+		}
+	}
+};
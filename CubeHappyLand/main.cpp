@@ -1,6 +1,11 @@
 #include <iostream>
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <memory>
+#include <string>
 #include <vector>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -17,10 +22,33 @@
 #include "Light.h"
 #include "Cube.h"
 #include "Plane.h"
+#include "ObjectBuffer.h"
+#include "PointShadowAtlas.h"
+#include "DepthPrepass.h"
+#include "TextureBaker.h"
+#include "MaterialArray.h"
+#include "Batch2D.h"
+#include "Curve.h"
+#include "CurveBenchmark.h"
+#include "RasterView.h"
+#include "RasterBenchmark.h"
+#include "Shapes2D.h"
+#include "CanvasView.h"
+#include "FramePacer.h"
+#include "RenderThread.h"
+#include "HeadlessRenderer.h"
+#include "SceneBenchmark.h"
+#include "GpuTimer.h"
+#include "GLCounters.h"
+#include "GLCapture.h"
+#include "GLReplay.h"
+#include "Profiler.h"
 
 #define WINDOW_HEIGHT 1600
 #define WINDOW_WIDTH 1600
 #define DEFAULT_OPTION 0
+// most cubes the scene holds
+#define MAX_CUBES 1024
 
 #define PI 3.14
 
@@ -37,19 +65,23 @@ void processCursor(GLFWwindow *window);
 // dividebackground into grid
 void drawGrid(int rows, int cols, float* color, unsigned int& shaderProgram);
 // draw line from v1 to v2 using Bresenhem
-void myLineTo(float* v1, float* v2, float* color, unsigned int& shaderProgram);
+void myLineTo(float* v1, float* v2, float* color, Rasterizer& raster, unsigned int& shaderProgram);
 // draw circle at center with radius using Bresenhem
-void myCircleAt(float* center, float radius, float* color, unsigned int& shaderProgram);
-// draw square with primitive GL_TRIANLE
-void drawSquare2D(float xi_1, float yi_1, float edgeLength, float* color, unsigned int& shaderProgram);
+void myCircleAt(float* center, float radius, float* color, Rasterizer& raster);
+// pixel of the raster under a coordinate in normalized device space
+float rasterCoordinate(float ndc, const Rasterizer& raster);
+// show the raster of the Bresenham tools
+void presentRaster(const Rasterizer& raster, RasterView& view);
+// draw rounded square as an instanced shape
+void drawSquare2D(float xi_1, float yi_1, float edgeLength, float* color);
 // draw line with primitive GL_LINE
 void drawLine(float* v1, float* v2, float* color, unsigned int& shaderProgram);
-// draw circle with primitive GL_LINE_LOOP
-void drawCircle(float* center, float radius, float* color, int count, unsigned int& shaderProgram);
-// draw triangle with primitive GL_TRIANLE
-void drawTriangle(float* v1, float* v2, float* v3, float* color, unsigned int& shaderProgram);
-// draw Bezier curve
-void drawBezierCurve(float* controlPoints, int num, float t, float* color, unsigned int shaderProgram);
+// draw circle outline as an instanced shape
+void drawCircle(float* center, float radius, float* color);
+// draw triangle as an instanced shape
+void drawTriangle(float* v1, float* v2, float* v3, float* color);
+// hash transforms of shadow casters
+unsigned int transformSignature(Cube* cubes, int size);
 
 // mouse position
 double xPos = 0;
@@ -74,49 +106,191 @@ int key_grave_state = GLFW_RELEASE;
 
 
 // timing
-float deltaTime = 0.0f;
-float lastFrame = 0.0f;
-
-int main()
+double deltaTime = 0.0;
+
+// size of the framebuffer, the view port is set from it every frame
+int framebufferWidth = WINDOW_WIDTH;
+int framebufferHeight = WINDOW_HEIGHT;
+
+// statistics of the render thread shown by the UI, they come back with the frame packets
+typedef struct RenderStats {
+	int batchDrawCalls = 0;
+	int batchVertices = 0;
+	int shapeDrawCalls = 0;
+	int shapeInstances = 0;
+	int updatedLights = 0;
+	int culledFaces = 0;
+	float shadowPassTime = 0.0f;
+	float overdraw = 0.0f;
+	bool prepassActive = false;
+	int uploadedSlots = 0;
+	int materialDraws = 0;
+	int bindsSaved = 0;
+	size_t streamedBytes = 0;
+	int pendingLevels = 0;
+	int textures = 0;
+	int loading = 0;
+	int baked = 0;
+	size_t residentBytes = 0;
+	float hitRate = 0.0f;
+	// one line per resident texture
+	std::vector<std::string> textureMemory;
+}RenderStats;
+
+// shadow maps drawn by the shadow passes
+enum SHADOW_MODE { SHADOWS_OFF, SHADOWS_SUN, SHADOWS_ALL };
+
+// the 3D scene as it was when a frame was built, drawn while the main thread goes on changing its own objects
+typedef struct SceneFrame {
+	std::vector<Cube> cubes;
+	Plane plane;
+	Camera camera;
+	LightState sun;
+	LightState pointLight;
+	// point lights after the scene's own one
+	std::vector<LightState> extraLights;
+	int shadowMode = SHADOWS_ALL;
+	// 0 for Blinn-Phong, 1 for Phong
+	int shadingModel = 0;
+	glm::mat4 lightSpaceMatrix;
+	// object matrices changed since the frame before
+	ObjectUpload objectChanges;
+	// distance and texture density of every object, for the mip levels the materials need
+	std::vector<glm::vec2> footprints;
+	float pixelsPerUnit = 0.0f;
+	float slopeBias = 0.0f;
+	float constantBias = 0.0f;
+	bool cullFront = false;
+	int updateBudget = 1;
+	int prepassMode = 0;
+	// target of the lit pass, 0 for the window
+	GLuint framebuffer = 0;
+	int width = 0;
+	int height = 0;
+}SceneFrame;
+
+int main(int argc, char** argv)
 {
-
-	// ************************************* OpenGL window initialization ********************************
-	// set callback function
-	glfwSetErrorCallback(error_callback);
-	// init
-	if (!glfwInit()) {
-		// initialization failed!
-		glfwTerminate();
-		return 0;
+	PROFILE_THREAD("Main");
+	// offline texture compression, no window needed
+	if (argc > 2 && strcmp(argv[1], "--bake") == 0) {
+		return TextureBaker().bakeDirectory(argv[2]);
+	}
+	// throughput of the batch curve evaluator
+	if (argc > 1 && strcmp(argv[1], "--bench-curves") == 0) {
+		CurveBenchmark benchmark;
+		if (argc > 2) {
+			benchmark.curves = std::max(atoi(argv[2]), 1);
+		}
+		if (argc > 3) {
+			benchmark.params = std::max(atoi(argv[3]), 2);
+		}
+		return benchmark.run();
 	}
-	// using glfwWindowHint to configure GLFW
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-	// The following line is for Mac OS X to apply the configuration, or nothing works
-	// glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-
-	// create a window
-	GLFWwindow* window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Hello Window~", NULL, NULL);
-	if (window == NULL) {
-		cout << "Failed to create window!" << endl;
-		glfwTerminate();
-		return -1;
+	// a capture of GL calls replayed and timed without a window, see GLReplay for the options
+	if (argc > 1 && strcmp(argv[1], "--replay") == 0) {
+		GLReplay replay;
+		if (!GLReplay::parse(argc, argv, 2, replay.options)) {
+			return -1;
+		}
+		return replay.run();
 	}
-	glfwMakeContextCurrent(window);
 
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-		cout << "Failed to load GLAD!" << endl;
-		return -1;
+	// rasterizer against GL quads, drawn in a hidden window
+	bool benchRaster = argc > 1 && strcmp(argv[1], "--bench-raster") == 0;
+	// the 3D scene drawn into files without a window, see HeadlessRenderer for the options
+	bool headless = argc > 1 && strcmp(argv[1], "--headless") == 0;
+	HeadlessOptions headlessOptions;
+	HeadlessRenderer headlessRenderer;
+	// a generated 3D scene measured frame by frame, see SceneBenchmark for the options
+	bool benchScene = argc > 1 && strcmp(argv[1], "--bench-scene") == 0;
+	SceneBenchmark sceneBenchmark;
+	if (benchScene) {
+		if (!SceneBenchmark::parse(argc, argv, 2, sceneBenchmark.options)) {
+			return -1;
+		}
+		if (sceneBenchmark.options.cubes > MAX_CUBES) {
+			cout << "The benchmark scene holds at most " << MAX_CUBES << " cubes" << endl;
+			return -1;
+		}
 	}
+	// GL calls and objects accounted for from the first one on, see GLCounters
+	bool glAccounting = benchScene || (argc > 1 && strcmp(argv[1], "--gl-accounting") == 0);
+	// GL calls recorded for GLReplay from the first one on, see GLCapture
+	bool glCapture = (benchScene && !sceneBenchmark.options.capture.empty()) || (argc > 1 && strcmp(argv[1], "--gl-capture") == 0);
+
+	// ************************************* OpenGL window initialization ********************************
+	GLFWwindow* window = NULL;
+	if (headless || (benchScene && sceneBenchmark.options.headless)) {
+		// no window, the context has no surface and frames go to the target of the headless renderer
+		if ((headless && !HeadlessRenderer::parse(argc, argv, 2, headlessOptions)) || !headlessRenderer.createContext()) {
+			return -1;
+		}
+		if (!gladLoadGLLoader((GLADloadproc)HeadlessRenderer::getProcAddress)) {
+			cout << "Failed to load GLAD!" << endl;
+			return -1;
+		}
+		if (glAccounting) {
+			GLCounters::getInstance()->install();
+		}
+		if (glCapture) {
+			GLCapture::getInstance()->install();
+		}
+	}
+	else {
+		// set callback function
+		glfwSetErrorCallback(error_callback);
+		// init
+		if (!glfwInit()) {
+			// initialization failed!
+			glfwTerminate();
+			return 0;
+		}
+		// using glfwWindowHint to configure GLFW
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		if (benchRaster || benchScene) {
+			glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		}
+
+		// The following line is for Mac OS X to apply the configuration, or nothing works
+		// glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+
+		// create a window
+		window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Hello Window~", NULL, NULL);
+		if (window == NULL) {
+			cout << "Failed to create window!" << endl;
+			glfwTerminate();
+			return -1;
+		}
+		glfwMakeContextCurrent(window);
 
-	// tell OpenGL the size of the window for renderring
-	// set offset and dimension
-	glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+			cout << "Failed to load GLAD!" << endl;
+			return -1;
+		}
+		if (glAccounting) {
+			GLCounters::getInstance()->install();
+		}
+		if (glCapture) {
+			GLCapture::getInstance()->install();
+		}
+		if (benchRaster) {
+			Shader graph2D(vertexShaderSource, fragmentShaderSource);
+			int result = RasterBenchmark().run(graph2D.ID);
+			Batch2D::getInstance()->destroy();
+			glfwTerminate();
+			return result;
+		}
+
+		// tell OpenGL the size of the window for renderring
+		// set offset and dimension
+		glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 
-	// register callback function
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+		// register callback function
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+	}
 
 
 	// enable depth test
@@ -138,13 +312,18 @@ int main()
 	// for "Bresenhem Circle"
 	// center for "Bresenmen Circle"
 	float center[] = {0.0f, 0.0f};
+	// the Bresenham tools draw into a raster, pixel centers sit on the grid lines at its lowest resolution
+	Rasterizer raster;
+	RasterView rasterView;
+	int rasterPixels = 21;
+	bool fillTriangle = false;
 	// radius for circle
 	float radius = 0.5f;
 	// edge length for square as a point
 	float edge = 0.1f;
 
 	// for Bezier
-	float controlPoints[100];
+	std::vector<float> controlPoints;
 	int numberOfCP = 0;
 	// status
 	enum PLAY_STATUS {MODIFYING, PLAYING, PAUSE};
@@ -154,12 +333,22 @@ int main()
 	float t = 0;
 	// color
 	float bezierCol[3] = { 0.4f, 0.5f, 0.31f };
+	// curve through the control points, flattened once per change
+	Curve bezier;
+	bezier.setViewport(WINDOW_WIDTH, WINDOW_HEIGHT);
+	int curveType = Curve::BEZIER;
+
+	// for the canvas, a drawing in world units shown through cached tiles
+	Canvas2D canvas;
+	CanvasView canvasView;
+	bool canvasDragging = false;
+	double canvasDragX = 0, canvasDragY = 0;
 
 	// camera
 	camera.aspect = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
 
 	// cubes
-	Cube cubes[100];
+	std::vector<Cube> cubes(MAX_CUBES);
 	int size = 0;
 	Cube* currentObject = new Cube();
 
@@ -172,7 +361,7 @@ int main()
 	// color of object
 	glm::vec3 objectColor = { 1.0f, 0.5f, 0.31f };
 	// lights
-	Light sourceLight(glm::vec3(0.0f, 0.0f, 0.0f), lightColor, POINT_LIGHT);
+	Light sourceLight(glm::vec3(2.0f, 3.0f, 2.0f), lightColor, POINT_LIGHT);
 	Light paralLight(glm::vec3(0.0f, 4.0f, 0.0f), lightColor, PARALELL_LIGHT);
 
 	// shaders
@@ -185,7 +374,18 @@ int main()
 	Shader gouraud(gouraud_vertex_shader, gouraud_fragment_shader);
 	Shader blinn(blinn_vertex_shader, blinn_fragment_shader);
 	Shader depth(depth_vertex, depth_fragment);
+	Shader pointShadow(point_shadow_vertex, point_shadow_fragment, point_shadow_geometry);
+	Shader prepass(prepass_vertex, depth_fragment);
 	Shader currentShader = blinn;
+	// object matrices are read from the object buffer
+	ObjectBuffer* objectBuffer = ObjectBuffer::getInstance();
+	objectBuffer->initialize();
+	objectBuffer->bindProgram(phong);
+	objectBuffer->bindProgram(gouraud);
+	objectBuffer->bindProgram(blinn);
+	objectBuffer->bindProgram(depth);
+	objectBuffer->bindProgram(pointShadow);
+	objectBuffer->bindProgram(prepass);
 
 	// textures
 	// get texture manager's instance
@@ -194,10 +394,17 @@ int main()
 	GLuint container = textureManager->load("Resources/Materials/Textures/container.jpg");
 	cube.setInt("myTexture", container);
 	
-	// load diffuse texture and specular texture for light model scene
-	GLuint floorTexture = textureManager->load("Resources/Materials/Textures/wall.jpg");
-	GLuint diffuseTexture = textureManager->load("Resources/Materials/Textures/container2.jpg");
-	GLuint specularTexture = textureManager->load("Resources/Materials/Textures/container2_specular.jpg");
+	// diffuse and specular maps of the light model scene, every map is a layer of an array texture
+	MaterialArray materials;
+	int wallMaterial = materials.add("Wall", "Resources/Materials/Textures/wall.jpg", "Resources/Materials/Textures/wall.jpg");
+	int containerMaterial = materials.add("Container", "Resources/Materials/Textures/container2.jpg", "Resources/Materials/Textures/container2_specular.jpg");
+	materials.add("Crate", "Resources/Materials/Textures/container.jpg", "Resources/Materials/Textures/container.jpg");
+	materials.load();
+	materials.apply(plane, wallMaterial);
+	std::vector<const char*> materialNames;
+	for (const MaterialArray::Material& material : materials.materials) {
+		materialNames.push_back(material.name.c_str());
+	}
 
 	// Configure depth map FBO
 	const GLuint SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
@@ -222,6 +429,26 @@ int main()
 	glReadBuffer(GL_NONE);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+	// omnidirectional shadow maps of point lights
+	PointShadowAtlas pointShadows;
+	pointShadows.initialize(512);
+	int sourceLightSlot = pointShadows.allocate();
+	// redraw point shadows whenever a caster moves
+	unsigned int casterSignature = 0;
+
+	// slope scaled depth bias applied while rendering shadow maps
+	float shadowSlopeBias = 2.0f;
+	float shadowConstantBias = 4.0f;
+	// cull front faces of closed casters in the shadow passes
+	bool shadowCullFront = false;
+	// time spent on the GPU by every pass, read back frames later so we never wait for it
+	GpuTimer* gpuTimer = GpuTimer::getInstance();
+	gpuTimer->initialize();
+
+	// depth prepass of the lit pass, switched on automatically when overdraw is high
+	DepthPrepass depthPrepass;
+	depthPrepass.initialize();
+
 	glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 
 	// pass textures
@@ -242,17 +469,442 @@ int main()
 	phong.setFloat("light.quadratic", 0.032f);
 
 	blinn.use();
-	blinn.setInt("material.diffuse", 0);
-	blinn.setInt("material.specular", 1);
+	blinn.setInt("material.maps", 0);
+	blinn.setInt("material.specularMaps", 1);
+	blinn.setFloat("material.colorLayers", (float)materials.colorLayers);
 	blinn.setInt("shadowMap", 2);
 	blinn.setFloat("light.constant", 1.0f);
 	blinn.setFloat("light.linear", 0.09f);
 	blinn.setFloat("light.quadratic", 0.032f);
+	blinn.setInt("pointShadowMap", 3);
+	blinn.setFloat("pointShadowNear", pointShadows.nearPlane);
+	blinn.setFloat("pointShadowFar", pointShadows.farPlane);
+	// atlas slots of the point lights after the scene's own one, owned by the thread drawing the scene
+	std::vector<int> extraLightSlots;
 
 	// render a shadow texture
 	// cut off plane for light's perspective
 	GLfloat near_plane = 1.0f, far_plane = 7.5f;
 
+	// lights, shadows, the prepass and textures belong to the render thread while it runs, the UI
+	// edits these copies and every frame's commands take them along
+	LightState sunState = paralLight.state();
+	LightState pointLightState = sourceLight.state();
+	int shadowUpdateBudget = pointShadows.updateBudget;
+	int prepassMode = depthPrepass.mode;
+	size_t streamBudgetBytes = textureManager->streamBudgetBytes;
+	std::vector<LightState> extraLightStates;
+	int shadowMode = SHADOWS_ALL;
+	int shadingModel = 0;
+
+	// the 3D scene as it is now for a frame of the given size, object matrices are brought up to date
+	// and their changes collected on the way
+	auto buildScene = [&](int width, int height) {
+		PROFILE_ZONE("Build scene");
+		SceneFrame frame;
+		frame.width = width;
+		frame.height = height;
+		// transformation matrix from world space to light's perspective space
+		// projection from light's perspective
+		glm::mat4 lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, near_plane, far_plane);
+		// parallel light
+		glm::mat4 lightView = glm::lookAt(sunState.position, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		frame.lightSpaceMatrix = lightProjection * lightView;
+		// transform stage, matrices are only recomputed for objects that moved or after the camera moved
+		glm::mat4 view = glm::lookAt(camera.transform.position, -camera.transform.forward + camera.transform.position, camera.transform.up);
+		glm::mat4 projection = glm::perspective(glm::radians(camera.fovy), camera.aspect, camera.zNear, camera.zFar);
+		glm::mat4 viewProjection = projection * view;
+		plane.updateConstants(viewProjection);
+		for (int i = 0; i < size; i++) {
+			cubes[i].updateConstants(viewProjection);
+		}
+		// the changed matrices travel with the frame
+		objectBuffer->collect(frame.objectChanges);
+		// footprint of the objects on screen, distance and texture density, for the mip levels the materials need
+		frame.pixelsPerUnit = height / (2.0f * tan(glm::radians(camera.fovy) * 0.5f));
+		frame.footprints.push_back(glm::vec2(plane.distanceTo(camera.transform.position), plane.uvDensity()));
+		for (int i = 0; i < size; i++) {
+			frame.footprints.push_back(glm::vec2(cubes[i].distanceTo(camera.transform.position), cubes[i].uvDensity()));
+		}
+		// the main thread goes on changing its own objects while the frame is drawn
+		frame.cubes.assign(cubes.begin(), cubes.begin() + size);
+		frame.plane = plane;
+		frame.camera = camera;
+		frame.sun = sunState;
+		frame.pointLight = pointLightState;
+		frame.extraLights = extraLightStates;
+		frame.shadowMode = shadowMode;
+		frame.shadingModel = shadingModel;
+		frame.slopeBias = shadowSlopeBias;
+		frame.constantBias = shadowConstantBias;
+		frame.cullFront = shadowCullFront;
+		frame.updateBudget = shadowUpdateBudget;
+		frame.prepassMode = prepassMode;
+		return frame;
+	};
+	// shadow passes and the lit pass of a scene snapshot, on the thread owning the context, what the UI
+	// shows of them goes into the statistics
+	auto drawScene = [&](SceneFrame& frame, RenderStats& stats) {
+		PROFILE_ZONE("Draw scene");
+		paralLight.apply(frame.sun);
+		sourceLight.apply(frame.pointLight);
+		objectBuffer->upload(frame.objectChanges);
+		for (const glm::vec2& footprint : frame.footprints) {
+			materials.request(footprint.x, footprint.y, frame.pixelsPerUnit);
+		}
+		pointShadows.updateBudget = frame.updateBudget;
+		depthPrepass.mode = frame.prepassMode;
+		int shadowScope = gpuTimer->begin("Shadow");
+		// depth only state, acne is fought with a slope scaled offset instead of a bias in the lit shader
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(frame.slopeBias, frame.constantBias);
+		if (frame.cullFront) {
+			glEnable(GL_CULL_FACE);
+			glCullFace(GL_FRONT);
+		}
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		// - now render scene from light's point of view
+		depth.use();
+		glUniformMatrix4fv(glGetUniformLocation(depth.ID, "lightSpaceMatrix"), 1, GL_FALSE, glm::value_ptr(frame.lightSpaceMatrix));
+
+		glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+		glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		// without shadows the cleared map shadows nothing
+		if (frame.shadowMode != SHADOWS_OFF) {
+			// render plane with depth texture renderred above
+			frame.plane.render(depth);
+			// render cubes
+			for (int i = 0; i < (int)frame.cubes.size(); i++) {
+				frame.cubes[i].render(depth);
+			}
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		// point light shadows, only out of date maps are redrawn and no more than the update budget
+		pointShadows.beginFrame();
+		pointShadows.setPosition(sourceLightSlot, sourceLight.transform.position);
+		// the other point lights take slots as they appear and give them back as they go
+		while (extraLightSlots.size() < frame.extraLights.size()) {
+			int slot = pointShadows.allocate();
+			if (slot == -1) {
+				break;
+			}
+			extraLightSlots.push_back(slot);
+		}
+		while (extraLightSlots.size() > frame.extraLights.size()) {
+			pointShadows.release(extraLightSlots.back());
+			extraLightSlots.pop_back();
+		}
+		for (int i = 0; i < (int)extraLightSlots.size(); i++) {
+			pointShadows.setPosition(extraLightSlots[i], frame.extraLights[i].position);
+		}
+		{
+			unsigned int signature = transformSignature(frame.cubes.data(), (int)frame.cubes.size());
+			if (signature != casterSignature) {
+				casterSignature = signature;
+				pointShadows.invalidate();
+			}
+		}
+		if (frame.shadowMode == SHADOWS_ALL && (sourceLight.visible || !extraLightSlots.empty())) {
+			for (int slot = pointShadows.next(); slot != -1; slot = pointShadows.next()) {
+				pointShadows.begin(slot, pointShadow);
+				// the floor only receives shadows, cubes are culled against each face of the light
+				for (int i = 0; i < (int)frame.cubes.size(); i++) {
+					int faceMask = pointShadows.faceMask(pointShadows.position(slot), frame.cubes[i].transform.position, frame.cubes[i].boundingRadius());
+					if (faceMask == 0) {
+						continue;
+					}
+					pointShadow.setInt("faceMask", faceMask);
+					frame.cubes[i].render(pointShadow);
+				}
+				pointShadows.end(slot);
+			}
+		}
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDisable(GL_CULL_FACE);
+		glCullFace(GL_BACK);
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		gpuTimer->end(shadowScope);
+
+		// render cubes with depth texture renderred above
+		int litScope = gpuTimer->begin("Lit");
+		glBindFramebuffer(GL_FRAMEBUFFER, frame.framebuffer);
+		glViewport(0, 0, frame.width, frame.height);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		// lay down the depth of opaque geometry first so hidden fragments are never shaded
+		if (depthPrepass.beginFrame()) {
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			depthPrepass.beginPrepass();
+			frame.plane.render(prepass);
+			for (int i = 0; i < (int)frame.cubes.size(); i++) {
+				frame.cubes[i].render(prepass);
+			}
+			depthPrepass.endPrepass();
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		}
+		depthPrepass.beginLitPass();
+		blinn.use();
+		glUniformMatrix4fv(glGetUniformLocation(blinn.ID, "lightSpaceMatrix"), 1, GL_FALSE, glm::value_ptr(frame.lightSpaceMatrix));
+		blinn.setInt("shadingModel", frame.shadingModel);
+		// point lights, the scene's own one first, lights without a shadow map have layer -1
+		int pointLightCount = 0;
+		if (sourceLight.visible) {
+			blinn.setVec3("pointLights[0].position", sourceLight.transform.position);
+			blinn.setVec3("pointLights[0].color", sourceLight.lightColor);
+			blinn.setInt("pointLights[0].shadowLayer", frame.shadowMode == SHADOWS_ALL ? pointShadows.layer(sourceLightSlot) : -1);
+			pointLightCount++;
+		}
+		for (int i = 0; i < (int)extraLightSlots.size(); i++) {
+			std::string name = "pointLights[" + std::to_string(pointLightCount) + "]";
+			blinn.setVec3(name + ".position", frame.extraLights[i].position);
+			blinn.setVec3(name + ".color", frame.extraLights[i].color);
+			blinn.setInt(name + ".shadowLayer", frame.shadowMode == SHADOWS_ALL ? pointShadows.layer(extraLightSlots[i]) : -1);
+			pointLightCount++;
+		}
+		blinn.setInt("pointLightCount", pointLightCount);
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, pointShadows.depthArray);
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, depthTexture);
+		// every material is in the array, objects pick their layers through their constants
+		materials.bind(GL_TEXTURE0, GL_TEXTURE1);
+		// render plane with depth texture renderred above
+		frame.plane.render(frame.camera, paralLight, blinn);
+		materials.draw(frame.plane);
+		// render cubes
+		for (int i = 0; i < (int)frame.cubes.size(); i++) {
+			frame.cubes[i].render(frame.camera, paralLight, blinn);
+			materials.draw(frame.cubes[i]);
+		}
+		depthPrepass.endLitPass();
+		gpuTimer->end(litScope);
+		// icon of the point light
+		if (sourceLight.visible) {
+			int iconScope = gpuTimer->begin("Light icon");
+			sourceLight.render(frame.camera);
+			gpuTimer->end(iconScope);
+		}
+
+		// what the UI shows of this frame
+		stats.updatedLights = pointShadows.updatedLights;
+		stats.culledFaces = pointShadows.culledFaces;
+		stats.shadowPassTime = gpuTimer->time("Shadow");
+		stats.overdraw = depthPrepass.overdraw;
+		stats.prepassActive = depthPrepass.active;
+		stats.uploadedSlots = objectBuffer->uploadedSlots;
+		stats.materialDraws = materials.draws;
+		stats.bindsSaved = materials.bindsSaved;
+		stats.streamedBytes = textureManager->streamedBytes;
+		stats.pendingLevels = textureManager->pendingLevels;
+		stats.textures = textureManager->size();
+		stats.loading = textureManager->loading;
+		stats.baked = textureManager->baked;
+		stats.residentBytes = textureManager->residentBytes;
+		stats.hitRate = textureManager->hitRate();
+		for (const Texture* texture : textureManager->list()) {
+			char line[256];
+			snprintf(line, sizeof(line), "%s: %s %dx%d, %.0f KB, saved %.0f KB", TextureManager::name(*texture).c_str(), TextureManager::formatName(texture->format), texture->width, texture->height, texture->bytes / 1024.0f, texture->savedBytes / 1024.0f);
+			stats.textureMemory.push_back(line);
+		}
+	};
+
+	// resources of the scene, released after the main loop or a headless run
+	auto releaseScene = [&]() {
+		for (Shader* shader : { &cube, &graph2D, &texture, &phong, &gouraud, &blinn, &depth, &pointShadow, &prepass }) {
+			glDeleteProgram(shader->ID);
+		}
+		sourceLight.destroy();
+		paralLight.destroy();
+		materials.release();
+		Batch2D::getInstance()->destroy();
+		Shapes2D::getInstance()->destroy();
+		rasterView.destroy();
+		canvasView.destroy();
+		textureManager->shutdown();
+		pointShadows.destroy();
+		gpuTimer->destroy();
+		depthPrepass.destroy();
+		Cube::depthStream.destroy();
+		Plane::depthStream.destroy();
+		Cube::mesh.destroy();
+		Plane::mesh.destroy();
+		objectBuffer->destroy();
+		glDeleteFramebuffers(1, &depthMapFBO);
+		glDeleteTextures(1, &depthTexture);
+	};
+
+	// ***************************************** headless ***********************************************
+	if (headless) {
+		// a ring of cubes around the origin or a 10 x 10 grid of small ones on the floor
+		int materialCount = (int)materials.materials.size();
+		if (headlessOptions.scene == "cubes") {
+			for (int i = 0; i < 6; i++) {
+				float angle = i * 2.0f * (float)PI / 6.0f;
+				Cube newCube({ 2.5f * cos(angle), 0.5f, 2.5f * sin(angle) }, { 0.0f, i * 15.0f, 0.0f }, { 1.0f, 1.0f, 1.0f });
+				materials.apply(newCube, i % materialCount);
+				cubes[size] = newCube;
+				size++;
+			}
+		}
+		else if (headlessOptions.scene == "grid") {
+			for (int i = 0; i < 100; i++) {
+				Cube newCube({ (i % 10 - 4.5f) * 0.9f, 0.25f, (i / 10 - 4.5f) * 0.9f }, { 0.0f, i * 7.0f, 0.0f }, { 0.5f, 0.5f, 0.5f });
+				materials.apply(newCube, i % materialCount);
+				cubes[size] = newCube;
+				size++;
+			}
+		}
+		int width = headlessOptions.width, height = headlessOptions.height;
+		camera.fovy = headlessOptions.fovy;
+		camera.aspect = (float)width / (float)height;
+		if (!headlessRenderer.createTarget(width, height)) {
+			releaseScene();
+			headlessRenderer.destroy();
+			return -1;
+		}
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glm::vec3 offset = headlessOptions.eye - headlessOptions.target;
+		RenderStats headlessStats;
+		int written = 0, warmup = 0;
+		bool failed = false;
+		double drawSeconds = 0.0, writeSeconds = 0.0;
+		while (written < headlessOptions.frames && !failed) {
+			// the eye turns around the vertical axis through the target, the view looks against forward
+			float angle = glm::radians(headlessOptions.orbit * written);
+			glm::vec3 eye = headlessOptions.target + glm::vec3(offset.x * cos(angle) + offset.z * sin(angle), offset.y, offset.z * cos(angle) - offset.x * sin(angle));
+			camera.transform.position = eye;
+			camera.transform.forward = glm::normalize(eye - headlessOptions.target);
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			textureManager->update();
+			SceneFrame sceneFrame = buildScene(width, height);
+			sceneFrame.framebuffer = headlessRenderer.framebuffer;
+			headlessStats = RenderStats();
+			gpuTimer->beginFrame();
+			drawScene(sceneFrame, headlessStats);
+			gpuTimer->endFrame();
+			glFinish();
+			std::chrono::steady_clock::time_point drawn = std::chrono::steady_clock::now();
+			// frames with textures still loading or mip levels still streaming would differ from run to run
+			if ((headlessStats.loading > 0 || headlessStats.pendingLevels > 0) && warmup < headlessOptions.warmup) {
+				warmup++;
+				continue;
+			}
+			drawSeconds += std::chrono::duration<double>(drawn - start).count();
+			if (!headlessOptions.output.empty()) {
+				failed = !headlessRenderer.save(HeadlessRenderer::framePath(headlessOptions.output, written));
+			}
+			writeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - drawn).count();
+			written++;
+		}
+		if (written > 0) {
+			cout << written << " frames of " << width << "x" << height << " after " << warmup << " warmup frames, "
+				<< drawSeconds * 1000.0 / written << " ms drawing and " << writeSeconds * 1000.0 / written << " ms writing per frame" << endl;
+		}
+		releaseScene();
+		headlessRenderer.destroy();
+		return failed ? -1 : 0;
+	}
+
+	// ************************************** scene benchmark *******************************************
+	if (benchScene) {
+		const SceneBenchmarkOptions& options = sceneBenchmark.options;
+		int materialCount = (int)materials.materials.size();
+		for (int i = 0; i < options.cubes; i++) {
+			Cube newCube(sceneBenchmark.cubePosition(i), { 0.0f, i * 7.0f, 0.0f }, glm::vec3(sceneBenchmark.cubeScale()));
+			materials.apply(newCube, i % materialCount);
+			cubes[size] = newCube;
+			size++;
+		}
+		// the scene's point light is the first of the lights
+		pointLightState.visible = options.lights > 0;
+		pointLightState.position = sceneBenchmark.lightPosition(0);
+		for (int i = 1; i < options.lights; i++) {
+			LightState light = pointLightState;
+			light.position = sceneBenchmark.lightPosition(i);
+			extraLightStates.push_back(light);
+		}
+		shadingModel = options.shading == "phong" ? 1 : 0;
+		shadowMode = options.shadows == "off" ? SHADOWS_OFF : options.shadows == "sun" ? SHADOWS_SUN : SHADOWS_ALL;
+		camera.aspect = (float)options.width / (float)options.height;
+		if (!headlessRenderer.createTarget(options.width, options.height)) {
+			releaseScene();
+			headlessRenderer.destroy();
+			return -1;
+		}
+		sceneBenchmark.initialize();
+		RenderStats benchmarkStats;
+		int frame = 0, loadingFrames = 0;
+		if (!options.pipeline.empty()) {
+			// packets built and drawn like the main loop's, the render thread owns the context meanwhile
+			RenderThread renderThread;
+			renderThread.threaded = options.pipeline == "threaded";
+			glfwSwapInterval(0);
+			renderThread.start(window);
+			while (frame < options.warmup + options.frames) {
+				bool measured = frame >= options.warmup;
+				glm::vec3 eye = sceneBenchmark.eye(measured ? frame - options.warmup : 0);
+				camera.transform.position = eye;
+				camera.transform.forward = glm::normalize(eye);
+				renderThread.begin();
+				sceneBenchmark.beginPacket(measured, renderThread.buildTime, renderThread.submitTime);
+				std::shared_ptr<RenderStats> frameStats = std::make_shared<RenderStats>();
+				renderThread.complete([frameStats, &benchmarkStats]() { benchmarkStats = *frameStats; });
+				renderThread.submit([textureManager]() { textureManager->update(); });
+				SceneFrame sceneFrame = buildScene(options.width, options.height);
+				sceneFrame.framebuffer = headlessRenderer.framebuffer;
+				renderThread.submit([frame = std::move(sceneFrame), frameStats, &drawScene]() mutable {
+					drawScene(frame, *frameStats);
+					// a frame ends when the GPU has finished it, like the direct runs
+					glFinish();
+				});
+				renderThread.end(NULL);
+				// the statistics come back packets later, warmup lasts until they show no loading texture
+				if (!measured && benchmarkStats.loading > 0 && loadingFrames < 1000) {
+					loadingFrames++;
+					continue;
+				}
+				frame++;
+			}
+			// the last frame ends once the render thread has drawn it
+			renderThread.stop();
+			sceneBenchmark.beginPacket(false, renderThread.buildTime, renderThread.submitTime);
+		}
+		while (frame < options.warmup + options.frames) {
+			bool measured = frame >= options.warmup;
+			// the warmup frames look at the scene from where the flight starts
+			glm::vec3 eye = sceneBenchmark.eye(measured ? frame - options.warmup : 0);
+			camera.transform.position = eye;
+			camera.transform.forward = glm::normalize(eye);
+			if (frame == options.warmup && glCapture) {
+				GLCapture::getInstance()->begin(options.capture, options.frames, options.width, options.height);
+			}
+			sceneBenchmark.beginFrame();
+			textureManager->update();
+			SceneFrame sceneFrame = buildScene(options.width, options.height);
+			sceneFrame.framebuffer = headlessRenderer.framebuffer;
+			benchmarkStats = RenderStats();
+			drawScene(sceneFrame, benchmarkStats);
+			sceneBenchmark.endRecording();
+			sceneBenchmark.endFrame(measured);
+			// frames drawn while textures are still loading are not part of the warmup
+			if (!measured && benchmarkStats.loading > 0 && loadingFrames < 1000) {
+				loadingFrames++;
+				continue;
+			}
+			frame++;
+		}
+		// released first, what GL still holds is reported as leaked
+		releaseScene();
+		headlessRenderer.destroyTarget();
+		int result = sceneBenchmark.report();
+		headlessRenderer.destroy();
+		if (window != NULL) {
+			glfwTerminate();
+		}
+		return result;
+	}
+
 	// ******************************************* UI ***************************************************
 	// setup dear gui context
 	ImGui::CreateContext();
@@ -263,28 +915,72 @@ int main()
 	ImGui_ImplGlfw_InitForOpenGL(window, true);
 	// GLSL version
 	ImGui_ImplOpenGL3_Init("#version 330");
+	// swap interval and frame limit, waiting happens before input is read
+	FramePacer framePacer;
+	framePacer.setSync(FramePacer::SYNC_VSYNC);
+
+	RenderStats renderStats;
+	// the 2D tools record their batches, the render thread draws them
+	Batch2D* batch2D = Batch2D::getInstance();
+	Shapes2D* shapes2D = Shapes2D::getInstance();
+	batch2D->recording = true;
+	// ImGui creates its device objects in its first NewFrame, while the context is still current here
+	ImGui_ImplOpenGL3_NewFrame();
+	// from here on the main thread builds frame packets and the render thread owns the context
+	RenderThread renderThread;
+	renderThread.start(window);
 	// main loop
 	while (!glfwWindowShouldClose(window)) {
-
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		PROFILE_ZONE("Frame");
 		// per-frame time logic
 		// --------------------
-		float currentFrame = glfwGetTime();
-		deltaTime = currentFrame - lastFrame;
-		lastFrame = currentFrame;
+		{
+			PROFILE_ZONE("Pace frame");
+			deltaTime = framePacer.beginFrame();
+		}
+		// wait for a free packet, the statistics of the frame drawn in it before come back
+		{
+			PROFILE_ZONE("Wait for packet");
+			renderThread.begin();
+		}
+		std::shared_ptr<RenderStats> frameStats = std::make_shared<RenderStats>();
+		renderThread.complete([frameStats, &renderStats]() { renderStats = *frameStats; });
+		if (framePacer.syncChanged) {
+			framePacer.syncChanged = false;
+			int interval = framePacer.swapInterval();
+			renderThread.submit([interval]() { glfwSwapInterval(interval); });
+		}
+		{
+			int width = framebufferWidth, height = framebufferHeight;
+			renderThread.submit([width, height]() {
+				glViewport(0, 0, width, height);
+				glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			});
+		}
 		// receive input
-		// keyboard input
-		processInput(window);
-		// cursor action
-		processCursor(window);
-		glfwPollEvents();
+		{
+			PROFILE_ZONE("Input");
+			// keyboard input
+			processInput(window);
+			// cursor action
+			processCursor(window);
+			glfwPollEvents();
+		}
+		// continue texture uploads, textures show a placeholder until they are complete
+		renderThread.submit([textureManager, streamBudgetBytes]() {
+			textureManager->streamBudgetBytes = streamBudgetBytes;
+			textureManager->update();
+		});
 		// create imgui
 		// CREATE IMGUI
 		// start dear gui frame
-		ImGui_ImplOpenGL3_NewFrame();
-		ImGui_ImplGlfw_NewFrame();
-		ImGui::NewFrame();
+		{
+			PROFILE_ZONE("ImGui::NewFrame");
+			ImGui_ImplOpenGL3_NewFrame();
+			ImGui_ImplGlfw_NewFrame();
+			ImGui::NewFrame();
+		}
 
 		ImGui::Begin("Crescentǿ", &isActive, ImGuiWindowFlags_MenuBar);
 		if (ImGui::BeginMenuBar()) {
@@ -301,6 +997,9 @@ int main()
 				if (ImGui::MenuItem("Bezier curve tool", "Ctrl + B")) {
 					option = 4;
 				}
+				if (ImGui::MenuItem("Canvas tool", "Ctrl + D")) {
+					option = 5;
+				}
 				if (ImGui::MenuItem("3D tool", "Ctrl+ALT+C")) {
 					option = 3;
 				}
@@ -319,7 +1018,7 @@ int main()
 				// bind a array of type of float with the color editor
 				ImGui::ColorEdit3("color", picker_color);
 			}
-			drawTriangle(A, B, C, picker_color, graph2D.ID);
+			drawTriangle(A, B, C, picker_color);
 			break;
 		case 1:
 			// draw a triangle with three given vertices using Bresenhem
@@ -330,14 +1029,26 @@ int main()
 				ImGui::SliderFloat2("V1", v1, -0.9f, 0.9f, "%.1f");
 				ImGui::SliderFloat2("V2", v2, -0.9f, 0.9f, "%.1f");
 				ImGui::SliderFloat2("V3", v3, -0.9f, 0.9f, "%.1f");
+				ImGui::SliderInt("Pixels", &rasterPixels, 21, 401);
+				ImGui::Checkbox("Fill", &fillTriangle);
 				ImGui::EndGroup();
 			}
 			// draw grid
 			drawGrid(19, 19, grid_color, graph2D.ID);
+			// pixel centers land on the grid if the width is odd
+			raster.resize(rasterPixels | 1, rasterPixels | 1);
+			if (fillTriangle) {
+				float fill[3] = { draw_color[0] * 0.5f, draw_color[1] * 0.5f, draw_color[2] * 0.5f };
+				raster.triangle(rasterCoordinate(v1[0], raster) + 0.5f, rasterCoordinate(v1[1], raster) + 0.5f,
+					rasterCoordinate(v2[0], raster) + 0.5f, rasterCoordinate(v2[1], raster) + 0.5f,
+					rasterCoordinate(v3[0], raster) + 0.5f, rasterCoordinate(v3[1], raster) + 0.5f, Rasterizer::rgba(fill[0], fill[1], fill[2]));
+			}
 			// from v1 to v2
-			myLineTo(v1, v2, draw_color, graph2D.ID);
-			myLineTo(v1, v3, draw_color, graph2D.ID);
-			myLineTo(v2, v3, draw_color, graph2D.ID);
+			myLineTo(v1, v2, draw_color, raster, graph2D.ID);
+			myLineTo(v1, v3, draw_color, raster, graph2D.ID);
+			myLineTo(v2, v3, draw_color, raster, graph2D.ID);
+			// the raster is shown as it is now, the next frame draws into it while the command waits
+			renderThread.submit([raster, &rasterView]() { presentRaster(raster, rasterView); });
 			break;
 		case 2:
 			// draw a circle with a given origin and radius using Bresenhem
@@ -346,10 +1057,13 @@ int main()
 				ImGui::BeginGroup();
 				ImGui::ColorPicker3("select color", draw_color);
 				ImGui::SliderFloat("Radius", &radius, 0.0f, 1.0f);
+				ImGui::SliderInt("Pixels", &rasterPixels, 21, 401);
 				ImGui::EndGroup();
 			}
 			drawGrid(19, 19, grid_color, graph2D.ID);
-			myCircleAt(center, radius, draw_color, graph2D.ID);
+			raster.resize(rasterPixels | 1, rasterPixels | 1);
+			myCircleAt(center, radius, draw_color, raster);
+			renderThread.submit([raster, &rasterView]() { presentRaster(raster, rasterView); });
 			break;
 		case 3:
 		{
@@ -404,21 +1118,15 @@ int main()
 				ImGui::BeginGroup();
 				if (ImGui::BeginMenuBar()) {
 					if (ImGui::BeginMenu("3D Object")) {
-						if (ImGui::MenuItem("Cube", "")) {
+						if (ImGui::MenuItem("Cube", "") && size < MAX_CUBES) {
 							Cube newCube({ 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f });
+							materials.apply(newCube, containerMaterial);
 							cubes[size] = newCube;
 							size++;
 						}
 						if (ImGui::BeginMenu("Light")) {
-							if (ImGui::MenuItem(sourceLight.status.c_str())) {
-								if (sourceLight.visible) {
-									sourceLight.visible = false;
-									sourceLight.status = "Invisible";
-								}
-								else {
-									sourceLight.visible = true;
-									sourceLight.status = "Visible";
-								}
+							if (ImGui::MenuItem(pointLightState.visible ? "Visible" : "Invisible")) {
+								pointLightState.visible = !pointLightState.visible;
 							}
 							if (ImGui::BeginMenu("Light Mode")) {
 								if (ImGui::MenuItem("Point Light")) {
@@ -432,12 +1140,14 @@ int main()
 							if (ImGui::BeginMenu("Shading Mode")) {
 								if (ImGui::MenuItem("Phong mode")) {
 									currentShader = phong;
+									shadingModel = 1;
 								}
 								if (ImGui::MenuItem("Gouraud mode")) {
 									currentShader = gouraud;
 								}
 								if (ImGui::MenuItem("Blinn mode")) {
 									currentShader = blinn;
+									shadingModel = 0;
 								}
 								ImGui::EndMenu();
 							}
@@ -459,78 +1169,64 @@ int main()
 				float position[3] = { currentObject->transform.position[0], currentObject->transform.position[1], currentObject->transform.position[2] };
 				float rotation[3] = { currentObject->transform.rotation[0], currentObject->transform.rotation[1], currentObject->transform.rotation[2] };
 				float scale[3] = { currentObject->transform.scale[0], currentObject->transform.scale[1], currentObject->transform.scale[2] };
-				float lightColor[3] = { paralLight.lightColor[0], paralLight.lightColor[1], paralLight.lightColor[2] };
-				float lightPosition[3] = { paralLight.transform.position[0], paralLight.transform.position[1], paralLight.transform.position[2] };
+				float lightColor[3] = { sunState.color[0], sunState.color[1], sunState.color[2] };
+				float lightPosition[3] = { sunState.position[0], sunState.position[1], sunState.position[2] };
+				float pointLightPosition[3] = { pointLightState.position[0], pointLightState.position[1], pointLightState.position[2] };
 				float objCol[3] = { objectColor[0], objectColor[1], objectColor[2] };
 				ImGui::LabelText("Transform", currentObject->name.c_str());
 				ImGui::SliderFloat3("Position", position, -20.0f, 20.0f);
 				ImGui::SliderFloat3("Rotation", rotation, 0.0f, 180.0f);
 				ImGui::SliderFloat3("Scale", scale, 0.0f, 5.0f);
+				int material = materials.find(*currentObject);
+				if (ImGui::Combo("Material", &material, materialNames.data(), (int)materialNames.size()) && material >= 0) {
+					materials.apply(*currentObject, material);
+				}
 				ImGui::LabelText("", "Light");
 				ImGui::SliderFloat3("Light Position", lightPosition, -10.0f, 10.0f);
 				ImGui::SliderFloat3("Light Color", lightColor, 0.0f, 1.0f);
-				ImGui::SliderFloat("Ambient Factor", &sourceLight.ambientFactor, 0.0f, 1.0f);
-				ImGui::SliderFloat("Diffuse Factor", &sourceLight.diffuseFactor, 0.0f, 1.0f);
-				ImGui::SliderFloat("Specular Factor", &sourceLight.specularFactor, 0.0f, 10.0f);
-				ImGui::SliderFloat("Shininess", &sourceLight.shininess, 1.0f, 64.0f);
+				ImGui::SliderFloat("Ambient Factor", &pointLightState.ambientFactor, 0.0f, 1.0f);
+				ImGui::SliderFloat("Diffuse Factor", &pointLightState.diffuseFactor, 0.0f, 1.0f);
+				ImGui::SliderFloat("Specular Factor", &pointLightState.specularFactor, 0.0f, 10.0f);
+				ImGui::SliderFloat("Shininess", &pointLightState.shininess, 1.0f, 64.0f);
+				ImGui::SliderFloat3("Point Light Position", pointLightPosition, -10.0f, 10.0f);
+				ImGui::SliderInt("Shadow Updates", &shadowUpdateBudget, 1, PointShadowAtlas::MAX_LIGHTS);
+				ImGui::Text("Point shadows: %d updated, %d faces culled", renderStats.updatedLights, renderStats.culledFaces);
+				ImGui::SliderFloat("Shadow Slope Bias", &shadowSlopeBias, 0.0f, 8.0f);
+				ImGui::SliderFloat("Shadow Constant Bias", &shadowConstantBias, 0.0f, 16.0f);
+				ImGui::Checkbox("Front Face Culling", &shadowCullFront);
+				ImGui::Text("Shadow pass: %.3f ms", renderStats.shadowPassTime);
+				ImGui::Combo("Depth Prepass", &prepassMode, "Off\0On\0Auto\0");
+				ImGui::Text("Overdraw: %.2f fragments per pixel, prepass %s", renderStats.overdraw, renderStats.prepassActive ? "on" : "off");
+				ImGui::Text("Object matrices: %d uploaded", renderStats.uploadedSlots);
+				ImGui::Text("Material binds: %d draws, %d binds saved by the array", renderStats.materialDraws, renderStats.bindsSaved);
+				int streamBudgetMB = (int)(streamBudgetBytes / 1048576);
+				if (ImGui::SliderInt("Mip Budget (MB)", &streamBudgetMB, 1, 256)) {
+					streamBudgetBytes = (size_t)streamBudgetMB * 1048576;
+				}
+				ImGui::Text("Mip streaming: %.2f / %d MB resident, %d levels pending", renderStats.streamedBytes / 1048576.0f, streamBudgetMB, renderStats.pendingLevels);
+				ImGui::Text("Textures: %d resident, %d loading, %d baked, %.1f MB, hit rate %.0f%%", renderStats.textures, renderStats.loading, renderStats.baked, renderStats.residentBytes / 1048576.0f, renderStats.hitRate * 100.0f);
+				if (ImGui::TreeNode("Texture Memory")) {
+					for (const std::string& line : renderStats.textureMemory) {
+						ImGui::TextUnformatted(line.c_str());
+					}
+					ImGui::TreePop();
+				}
 				// set transform
 				currentObject->transform.position = { position[0], position[1], position[2] };
 				currentObject->transform.rotation = { rotation[0], rotation[1], rotation[2] };
 				currentObject->transform.scale = { scale[0], scale[1], scale[2] };
-				paralLight.transform.position = { lightPosition[0], lightPosition[1], lightPosition[2] };
-				paralLight.lightColor = { lightColor[0], lightColor[1], lightColor[2] };
+				sunState.position = { lightPosition[0], lightPosition[1], lightPosition[2] };
+				pointLightState.position = { pointLightPosition[0], pointLightPosition[1], pointLightPosition[2] };
+				sunState.color = { lightColor[0], lightColor[1], lightColor[2] };
 				objectColor = { objCol[0], objCol[1], objCol[2] };
 				ImGui::EndGroup();
 			}
 
 
-			// transformation matrix from world space to light's perspective space
-			// projection from light's perspective
-			glm::mat4 lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, near_plane, far_plane);
-			// parallel light
-			glm::mat4 lightView = glm::lookAt(paralLight.transform.position, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-			glm::mat4 lightSpaceMatrix = lightProjection * lightView;
-			// - now render scene from light's point of view
-			depth.use();
-			glUniformMatrix4fv(glGetUniformLocation(depth.ID, "lightSpaceMatrix"), 1, GL_FALSE, glm::value_ptr(lightSpaceMatrix));
-
-			glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-			glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-			glClear(GL_DEPTH_BUFFER_BIT);
-			// render plane with depth texture renderred above
-			plane.render(depth);
-			// render cubes
-			for (int i = 0; i < size; i++) {
-				cubes[i].render(depth);
-			}
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-
-			// render cubes with depth texture renderred above
-			glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			blinn.use();
-			glUniformMatrix4fv(glGetUniformLocation(blinn.ID, "lightSpaceMatrix"), 1, GL_FALSE, glm::value_ptr(lightSpaceMatrix));
-			// bind diffuse texture
-
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, floorTexture);
-			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, floorTexture);
-			glActiveTexture(GL_TEXTURE10);
-			glBindTexture(GL_TEXTURE_2D, depthTexture);
-			// render plane with depth texture renderred above
-			plane.render(camera, paralLight, blinn);
-
-			// bind specular texture
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, diffuseTexture);
-			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, specularTexture);
-			// render cubes
-			for (int i = 0; i < size; i++) {
-				cubes[i].render(camera, paralLight, blinn);
-			}
+			SceneFrame sceneFrame = buildScene(WINDOW_WIDTH, WINDOW_HEIGHT);
+			renderThread.submit([frame = std::move(sceneFrame), frameStats, &drawScene]() mutable {
+				drawScene(frame, *frameStats);
+			});
 			break;
 		case 4:
 			// Bezier curve tool
@@ -540,12 +1236,13 @@ int main()
 				if (leftState == GLFW_RELEASE && currentLeft == GLFW_PRESS) {
 					// add new control point
 					int pos = numberOfCP * 2;
+					controlPoints.resize(pos + 2);
 					controlPoints[pos] = (xPos - WINDOW_WIDTH / 2) / WINDOW_WIDTH * 2;
 					controlPoints[pos + 1] = -(yPos - WINDOW_HEIGHT / 2) / WINDOW_HEIGHT * 2;
 					std::cout << controlPoints[pos] << ", " << controlPoints[pos + 1] << std::endl;
 					numberOfCP++;
 				}
-				if (rightState == GLFW_RELEASE && currentRight == GLFW_PRESS) {
+				if (rightState == GLFW_RELEASE && currentRight == GLFW_PRESS && numberOfCP > 0) {
 					// delete last control point
 					numberOfCP--;
 				}
@@ -557,7 +1254,7 @@ int main()
 			// draw control points
 			for (int i = 0; i < numberOfCP; i++) {
 				int pos = i * 2;
-				drawSquare2D(controlPoints[pos], controlPoints[pos + 1], 2.0f, picker_color, graph2D.ID);
+				drawSquare2D(controlPoints[pos], controlPoints[pos + 1], 2.0f, picker_color);
 			}
 			{
 				// control button
@@ -567,7 +1264,7 @@ int main()
 						playButtonLabel = "pause";
 					}
 					else if (play_status == PAUSE || play_status == MODIFYING) {
-						if (play_status == MODIFYING) {
+						if (play_status == MODIFYING && numberOfCP > 0) {
 							numberOfCP--;
 						}
 						play_status = PLAYING;
@@ -580,7 +1277,7 @@ int main()
 						playButtonLabel = "pause";
 						play_status = PLAYING;
 					}
-					else if (play_status == MODIFYING) {
+					else if (play_status == MODIFYING && numberOfCP > 0) {
 						numberOfCP--;
 					}
 				}
@@ -588,6 +1285,11 @@ int main()
 					play_status = MODIFYING;
 					t = 0;
 				}
+				// how the control points are read
+				ImGui::Combo("Curve", &curveType, "Bezier\0Piecewise cubic\0Uniform B-spline\0Non-uniform B-spline\0");
+				if (curveType == Curve::UNIFORM_BSPLINE || curveType == Curve::NON_UNIFORM_BSPLINE) {
+					ImGui::SliderInt("Degree", &bezier.splineDegree, 1, 5);
+				}
 				// color picker
 				ImGui::ColorPicker3("color", bezierCol);
 			}
@@ -599,12 +1301,8 @@ int main()
 					}
 				}
 				// show progress of interpolation
-				float temp[100];
 				int num = numberOfCP;
-				int numCoords = 2 * num;
-				for (int i = 0; i < numCoords; i++) {
-					temp[i] = controlPoints[i];
-				}
+				std::vector<float> temp(controlPoints.begin(), controlPoints.begin() + 2 * num);
 				float col[3] = { bezierCol[0], bezierCol[1], bezierCol[2] };
 				float rChange = (1.0f - col[0]) / (float)num;
 				float gChange = (1.0f - col[1]) / (float)num;
@@ -614,7 +1312,7 @@ int main()
 						int pos = i * 2;
 						float interpolateX = t * temp[pos] + (1 - t) * temp[pos + 2];
 						float interpolateY = t * temp[pos + 1] + (1 - t) * temp[pos + 3];
-						drawLine((temp + pos), (temp + pos + 2), col, graph2D.ID);
+						drawLine(&temp[pos], &temp[pos + 2], col, graph2D.ID);
 						temp[pos] = interpolateX;
 						temp[pos + 1] = interpolateY;
 					}
@@ -622,29 +1320,130 @@ int main()
 					col[1] = col[1] + gChange;
 					col[2] = col[2] + bChange;
 					num--;
+					// de Casteljau's construction only belongs to the single segment, the others show their polygon
+					if (curveType != Curve::BEZIER) {
+						break;
+					}
+				}
+				// draw bezier curve, the interpolation above runs from the last control point at t = 0
+				bezier.update(controlPoints.data(), numberOfCP, (Curve::Type)curveType);
+				bezier.draw(1 - t, 1, bezierCol, graph2D.ID);
+				ImGui::Text("Curve: %d pieces, %d segments, flattened %d times", (int)bezier.pieces.size(), bezier.segments(), bezier.flattened);
+			}
+			break;
+		case 5:
+			// Canvas tool, drag to pan, scroll to zoom, right click adds a circle
+			{
+				int width, height;
+				glfwGetFramebufferSize(window, &width, &height);
+				int currentLeft = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT);
+				int currentRight = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT);
+				if (!io.WantCaptureMouse) {
+					if (currentLeft == GLFW_PRESS && canvasDragging) {
+						canvasView.pan((float)(xPos - canvasDragX), -(float)(yPos - canvasDragY));
+					}
+					canvasDragging = currentLeft == GLFW_PRESS;
+					if (io.MouseWheel != 0.0f) {
+						canvasView.zoomAt(powf(1.2f, io.MouseWheel), (float)xPos, (float)(height - yPos), width, height);
+					}
+					if (rightState == GLFW_RELEASE && currentRight == GLFW_PRESS) {
+						float world[2];
+						canvasView.toWorld((float)xPos, (float)(height - yPos), width, height, world);
+						canvas.circle(world[0], world[1], 10.0f / canvasView.zoom, Rasterizer::rgba(picker_color[0], picker_color[1], picker_color[2]));
+					}
+				}
+				else {
+					canvasDragging = false;
+				}
+				canvasDragX = xPos;
+				canvasDragY = yPos;
+				leftState = currentLeft;
+				rightState = currentRight;
+
+				if (ImGui::Button("Scatter 100k shapes")) {
+					canvas.scatter(100000, 500.0f, (unsigned int)canvas.shapes.size());
+				}
+				ImGui::SameLine();
+				if (ImGui::Button("Add Bezier curve") && bezier.points.size() >= 4) {
+					// the curve of the Bezier tool, its window mapped onto the view
+					std::vector<float> world(bezier.points.size());
+					for (size_t i = 0; i < world.size(); i += 2) {
+						canvasView.toWorld((bezier.points[i] + 1.0f) * 0.5f * width, (bezier.points[i + 1] + 1.0f) * 0.5f * height, width, height, &world[i]);
+					}
+					canvas.polyline(world.data(), (int)world.size() / 2, Rasterizer::rgba(bezierCol[0], bezierCol[1], bezierCol[2]));
+				}
+				ImGui::SameLine();
+				if (ImGui::Button("Remove last")) {
+					for (int id = (int)canvas.shapes.size() - 1; id >= 0; id--) {
+						if (canvas.shapes[id].type != CANVAS_NONE) {
+							canvas.remove(id);
+							break;
+						}
+					}
 				}
-				// draw bezier curve
-				for (float tempT = 0; tempT <= t; tempT += 0.01) {
-					drawBezierCurve(controlPoints, numberOfCP, tempT, bezierCol, graph2D.ID);
-					
+				ImGui::SameLine();
+				if (ImGui::Button("Clear")) {
+					canvas.clear();
 				}
+				ImGui::ColorEdit3("color", picker_color);
+				ImGui::SliderInt("Tiles per frame", &canvasView.tileBudget, 1, 64);
+				// tiles are rasterized here, the render thread uploads them and draws the quads
+				CanvasFrame canvasFrame;
+				canvasView.update(canvas, width, height, canvasFrame);
+				renderThread.submit([frame = std::move(canvasFrame), &canvasView]() { canvasView.submit(frame); });
+				ImGui::Text("Canvas: %d shapes, %d quadtree nodes, zoom %.3f", canvas.size(), canvas.index.nodeCount(), canvasView.zoom);
+				ImGui::Text("Tiles: %d visible, %d cached, %d rasterized, %d missing", canvasView.visibleTiles, canvasView.cachedTiles(), canvasView.rasterizedTiles, canvasView.missingTiles);
 			}
 			break;
 		default:
 			break;
 		}
+		// the 2D tools draw their batches, shapes go on top of the lines
+		Batch2DFrame batchFrame;
+		batch2D->takeFrame(batchFrame);
+		Shapes2DFrame shapesFrame;
+		shapes2D->takeFrame(shapesFrame);
+		renderThread.submit([batches = std::move(batchFrame), shapes = std::move(shapesFrame), batch2D, shapes2D, frameStats]() {
+			batch2D->drawFrame(batches);
+			shapes2D->drawFrame(shapes);
+			frameStats->batchDrawCalls = batch2D->drawCalls;
+			frameStats->batchVertices = batch2D->vertices;
+			frameStats->shapeDrawCalls = shapes2D->drawCalls;
+			frameStats->shapeInstances = shapes2D->instances;
+		});
+		if (option != 3) {
+			ImGui::Text("2D batch: %d draw calls, %d vertices", renderStats.batchDrawCalls, renderStats.batchVertices);
+			ImGui::Text("2D shapes: %d draw calls, %d instances", renderStats.shapeDrawCalls, renderStats.shapeInstances);
+		}
 		ImGui::End();
+		framePacer.overlay();
+		renderThread.overlay();
+		gpuTimer->overlay();
+		GLCounters::getInstance()->overlay();
+		GLCapture::getInstance()->overlay();
+#ifdef PROFILER_ENABLED
+		Profiler::getInstance()->overlay();
+#endif
 		// RENDER
-		ImGui::Render();
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-		// check events and swap buffer
-		glfwMakeContextCurrent(window);
-		glfwSwapBuffers(window);
+		{
+			PROFILE_ZONE("ImGui::Render");
+			ImGui::Render();
+		}
+		// the render thread draws the UI after the frame's commands and swaps
+		{
+			PROFILE_ZONE("End packet");
+			renderThread.end(ImGui::GetDrawData());
+		}
 	}
+	// take the context back for cleaning up
+	renderThread.stop();
+	batch2D->recording = false;
+	releaseScene();
 	// shut down ImGui
 	ImGui_ImplGlfw_Shutdown();
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui::DestroyContext();
+	GLCounters::getInstance()->reportLeaks();
 	// terminate
 	glfwDestroyWindow(window);
 	glfwTerminate();
@@ -652,12 +1451,14 @@ int main()
 }
 
 // @dev This is a callback every time user change the size of the window.
-// Corresponding change will be attached to view port for OpenGL renderring.
+// Corresponding change will be attached to view port for OpenGL renderring with the next frame,
+// events are handled on the main thread while the context may be current on the render thread.
 // @param window	The window pointer we have created
 // @param width		New width
 // @param height	New height
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-	glViewport(0, 0, width, height);
+	framebufferWidth = width;
+	framebufferHeight = height;
 }
 
 // @dev This is a function to check if some keys are pressed. 
@@ -698,297 +1499,101 @@ void drawGrid(int rows, int cols, float* color, unsigned int& shaderProgram) {
 }
 
 // @author ǿ
-// @dev This is a function using Bresenham to draw a line from one end to another
+// @dev This is a function using Bresenham to draw a line from one end to another, the pixels are
+// rasterized with the midpoint algorithm and the exact line is drawn over them
 // @param v1				One End of a line
 // @param v2				Another End of a line
+// @param raster			Raster the pixels are drawn into
 // @param shaderProgram		Id of shader program
-void myLineTo(float* v1, float* v2, float* color, unsigned int& shaderProgram) {
-
-	float xi = v1[0], yi = v1[1];
-	float dx, dy;
-	float xs = v1[0] - v2[0];
-	if (v1[0] != v2[0]) {
-		dx = xs < 0? 0.1f : -0.1f;
-		dy = (v1[1] - v2[1]) / xs * dx;
-	}
-	else {
-		dx = 0;
-		dy = 0.1f;
-	}
-	for (; (v1[0] - xi) / xs <= 1.01f; xi += dx, yi += dy) {
-		int y_ = floor(yi * 10);
-		float pi = yi * 10 - y_;
-		if (pi > 0.5) {
-			// draw
-			drawSquare2D(xi, (float)(y_ + 1) / 10.0f, 2.0f, color, shaderProgram);
-		}
-		else {
-			// draw
-			drawSquare2D(xi, (float)y_ / 10.0f, 2.0f, color, shaderProgram);
-		}
-	}
+void myLineTo(float* v1, float* v2, float* color, Rasterizer& raster, unsigned int& shaderProgram) {
+	int x0 = (int)floor(rasterCoordinate(v1[0], raster) + 0.5f), y0 = (int)floor(rasterCoordinate(v1[1], raster) + 0.5f);
+	int x1 = (int)floor(rasterCoordinate(v2[0], raster) + 0.5f), y1 = (int)floor(rasterCoordinate(v2[1], raster) + 0.5f);
+	raster.line(x0, y0, x1, y1, Rasterizer::rgba(color[0], color[1], color[2]));
 	drawLine(v1, v2, color, shaderProgram);
 }
 
 // @dev This function implemented a circle drawing method based on Bresenham Algorithm displaying with
-// several discrete points 
+// several discrete points, rasterized with the midpoint algorithm
 // @param center The center of the circle
 // @param radius The radius of the circle
 // @param color Color for drawing
-// @param shaderProgram Shader program defined for drawing previously
-void myCircleAt(float* center, float radius, float* color, unsigned int& shaderProgram) {
-
-	float xi = 0, yi = radius;
-	float dx = 0.1f;
-	for (;xi <= radius;xi += dx, yi = sqrt(radius * radius - xi * xi)) {
+// @param raster Raster the pixels are drawn into
+void myCircleAt(float* center, float radius, float* color, Rasterizer& raster) {
+	int cx = (int)floor(rasterCoordinate(center[0], raster) + 0.5f), cy = (int)floor(rasterCoordinate(center[1], raster) + 0.5f);
+	int r = (int)floor(radius * (raster.width - 1) / 2.0f + 0.5f);
+	raster.circle(cx, cy, r, Rasterizer::rgba(color[0], color[1], color[2]));
+	drawCircle(center, radius, color);
+}
 
-		int y_ = floor(yi * 10);
-		float pi = yi * 10 - y_;
-		if (pi > 0.5) {
-			yi = (float)(y_ + 1) / 10.0f;
-		}
-		else {
-			yi = (float)y_ / 10.0f;
-		}
-		// symmetry
-		drawSquare2D(xi, yi, 2.0f, color, shaderProgram);
-		drawSquare2D(xi, -yi, 2.0f,color, shaderProgram);
-		drawSquare2D(-xi, yi, 2.0f, color, shaderProgram);
-		drawSquare2D(-xi, -yi, 2.0f, color, shaderProgram);
+// @dev Map a coordinate in normalized device space to the raster, pixel k's center is at -1 + 2k / (width - 1)
+// @param ndc Coordinate between -1 and 1
+// @param raster Square raster the coordinate is mapped into
+// @return Pixel coordinate, whole numbers are pixel centers
+float rasterCoordinate(float ndc, const Rasterizer& raster) {
+	return (ndc + 1.0f) * (raster.width - 1) / 2.0f;
+}
 
-	}
-	drawCircle(center, radius, color, 100, shaderProgram);
+// @dev Upload the raster and draw it over the whole window, the outer pixels reach half a pixel past the edges
+// @param raster Raster of the Bresenham tools
+// @param view View drawing it
+void presentRaster(const Rasterizer& raster, RasterView& view) {
+	float half = 1.0f / (raster.width - 1);
+	view.present(raster, -1.0f - half, -1.0f - half, 1.0f + half, 1.0f + half);
 }
 
-// @dev This function will draw a square according to given parameters by using glDrawElement()
+// @dev This function will draw a square with rounded corners according to given parameters, appended to the 2D shapes
 // @param x X coordinate of the square
 // @param y Y coordinate of the square
 // @param edgeLength Length of edge of the square
 // @param color Color of the square
-// @param shaderProgram The shader program for shading the square
-void drawSquare2D(float x, float y, float edgeLength, float* color, unsigned int& shaderProgram) {
-
-	float vertices_[] = {
-				x - 0.01 * edgeLength / 2, y - 0.01 * edgeLength / 2, 0.0f, color[0], color[1], color[2],
-				x - 0.01 * edgeLength / 2, y + 0.01 * edgeLength / 2, 0.0f, color[0], color[1], color[2],
-				x + 0.01 * edgeLength / 2, y + 0.01 * edgeLength / 2, 0.0f, color[0], color[1], color[2],
-				x + 0.01 * edgeLength / 2, y - 0.01 * edgeLength / 2, 0.0f, color[0], color[1], color[2]
-	};
-
-	unsigned int indices[] = {
-		0, 1, 2,
-		0, 2, 3
-	};
-
-	unsigned int EBO;
-	glGenBuffers(1, &EBO);
-
-	unsigned int VAO;
-	glGenVertexArrays(1, &VAO);
-	unsigned int VBO;
-	glGenBuffers(1, &VBO);
-
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices_), vertices_, GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	// DRAW
-	// enable the shader program
-	glUseProgram(shaderProgram);
-	glBindVertexArray(VAO);
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	// deallocate
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
+void drawSquare2D(float x, float y, float edgeLength, float* color) {
+	Shapes2D::getInstance()->point(x, y, 0.01f * edgeLength / 2, color);
 }
 
 
-// @dev This function will draw a line according to given parameters by using primitive GL_LINE
+// @dev This function will draw a line according to given parameters, appended to the 2D batch as GL_LINES
 // @param v1 Start point of the line
 // @param v2 End point of the line
 // @param color Color for stroking line
 // @param shaderProgram The shader program for shading
 void drawLine(float* v1, float* v2, float* color, unsigned int& shaderProgram) {
-
-	float line[] = {
-		v1[0], v1[1], 0.0f, color[0], color[1], color[2],
-		v2[0], v2[1], 0.0f, color[0], color[1], color[2]
-	};
-
-	unsigned int VAO;
-	glGenVertexArrays(1, &VAO);
-	unsigned int VBO;
-	glGenBuffers(1, &VBO);
-
-
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-	glBufferData(GL_ARRAY_BUFFER, sizeof(line), line, GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	// unbind
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-	// DRAW
-	// enable the shader program
-	glUseProgram(shaderProgram);
-	glBindVertexArray(VAO);
-	glDrawArrays(GL_LINES, 0, 2);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
+	Batch2D::getInstance()->line(v1, v2, color, shaderProgram);
 }
 
-// @dev This function will draw a circle according to given parameters by using primitive GL LINE_LOOP
-// @param center Center of the circle which is default to (0.0f, 0.0f)
+// @dev This function will draw a circle according to given parameters, its outline is appended to the
+// 2D shapes and shaded from its distance field
+// @param center Center of the circle
 // @param radius Radius of the circle
 // @param color Color strokinig the circle
-// @param shaderProgram The shader program for shading
-void drawCircle(float* center, float radius, float* color, int count, unsigned int& shaderProgram) {
-
-	// initialize
-	float* rad = new float[6 * count];
-	for (int i = 0; i < count; i++) {
-		// x
-		int offset = i * 6;
-		rad[offset] = cos(2.0f * PI / (float)count * (float)i) * radius;
-		rad[offset + 1] = sin(2.0f * PI / (float)count * (float)i) * radius;
-		rad[offset + 2] = 0.0f;
-		rad[offset + 3] = color[0];
-		rad[offset + 4] = color[1];
-		rad[offset + 5] = color[2];
-	}
-	unsigned int VAO;
-	glGenVertexArrays(1, &VAO);
-	unsigned int VBO;
-	glGenBuffers(1, &VBO);
-
-
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * count, rad, GL_STATIC_DRAW);
-	
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	// unbind
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-	// DRAW
-	// enable the shader program
-	glUseProgram(shaderProgram);
-	glBindVertexArray(VAO);
-	glDrawArrays(GL_LINE_LOOP, 0, count);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
+void drawCircle(float* center, float radius, float* color) {
+	Shapes2D::getInstance()->circle(center, radius, color, 1.5f);
 }
 
-// @dev This function will draw a triangle according to given parameters by using primitive GL_TRIANGLE
+// @dev This function will draw a triangle according to given parameters, appended to the 2D shapes
 // @param v1 First vertex of triangle
 // @param v2 Second vertex of triangle
 // @param v3 Third vertex of triangle
 // @param color Color of the triangle
-// @param shaderProgram The shader program for shading
-void drawTriangle(float* v1, float* v2, float* v3, float* color, unsigned int& shaderProgram) {
-
-	float vertices_[] = {
-		v1[0], v1[1], 0.0f, color[0], color[1], color[2],// left
-			v2[0], v2[1], 0.0f, color[0], color[1], color[2],// right
-			v3[0],  v3[1], 0.0f, color[0], color[1], color[2] // top
-	};
-
-	// Vertex array object is to store every following vertex attributes callings
-	unsigned int VAO;
-	glGenVertexArrays(1, &VAO);
-	// Vetex buffer object is, obviously, a kind of object. Thus it has it's unique id
-	// to identify it
-	// vertex buffer object's id 
-	unsigned int VBO;
-	// generate buffer
-	glGenBuffers(1, &VBO);
-	// There are several type of buffer object. For vertex buffer object, it's buffer type
-	// is called GL_ARRAY_BUFFER. OpenGL allows us to bind different kind of buffer type at 
-	// the same time
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBindVertexArray(VAO);
-	// Now any operation calling on GL_ARRAY_BUFFER will configure on the buffer being binded
-	// currently
-
-	// @dev	This function is used to copy user's defined data into specified buffer
-	// @param target	The kind of buffer to send to
-	// @param size		The size of our data to send
-	// @param data		The real data we want to send to buffer
-	// @param usage		The way we hope our graphics card to manage the given data, with following three kinds of forms: 
-	//			GL_STATIC_DRAW	- With data hardly changed
-	//			GL_DYNAMIC_DRAW	- With data changed a lot
-	//			GL_STREAM_DRAW	- With data changed once a drawing
-	// And here we don't change the position of vertices of the triangle in every renderring
-	// so it's best for us to choose GL_STATIC_DRAW 
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices_), vertices_, GL_STATIC_DRAW);
-
-	// @dev tell OpenGL how to explain vertex data and configure on each vertices
-	// @param index			
-	// @param size			Define size of this type of vertex, which is 3 for vec3
-	// @param type			Define data type
-	// @param normalized	Define whether we hope to normalize data or not
-	// @param stride		Define length of each group of data
-	// @param pointer		Define offset which is of type (void*)
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	// unbind
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-	// DRAW
-	// enable the shader program
-	glUseProgram(shaderProgram);
-	glBindVertexArray(VAO);
-	glDrawArrays(GL_TRIANGLES, 0, 3);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
+void drawTriangle(float* v1, float* v2, float* v3, float* color) {
+	Shapes2D::getInstance()->triangle(v1, v2, v3, color);
 }
 
-void drawBezierCurve(float* controlPoints, int num, float t, float* color, unsigned int shaderProgram) {
-
-	float temp[100];
-	int numCoords = 2 * num;
-	for (int i = 0; i < numCoords; i++) {
-		temp[i] = controlPoints[i];
-	}
-	while (num > 1) {
-		for (int i = 0; i < num - 1; i++) {
-			int pos = i * 2;
-			float interpolateX = t * temp[pos] + (1 - t) * temp[pos + 2];
-			float interpolateY = t * temp[pos + 1] + (1 - t) * temp[pos + 3];
-			temp[pos] = interpolateX;
-			temp[pos + 1] = interpolateY;
-		}
-		num--;
+// @dev Hash position, rotation and scale of the cubes, used to find out whether shadows have to be redrawn
+// @param cubes Cubes in the scene
+// @param size Number of cubes
+unsigned int transformSignature(Cube* cubes, int size) {
+	// FNV-1a over the raw transform values
+	unsigned int hash = 2166136261u;
+	for (int i = 0; i < size; i++) {
+		const float values[9] = {
+			cubes[i].transform.position[0], cubes[i].transform.position[1], cubes[i].transform.position[2],
+			cubes[i].transform.rotation[0], cubes[i].transform.rotation[1], cubes[i].transform.rotation[2],
+			cubes[i].transform.scale[0], cubes[i].transform.scale[1], cubes[i].transform.scale[2]
+		};
+		const unsigned char* bytes = (const unsigned char*)values;
+		for (int j = 0; j < (int)sizeof(values); j++) {
+			hash = (hash ^ bytes[j]) * 16777619u;
+		}
 	}
-	drawSquare2D(temp[0], temp[1], 1.0f, color, shaderProgram);
+	return hash ^ (unsigned int)size;
 }
\ No newline at end of file